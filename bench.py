@@ -0,0 +1,169 @@
+import argparse
+import os
+import random
+import subprocess
+import tempfile
+import time
+from collections import namedtuple
+from pathlib import Path
+
+# Generates a large synthetic RUSTy program and times the compiler on it.
+# Usage: python bench.py [--case NAME] [--funs N] [--runs K] [--compiler ./rusty] [extra ...]
+#
+# The cases are what the numbers quoted in the history were measured with;
+# all but compile time phases of the compile through --time:
+#   compile   the whole compile of the program (default)
+#   lex       the lexing of a text of identifiers and keywords only, about
+#             15 MB at --funs 8000, where the keyword lookup is most of it
+#   parse     parsing the program on one thread and freeing its tree, with
+#             the peak resident memory of the compile; --threads 1,2,4,8
+#             parses it on that many threads instead, one count after another
+#   check     name resolution and type checking as the two walks of
+#             --split-checks
+#   print     the pretty-printer writing the program to /dev/null
+#   asm       the tree back end writing the assembly of the program to a
+#             file, with how fast the assembly is written
+
+
+def generate(funs):
+    lines = []
+    for i in range(funs):
+        lines.append(f"// helper number {i}: keeps the scanner busy with comments")
+        lines.append(f"fn f{i}(a: i32, b: i32) -> i32 {{")
+        lines.append(f"    let mut x: i32 = a + b * {i % 7 + 1};")
+        lines.append("    let y = x - 2;")
+        lines.append("    let flag: bool = x > y && y != 3 || !(a == b);")
+        lines.append("    if x > y {")
+        lines.append("        x += 1;")
+        lines.append("    } else if x == y {")
+        lines.append("        x -= 2;")
+        lines.append("    } else {")
+        lines.append("        x -= 1;")
+        lines.append("    }")
+        lines.append("    while x < 100 {")
+        lines.append("        x += 7;")
+        lines.append("    }")
+        lines.append("    for i in 0..3 {")
+        lines.append("        x += i * (y - 1) / 2;")
+        lines.append("    }")
+        if i > 0:
+            lines.append(f"    f{i - 1}(y, 2);")
+        lines.append("    if flag {")
+        lines.append("        x = x + 1;")
+        lines.append("    }")
+        lines.append("    return x;")
+        lines.append("}")
+        lines.append("")
+    lines.append("fn main() {")
+    lines.append("    let mut total: i32 = 0;")
+    for i in range(0, funs, max(1, funs // 50)):
+        lines.append(f"    total += f{i}({i % 13}, {i % 5});")
+    lines.append('    println!("{}", total);')
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+KEYWORDS = ["i64", "i32", "i16", "i8", "bool", "char", "str", "true", "false", "fn", "return", "break",
+            "let", "mut", "for", "in", "while", "loop", "if", "else", "println"]
+
+
+def generate_words(funs):
+    """Lines of identifiers and keywords, half of each, for the scanner alone."""
+    rng = random.Random(funs)
+    letters = "abcdefghijklmnopqrstuvwxyz_"
+    lines = []
+    for _ in range(funs * 40):
+        words = []
+        for _ in range(8):
+            if rng.random() < 0.5:
+                words.append(rng.choice(KEYWORDS))
+            else:
+                words.append("".join(rng.choice(letters) for _ in range(rng.randint(1, 10))))
+        lines.append(" ".join(words))
+    return "\n".join(lines) + "\n"
+
+
+# what a case compiles, the flags and environment it adds, and the phases
+# it reports, none for the wall-clock time of the whole compile; and the
+# file it writes, whose size is reported against the last phase
+Case = namedtuple("Case", ["source", "flags", "phases", "env", "output"], defaults=[{}, None])
+CASES = {
+    "compile": Case(generate, [], None),
+    "lex": Case(generate_words, ["--emit=tokens", "-o", "/dev/null"], ["lex"]),
+    "parse": Case(generate, ["--emit=ast", "-o", "/dev/null"], ["parse", "free"], {"RUSTY_THREADS": "1"}),
+    "check": Case(generate, ["--split-checks", "--backend=tree", "-o", "/dev/null"], ["names", "types"]),
+    "print": Case(generate, ["--emit=ast", "-o", "/dev/null"], ["output"]),
+    "asm": Case(generate, ["--backend=tree", "-o", "bench.s"], ["output"], output="bench.s"),
+}
+
+
+def run(compiler, flags, env, src_file):
+    """Compiles once; returns the wall-clock time and the phases --time wrote,
+    in seconds, and the peak resident memory in bytes."""
+    start = time.perf_counter()
+    proc = subprocess.Popen([compiler, *flags, str(src_file)], cwd=src_file.parent, env={**os.environ, **env},
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    stderr = proc.stderr.read()
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter() - start
+    if os.waitstatus_to_exitcode(status) != 0:
+        raise RuntimeError(f"compiler failed:\n{stderr}")
+    phases = {}
+    for line in stderr.splitlines():
+        name, ms, unit = line.split()
+        phases[name] = phases.get(name, 0) + float(ms) / 1000
+    return elapsed, phases, usage.ru_maxrss * 1024
+
+
+def measure(compiler, flags, env, src_file, runs, reported):
+    """The best time of each reported phase over the runs, and the peak resident memory."""
+    best = {}
+    peak = 0
+    for _ in range(runs):
+        elapsed, phases, rss = run(compiler, flags, env, src_file)
+        for name, seconds in (phases if reported else {"compile": elapsed}).items():
+            best[name] = min(best.get(name, seconds), seconds)
+        peak = max(peak, rss)
+    return best, peak
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--case", choices=CASES, default="compile")
+    parser.add_argument("--funs", type=int, default=2000)
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--threads", help="comma-separated RUSTY_THREADS to measure the case with, one after another")
+    parser.add_argument("--compiler", default="./rusty")
+    parser.add_argument("extra", nargs="*", help="extra arguments passed to the compiler")
+    args = parser.parse_args()
+
+    compiler = str(Path(args.compiler).resolve())
+    case = CASES[args.case]
+    reported = case.phases
+    flags = [*case.flags, *args.extra] + (["--time"] if reported else [])
+    envs = [case.env] if not args.threads else [{**case.env, "RUSTY_THREADS": n} for n in args.threads.split(",")]
+    with tempfile.TemporaryDirectory() as tmpdir:
+        src_file = Path(tmpdir) / "bench.rs"
+        src_file.write_text(case.source(args.funs))
+        size = src_file.stat().st_size
+
+        print(f"{args.case}: {args.funs} functions, {size / 1e6:.2f} MB source, best of {args.runs}:")
+        for env in envs:
+            try:
+                best, peak = measure(compiler, flags, env, src_file, args.runs, reported)
+            except RuntimeError as error:
+                print(error)
+                return
+            if args.threads:
+                print(f" {env['RUSTY_THREADS']} threads:")
+            for name in reported or ["compile"]:
+                print(f"  {name:<8} {best[name] * 1000:.1f} ms ({size / 1e6 / best[name]:.1f} MB/s)")
+            if case.output:
+                written = (Path(tmpdir) / case.output).stat().st_size
+                seconds = best[(reported or ["compile"])[-1]]
+                print(f"  wrote    {written / 1e6:.1f} MB ({written / 1e6 / seconds:.1f} MB/s)")
+            print(f"  peak RSS {peak / 1e6:.1f} MB")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,55 +1,356 @@
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include "src/syntactic/AstCache.h"
+#include "src/syntactic/Incremental.h"
 #include "src/syntactic/Parser.h"
 #include "src/semantic/Printer.h"
 #include "src/semantic/NameRes.h"
 #include "src/semantic/TypeCheck.h"
 #include "src/semantic/CodeGen.h"
 #include "src/semantic/SymbolTable.h"
+#include "src/ir/IrBuilder.h"
+#include "src/ir/ConstFold.h"
+#include "src/ir/IrLowering.h"
 
 using namespace std;
 
-int main(const int argc, char* argv[]) {
-    // input errors
-    if (argc != 2) {
-        cerr << "Incorrect number of arguments" << endl << "Usage: " << argv[0] << " <input_file>" << endl;
-        exit(1);
+enum class Emit { TOKENS, AST, IR, ASM };
+// what writes the assembly: the IR when it translates the program, else the tree
+enum class Backend { DEFAULT, IR, TREE };
+
+// a phase of the compile, whose time goes to stderr under --time when it ends
+static bool timing = false;
+
+class Phase {
+public:
+    explicit Phase(const char* name) : name(name), start(chrono::steady_clock::now()) {}
+    ~Phase() {
+        if (!timing) return;
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        cerr << name << ' ' << fixed << setprecision(2) << elapsed.count() << " ms" << endl;
     }
-    char* filename = argv[1];
 
-    Scanner scanner (filename);
+private:
+    const char* name;
+    chrono::steady_clock::time_point start;
+};
 
-    cout << "\n=======================\n";
-    cout << "Printing scanned tokens...";
-    cout << "\n=======================\n";
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [--emit=tokens|ast|ir|asm] [-o <path>|-] [--cache=<dir>] [--split-checks] [--backend=ir|tree] [--time] <input_file>" << endl
+         << "       " << prog << " --session [--split-checks] [--backend=ir|tree] [--time]" << endl
+         << "  --emit=asm     x86-64 assembly (default), written to <input>.s unless -o is given" << endl
+         << "  --emit=ir      three-address code of the checked program, written to stdout" << endl
+         << "                 unless -o is given" << endl
+         << "  --emit=ast     pretty-printed program, written to stdout unless -o is given" << endl
+         << "  --emit=tokens  scanned tokens, written to stdout unless -o is given" << endl
+         << "  -o -           write the output to stdout" << endl
+         << "  --cache=<dir>  keep checked programs in <dir>; compiling the same source" << endl
+         << "                 again skips lexing, parsing and the semantic checks" << endl
+         << "  --split-checks resolve names and check types in two walks instead of one," << endl
+         << "                 to tell which of them goes wrong" << endl
+         << "  --backend=ir   generate the assembly from the three-address code, and fail on" << endl
+         << "                 a program it does not translate; by default such a program is" << endl
+         << "                 left to the tree back end" << endl
+         << "  --backend=tree generate the assembly straight from the checked tree" << endl
+         << "  --time         write the time each phase takes to stderr" << endl
+         << "  --session      compile a buffer edited between compiles, with the requests" << endl
+         << "                 read from stdin and the replies written to stdout" << endl;
+    exit(1);
+}
 
-    while (!scanner.eof()) {
-        cout << scanner.getNextToken() << " - " << scanner.getTokenContent() << endl;
+// resolves names and checks types, in one walk unless split
+static void check(Program* program, SymbolTable& table, bool splitChecks) {
+    if (splitChecks) {
+        {
+            Phase phase("names");
+            NameRes nameRes(&table);
+            nameRes.visit(program);
+        }
+        Phase phase("types");
+        TypeCheck typeCheck(&table);
+        typeCheck.visit(program);
+    }
+    else {
+        Phase phase("check");
+        SymbolTable names;
+        NameRes nameRes(&names);
+        TypeCheck typeCheck(&table, &nameRes);
+        typeCheck.visit(program);
     }
+}
 
-    Parser parser (filename);
-    Program* program = parser.parse();
+// builds the IR of a checked program, if it is what the output comes from:
+// the IR when it translates the program, else the tree
+static bool translate(IrBuilder& builder, Program* program, Emit emit, Backend backend) {
+    if (emit != Emit::IR && (emit != Emit::ASM || backend == Backend::TREE)) return false;
+    Phase phase("ir");
+    try {
+        builder.visit(program);
+    }
+    catch (const IrUnsupported&) {
+        if (emit == Emit::IR || backend == Backend::IR) throw;
+        return false;
+    }
+    foldConstants(builder.module());
+    builder.module().verify();
+    return true;
+}
 
-    Printer printer;
+// the assembly of a checked program
+static void writeAsm(Program* program, SymbolTable& table, Backend backend, ostream& out) {
+    IrBuilder builder;
+    if (translate(builder, program, Emit::ASM, backend)) {
+        IrLowering(out).lower(builder.module());
+    }
+    else {
+        CodeGen codeGen(&table, out);
+        codeGen.visit(program);
+    }
+}
 
-    cout << "\n=======================\n";
-    cout << "Printing source code...";
-    cout << "\n=======================\n";
+static void reply(const char* status, const string& payload, const string& counts = "") {
+    cout << status << ' ' << payload.size() << counts << '\n' << payload << flush;
+}
 
-    printer.visit(program);
+// Compiles one buffer that is edited between compiles, as the API server
+// does for the editor. Each request is a line, some followed by bytes:
+//   edit <begin> <end> <length>   the <length> bytes that follow replace
+//                                 [begin, end) of the buffer
+//   check                         the semantic checks of the buffer only,
+//                                 for diagnostics as the text is typed
+//   compile                       the checks, then the assembly of the buffer
+// and each gets back `ok <length>`, with after it for a check or a compile
+// the fns parsed, checked and moved to other lines since the last one, or
+// `error <length>`; then <length> bytes of assembly or message. An edit
+// parses again only the fns it touches, and only those are checked again
+// as long as no fn changes its signature.
+static int serve(Backend backend, bool splitChecks) {
+    Incremental buffer("");
+    vector<TypeCheck::Declaration> declared;
+    size_t parsed = 0;
+    size_t shifted = 0;
+    for (string request; getline(cin, request);) {
+        istringstream words(request);
+        string command;
+        words >> command;
+        try {
+            if (command == "edit") {
+                size_t begin, end, length;
+                if (!(words >> begin >> end >> length)) throw runtime_error("malformed edit: " + request);
+                string replacement(length, '\0');
+                if (!cin.read(replacement.data(), length)) return 1;
+                buffer.edit(begin, end, replacement);
+                reply("ok", "");
+            }
+            else if (command == "check" || command == "compile") {
+                Program* program = buffer.program();
+                SymbolTable table;
+                size_t checked;
+                if (splitChecks) {
+                    declared.clear();
+                    check(program, table, true);
+                    checked = buffer.unchecked().size();
+                }
+                else {
+                    SymbolTable names;
+                    NameRes nameRes(&names);
+                    checked = TypeCheck(&table, &nameRes).recheck(program, buffer.unchecked(), declared);
+                }
+                buffer.markChecked();
+                ostringstream out;
+                if (command == "compile") writeAsm(program, table, backend, out);
+                reply("ok", out.str(), ' ' + to_string(buffer.parsedItems() - parsed) + ' ' + to_string(checked)
+                                       + ' ' + to_string(buffer.shiftedItems() - shifted));
+                parsed = buffer.parsedItems();
+                shifted = buffer.shiftedItems();
+            }
+            else {
+                throw runtime_error("unknown request: " + request);
+            }
+        }
+        catch (const exception& e) {
+            reply("error", e.what());
+            // the counts start again from a failed compile too
+            parsed = buffer.parsedItems();
+            shifted = buffer.shiftedItems();
+        }
+    }
+    return 0;
+}
+
+int main(const int argc, char* argv[]) {
+    char* filename = nullptr;
+    const char* outPath = nullptr;
+    const char* cacheDir = nullptr;
+    bool splitChecks = false;
+    bool session = false;
+    Backend backend = Backend::DEFAULT;
+    Emit emit = Emit::ASM;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-o") == 0) {
+            if (++i == argc) {
+                cerr << "Missing path after -o" << endl;
+                usage(argv[0]);
+            }
+            outPath = argv[i];
+        }
+        else if (strncmp(argv[i], "--emit=", 7) == 0) {
+            const char* kind = argv[i] + 7;
+            if (strcmp(kind, "tokens") == 0) emit = Emit::TOKENS;
+            else if (strcmp(kind, "ast") == 0) emit = Emit::AST;
+            else if (strcmp(kind, "ir") == 0) emit = Emit::IR;
+            else if (strcmp(kind, "asm") == 0) emit = Emit::ASM;
+            else {
+                cerr << "Unknown output kind '" << kind << "'" << endl;
+                usage(argv[0]);
+            }
+        }
+        else if (strncmp(argv[i], "--cache=", 8) == 0 && argv[i][8] != '\0') {
+            cacheDir = argv[i] + 8;
+        }
+        else if (strcmp(argv[i], "--split-checks") == 0) {
+            splitChecks = true;
+        }
+        else if (strncmp(argv[i], "--backend=", 10) == 0) {
+            const char* kind = argv[i] + 10;
+            if (strcmp(kind, "ir") == 0) backend = Backend::IR;
+            else if (strcmp(kind, "tree") == 0) backend = Backend::TREE;
+            else {
+                cerr << "Unknown back end '" << kind << "'" << endl;
+                usage(argv[0]);
+            }
+        }
+        else if (strcmp(argv[i], "--time") == 0) {
+            timing = true;
+        }
+        else if (strcmp(argv[i], "--session") == 0) {
+            session = true;
+        }
+        else if (strcmp(argv[i], "--dump-tokens") == 0) {
+            emit = Emit::TOKENS;
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            cerr << "Unknown option '" << argv[i] << "'" << endl;
+            usage(argv[0]);
+        }
+        else if (!filename) {
+            filename = argv[i];
+        }
+        else {
+            cerr << "Incorrect number of arguments" << endl;
+            usage(argv[0]);
+        }
+    }
+    if (session) {
+        if (filename || outPath || cacheDir || emit != Emit::ASM) {
+            cerr << "--session reads its input from stdin and only takes --split-checks, --backend and --time" << endl;
+            usage(argv[0]);
+        }
+        return serve(backend, splitChecks);
+    }
+    // input errors
+    if (!filename) {
+        cerr << "Incorrect number of arguments" << endl;
+        usage(argv[0]);
+    }
+
+    // assembly goes next to the input, so compiling different files at the
+    // same time never shares an output file
+    string defaultPath = emit == Emit::ASM ? filesystem::path(filename).replace_extension(".s").string() : "-";
+    string path = outPath ? outPath : defaultPath;
 
+    // a source compiled before comes out of the cache already checked
+    unique_ptr<AstCache> cache;
+    string source;
+    Program* program = nullptr;
+    bool checked = emit == Emit::IR || emit == Emit::ASM;
+    if (cacheDir && checked) {
+        cache = make_unique<AstCache>(cacheDir);
+        ifstream in(filename, ios::binary);
+        if (!in) {
+            throw runtime_error(string("could not open file: ") + filename);
+        }
+        source.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        Phase phase("cache");
+        program = cache->load(source);
+    }
+
+    // the file is lexed once; the parser reads the same token buffer
+    unique_ptr<Scanner> scanner;
     SymbolTable table;
-    NameRes nameRes(&table);
-    nameRes.visit(program);
+    if (!program) {
+        {
+            Phase phase("lex");
+            scanner = cache ? make_unique<Scanner>(source, 1) : make_unique<Scanner>(filename);
+        }
+        if (emit != Emit::TOKENS) {
+            Phase phase("parse");
+            Parser parser (scanner.get());
+            program = parser.parse();
+        }
+        if (checked) {
+            check(program, table, splitChecks);
+            if (cache) {
+                Phase phase("cache");
+                cache->store(source, program);
+            }
+        }
+    }
 
-    TypeCheck typeCheck(&table);
-    typeCheck.visit(program);
+    // the IR is built before the output is opened too, as not every
+    // program translates to it; the tree back end writes those by default
+    IrBuilder builder;
+    bool viaIr = translate(builder, program, emit, backend);
 
-    std::ofstream f ("a.s");
-    CodeGen codeGen(&table, f);
-    codeGen.visit(program);
-    f.close();
+    // the output is only opened once the input is known to be valid
+    ofstream file;
+    if (path != "-") {
+        file.open(path);
+        if (!file) {
+            cerr << "Cannot open output file " << path << endl;
+            exit(1);
+        }
+    }
+    ostream& out = path == "-" ? cout : file;
 
+    {
+        Phase phase("output");
+        switch (emit) {
+            case Emit::TOKENS:
+                while (!scanner->eof()) {
+                    out << scanner->getNextToken() << " - " << scanner->getTokenContent() << '\n';
+                }
+                break;
+            case Emit::AST: {
+                Printer printer(out);
+                printer.visit(program);
+                break;
+            }
+            case Emit::IR:
+                builder.module().print(out);
+                break;
+            case Emit::ASM: {
+                if (viaIr) {
+                    IrLowering(out).lower(builder.module());
+                    break;
+                }
+                CodeGen codeGen(&table, out);
+                codeGen.visit(program);
+                break;
+            }
+        }
+        out.flush();
+    }
+
+    {
+        Phase phase("free");
+        delete program;
+    }
     return 0;
 }
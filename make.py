@@ -27,7 +27,7 @@ for file in rust_dir.glob('*.rs'):
 source_files = [str(f) for f in cpp_dir.rglob('*.cpp')]
 source_files.append('main.cpp')
 compiler_exec = out_dir / 'rusty'
-compile_cmd = ['g++', '-std=c++20', *source_files, '-o', str(compiler_exec)]
+compile_cmd = ['g++', '-std=c++20', '-pthread', *source_files, '-o', str(compiler_exec)]
 comp_rusty = subprocess.run(compile_cmd, capture_output=True, text=True)
 if comp_rusty.returncode != 0:
     print('RUSTy compilation error:')
@@ -39,8 +39,9 @@ if comp_rusty.returncode != 0:
 
 # Run RUSTy for each test case
 for file in rust_dir.glob('*.rs'):
-    # Run the RUSTy compiler to generate assembly (a.s)
-    result_rusty = subprocess.run([compiler_exec, str(file)], capture_output=True, text=True)
+    # Run the RUSTy compiler to generate assembly
+    asm_path = out_dir / f"{file.stem}.s"
+    result_rusty = subprocess.run([compiler_exec, f"--cache={out_dir / 'cache'}", '-o', str(asm_path), str(file)], capture_output=True, text=True)
     if result_rusty.returncode != 0:
         print(f"RUSTy error on {file.name}:")
         print(result_rusty.stderr)
@@ -49,7 +50,6 @@ for file in rust_dir.glob('*.rs'):
             print(f"\n{name}:\n{out}")
         #sys.exit(1)
 
-    asm_path = Path('a.s')
     exe_path = out_dir / file.stem
     gcc_res = subprocess.run(['gcc', '-no-pie', str(asm_path), '-o', str(exe_path)], capture_output=True, text=True)
     asm_path.unlink(missing_ok=True)
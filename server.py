@@ -1,6 +1,9 @@
 import subprocess
 import tempfile
+import threading
+from collections import OrderedDict
 from pathlib import Path
+from typing import Optional
 from fastapi import FastAPI, HTTPException
 from fastapi.middleware.cors import CORSMiddleware
 from pydantic import BaseModel
@@ -17,6 +20,121 @@ COMPILER_PATH = (Path(__file__).resolve().parent / "rusty").resolve()
 
 class CodeRequest(BaseModel):
     code: str
+    # names the editor the code comes from, whose compiler session it goes to
+    session: Optional[str] = None
+
+
+class CompilerCrashed(Exception):
+    pass
+
+
+class Session:
+    """A long-lived `rusty --session` holding the code of one editor.
+
+    Each request sends it only the span where the code differs from the
+    editor's last one, so the compiler parses and checks again only the fns
+    that changed. Requests of one editor wait for each other; those of
+    different editors go to different processes and do not."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.process = None
+        self.code = b""
+        # set once the session is dropped; a request already on its way
+        # still gets its answer, from a compiler that then exits
+        self.closed = False
+
+    def request(self, line, data=b""):
+        self.process.stdin.write(line.encode() + b"\n" + data)
+        self.process.stdin.flush()
+        header = self.process.stdout.readline().decode().split()
+        if not header:
+            raise CompilerCrashed()
+        return header[0] == "ok", self.process.stdout.read(int(header[1])).decode()
+
+    def start(self):
+        self.close_process()
+        self.process = subprocess.Popen(
+            [str(COMPILER_PATH), "--session"], stdin=subprocess.PIPE, stdout=subprocess.PIPE
+        )
+        self.code = b""
+
+    def close_process(self):
+        if self.process is not None:
+            self.process.kill()
+            self.process.wait()
+            self.process = None
+
+    def edit(self, code):
+        """Sends the compiler the span where code differs from its copy."""
+        begin = 0
+        limit = min(len(code), len(self.code))
+        while begin < limit and code[begin] == self.code[begin]:
+            begin += 1
+        end = 0
+        while end < limit - begin and code[-1 - end] == self.code[-1 - end]:
+            end += 1
+        replacement = code[begin:len(code) - end]
+        ok, _ = self.request(f"edit {begin} {len(self.code) - end} {len(replacement)}", replacement)
+        if ok:
+            self.code = code
+        return ok
+
+    def send(self, command, code):
+        """Brings the compiler's copy up to code and sends it command, check or
+        compile; returns whether the code passes, and the assembly or the error."""
+        code = code.encode()
+        with self.lock:
+            try:
+                if self.process is None or self.process.poll() is not None:
+                    self.start()
+                # a rejected edit means the two copies went apart, so the
+                # compiler starts again from the whole code
+                if not self.edit(code):
+                    self.start()
+                    if not self.edit(code):
+                        raise CompilerCrashed()
+                return self.request(command)
+            except (OSError, CompilerCrashed, ValueError, IndexError):
+                # a crashed compiler is started again on the next request
+                self.close_process()
+                raise HTTPException(status_code=500, detail="RUSTy crashed")
+            finally:
+                if self.closed:
+                    self.close_process()
+
+    def close(self):
+        with self.lock:
+            self.closed = True
+            self.close_process()
+
+
+# the sessions of the editors seen last, the least recent first
+MAX_SESSIONS = 32
+sessions = OrderedDict()
+sessions_lock = threading.Lock()
+
+
+def send(req: CodeRequest, command):
+    """Sends the code of a request to the session of its editor; code from no
+    editor in particular gets a session of its own."""
+    if req.session is None:
+        session = Session()
+        try:
+            return session.send(command, req.code)
+        finally:
+            session.close()
+    evicted = None
+    with sessions_lock:
+        session = sessions.get(req.session)
+        if session is None:
+            session = sessions[req.session] = Session()
+            if len(sessions) > MAX_SESSIONS:
+                _, evicted = sessions.popitem(last=False)
+        sessions.move_to_end(req.session)
+    if evicted is not None:
+        evicted.close()
+    return session.send(command, req.code)
 
 
 def build_compiler():
@@ -25,7 +143,7 @@ def build_compiler():
     src_dir = Path("src")
     sources = [str(p) for p in src_dir.rglob("*.cpp")]
     sources.append("main.cpp")
-    compile_cmd = ["g++", "-std=c++20", *sources, "-o", str(COMPILER_PATH)]
+    compile_cmd = ["g++", "-std=c++20", "-pthread", *sources, "-o", str(COMPILER_PATH)]
     result = subprocess.run(compile_cmd, capture_output=True, text=True)
     if result.returncode != 0:
         raise RuntimeError(f"Compiler build failed: {result.stderr}")
@@ -36,43 +154,37 @@ def startup_event():
     build_compiler()
 
 
+@app.post("/check")
+def check_code(req: CodeRequest):
+    """Reports the first error of the code, without generating it; cheap
+    enough for the editor to call on every keystroke."""
+    ok, output = send(req, "check")
+    return {"ok": ok, "diagnostic": output}
+
+
 @app.post("/compile")
 def compile_code(req: CodeRequest):
-    with tempfile.TemporaryDirectory() as tmpdir:
-        src_file = Path(tmpdir) / "input.rs"
-        src_file.write_text(req.code)
-        result = subprocess.run([str(COMPILER_PATH), str(src_file)], capture_output=True, text=True)
-        asm_path = Path("a.s")
-        asm_text = asm_path.read_text() if asm_path.exists() else ""
-        if asm_path.exists():
-            asm_path.unlink()
-        if result.returncode != 0:
-            raise HTTPException(status_code=400, detail=result.stderr or "Compilation failed")
-        return {"assembly": asm_text, "compiler_output": result.stdout}
+    ok, output = send(req, "compile")
+    if not ok:
+        raise HTTPException(status_code=400, detail=output or "Compilation failed")
+    return {"assembly": output, "compiler_output": ""}
 
 
 @app.post("/run")
 def run_code(req: CodeRequest):
     """Compile the input with RUSTy, assemble with gcc and execute."""
     with tempfile.TemporaryDirectory() as tmpdir:
-        src_file = Path(tmpdir) / "input.rs"
+        asm_path = Path(tmpdir) / "input.s"
         exe_file = Path(tmpdir) / "program"
 
         # Compile Rust code to assembly using RUSTy
-        src_file.write_text(req.code)
-        rusty_res = subprocess.run(
-            [str(COMPILER_PATH), str(src_file)], capture_output=True, text=True
-        )
-        asm_path = Path("a.s")
-        asm_text = asm_path.read_text() if asm_path.exists() else ""
-
-        if rusty_res.returncode != 0:
-            if asm_path.exists():
-                asm_path.unlink()
+        ok, output = send(req, "compile")
+        if not ok:
             raise HTTPException(
                 status_code=400,
-                detail=rusty_res.stderr or "RUSTy compilation failed",
+                detail=output or "RUSTy compilation failed",
             )
+        asm_path.write_text(output)
 
         # Assemble using gcc
         gcc_res = subprocess.run(
@@ -80,7 +192,7 @@ def run_code(req: CodeRequest):
             capture_output=True,
             text=True,
         )
-        asm_path.unlink()
+        asm_text = asm_path.read_text()
         if gcc_res.returncode != 0:
             raise HTTPException(
                 status_code=400,
@@ -93,7 +205,7 @@ def run_code(req: CodeRequest):
             "output": run_res.stdout,
             "exit_code": run_res.returncode,
             "assembly": asm_text,
-            "compiler_output": rusty_res.stdout,
+            "compiler_output": "",
             "stderr": run_res.stderr,
         }
 
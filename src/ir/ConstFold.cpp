@@ -0,0 +1,234 @@
+#include "ConstFold.h"
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <optional>
+
+// what is known of a temp at a point of the code; trivial, so that the
+// state of a whole function copies as one block of memory
+struct Constant {
+    bool known;
+    int64_t value;
+};
+
+// whether a / b traps at run time: the lowering divides in 32 bits below
+// i64, where only i32 can overflow
+static bool traps(Value::Type type, int64_t a, int64_t b) {
+    if (b == 0) return true;
+    if (b != -1) return false;
+    if (type == Value::I64) return a == std::numeric_limits<int64_t>::min();
+    return type == Value::I32 && a == std::numeric_limits<int32_t>::min();
+}
+
+static std::optional<int64_t> read(IrArg arg, const std::vector<Constant>& state) {
+    if (arg.isImm()) return arg.value;
+    if (arg.isTemp() && state[arg.value].known) return state[arg.value].value;
+    return std::nullopt;
+}
+
+// the value instr writes, when its operands are known and it computes it
+static std::optional<int64_t> evaluate(const IrFunction& fun, const IrInstr& instr,
+                                       const std::vector<Constant>& state) {
+    std::optional<int64_t> a = read(instr.a, state);
+    switch (instr.op) {
+        case IrOp::COPY:
+            return a;
+        case IrOp::NOT:
+            if (!a) return std::nullopt;
+            return !*a;
+        case IrOp::CAST:
+            if (!a) return std::nullopt;
+            return wrapTo(fun.temps[instr.dst], *a);
+        case IrOp::ADD: case IrOp::SUB: case IrOp::MUL: case IrOp::DIV:
+        case IrOp::EQ: case IrOp::NE: case IrOp::LT:
+        case IrOp::LE: case IrOp::GT: case IrOp::GE:
+            break;
+        default:
+            return std::nullopt;
+    }
+    std::optional<int64_t> b = read(instr.b, state);
+    if (!a || !b) return std::nullopt;
+    // unsigned, where overflow wraps, before the result is cut to its type
+    uint64_t x = *a, y = *b;
+    switch (instr.op) {
+        case IrOp::ADD: return wrapTo(instr.type, int64_t(x + y));
+        case IrOp::SUB: return wrapTo(instr.type, int64_t(x - y));
+        case IrOp::MUL: return wrapTo(instr.type, int64_t(x * y));
+        case IrOp::DIV:
+            if (traps(instr.type, *a, *b)) return std::nullopt;
+            return wrapTo(instr.type, *a / *b);
+        case IrOp::EQ: return *a == *b;
+        case IrOp::NE: return *a != *b;
+        case IrOp::LT: return *a < *b;
+        case IrOp::LE: return *a <= *b;
+        case IrOp::GT: return *a > *b;
+        default: return *a >= *b;
+    }
+}
+
+// what is known after instr, from what is known before it
+static void step(const IrFunction& fun, const IrInstr& instr, std::vector<Constant>& state) {
+    if (instr.dst < 0) return;
+    std::optional<int64_t> value = evaluate(fun, instr, state);
+    state[instr.dst] = value ? Constant {true, *value} : Constant {};
+}
+
+// the blocks the terminator of a block can go to
+static IrSuccessors taken(const IrBlock& block, const std::vector<Constant>& state) {
+    const IrInstr& last = block.terminator();
+    if (last.op == IrOp::BR) {
+        if (std::optional<int64_t> cond = read(last.a, state)) return {{*cond ? last.target : last.other}, 1};
+    }
+    return block.successors();
+}
+
+// What is known of every temp on entry to each block, none for the blocks
+// no branch that can be taken reaches. Nothing is known on entry to the
+// function; after that a temp is known where every path so far agrees on
+// it, and a block is seen again whenever that changes.
+static std::vector<std::optional<std::vector<Constant>>> analyze(const IrFunction& fun) {
+    std::vector<std::optional<std::vector<Constant>>> in(fun.blocks.size());
+    std::vector<bool> queued(fun.blocks.size());
+    in[0].emplace(fun.temps.size(), Constant {});
+    std::deque<uint32_t> work {0};
+    queued[0] = true;
+    while (!work.empty()) {
+        uint32_t b = work.front();
+        work.pop_front();
+        queued[b] = false;
+        std::vector<Constant> state = *in[b];
+        for (const IrInstr& instr : fun.blocks[b].instrs) {
+            step(fun, instr, state);
+        }
+        for (uint32_t succ : taken(fun.blocks[b], state)) {
+            bool changed = !in[succ];
+            if (changed) {
+                in[succ] = state;
+            }
+            else {
+                for (size_t t = 0; t < state.size(); ++t) {
+                    Constant& known = (*in[succ])[t];
+                    if (known.known && (!state[t].known || state[t].value != known.value)) {
+                        known.known = false;
+                        changed = true;
+                    }
+                }
+            }
+            if (changed && !queued[succ]) {
+                queued[succ] = true;
+                work.push_back(succ);
+            }
+        }
+    }
+    return in;
+}
+
+// puts the known values in place of the temps, and turns what computes one
+// into a copy of it and a branch on one into a jump; the blocks no longer
+// reached are left empty. Returns whether a branch went.
+static bool rewrite(IrFunction& fun, const std::vector<std::optional<std::vector<Constant>>>& in) {
+    bool jumps = false;
+    for (size_t b = 0; b < fun.blocks.size(); ++b) {
+        if (!in[b]) {
+            fun.blocks[b].instrs.clear();
+            continue;
+        }
+        std::vector<Constant> state = *in[b];
+        auto replace = [&](IrArg& arg) {
+            if (arg.isTemp() && state[arg.value].known) arg = IrArg::imm(state[arg.value].value);
+        };
+        for (IrInstr& instr : fun.blocks[b].instrs) {
+            replace(instr.a);
+            replace(instr.b);
+            if (instr.op == IrOp::CALL || instr.op == IrOp::PRINT) {
+                for (uint32_t i = instr.firstArg; i < instr.firstArg + instr.argCount; ++i) {
+                    replace(fun.args[i]);
+                }
+            }
+            step(fun, instr, state);
+            if (instr.dst >= 0 && state[instr.dst].known && instr.op != IrOp::COPY) {
+                instr = IrInstr(IrOp::COPY, fun.temps[instr.dst], instr.dst, IrArg::imm(state[instr.dst].value));
+            }
+            if (instr.op == IrOp::BR && instr.a.isImm()) {
+                if (!instr.a.value) instr.target = instr.other;
+                instr.op = IrOp::JMP;
+                instr.a = {};
+                jumps = true;
+            }
+        }
+    }
+    return jumps;
+}
+
+// whether instr does nothing but write its dst
+static bool isPure(const IrInstr& instr) {
+    switch (instr.op) {
+        case IrOp::COPY: case IrOp::ADD: case IrOp::SUB: case IrOp::MUL:
+        case IrOp::EQ: case IrOp::NE: case IrOp::LT:
+        case IrOp::LE: case IrOp::GT: case IrOp::GE:
+        case IrOp::NOT: case IrOp::CAST: case IrOp::STRING: case IrOp::LOAD:
+            return true;
+        case IrOp::DIV:
+            return instr.b.isImm() && instr.b.value != 0 && instr.b.value != -1;
+        default:
+            return false;
+    }
+}
+
+// drops what writes a temp that is never read, until there is none
+static void removeUnread(IrFunction& fun) {
+    std::vector<int> reads(fun.temps.size());
+    for (const IrBlock& block : fun.blocks) {
+        for (const IrInstr& instr : block.instrs) {
+            fun.forEachUse(instr, [&](int temp) { ++reads[temp]; });
+        }
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (IrBlock& block : fun.blocks) {
+            std::erase_if(block.instrs, [&](const IrInstr& instr) {
+                if (instr.dst < 0 || reads[instr.dst] || !isPure(instr)) return false;
+                fun.forEachUse(instr, [&](int temp) { --reads[temp]; });
+                changed = true;
+                return true;
+            });
+        }
+    }
+}
+
+// appends to each block that ends in a jump the block it jumps to, as long
+// as no other block goes there; those left empty are no longer reached.
+// Returns whether a block was merged.
+static bool mergeBlocks(IrFunction& fun) {
+    bool merged = false;
+    std::vector<int> preds(fun.blocks.size());
+    for (const IrBlock& block : fun.blocks) {
+        if (block.instrs.empty()) continue;
+        for (uint32_t succ : block.successors()) {
+            ++preds[succ];
+        }
+    }
+    for (uint32_t b = 0; b < fun.blocks.size(); ++b) {
+        std::vector<IrInstr>& instrs = fun.blocks[b].instrs;
+        while (!instrs.empty() && instrs.back().op == IrOp::JMP) {
+            uint32_t next = instrs.back().target;
+            if (next == b || next == 0 || preds[next] != 1) break;
+            std::vector<IrInstr>& moved = fun.blocks[next].instrs;
+            instrs.pop_back();
+            instrs.insert(instrs.end(), std::make_move_iterator(moved.begin()), std::make_move_iterator(moved.end()));
+            moved.clear();
+            merged = true;
+        }
+    }
+    return merged;
+}
+
+void foldConstants(IrModule& module) {
+    for (IrFunction& fun : module.functions) {
+        bool jumps = rewrite(fun, analyze(fun));
+        removeUnread(fun);
+        // the blocks keep their order when no edge changed
+        if (mergeBlocks(fun) || jumps) fun.layOut();
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef CONSTFOLD_H
+#define CONSTFOLD_H
+
+#include "Ir.h"
+
+// Constant folding and propagation over the CFG of each function. A temp
+// whose value is the same on every path that reaches a point is replaced
+// there by that value, which carries a let through to its uses; an
+// operation on constants becomes a copy of its wrapped result, and a branch
+// on a constant a jump, so the blocks it can no longer reach are dropped.
+// Only blocks reached along branches that can be taken count, so a local
+// that stays constant through a loop stays constant in it. A division by
+// zero, or one that overflows and traps, is left for the program to do.
+// Then what computes a temp no one reads goes, and a block that only one
+// jump reaches is merged into the block that jumps.
+void foldConstants(IrModule& module);
+
+#endif
@@ -0,0 +1,356 @@
+#include "Ir.h"
+#include <stdexcept>
+#include <unordered_map>
+
+static const char* opName(IrOp op) {
+    switch (op) {
+        case IrOp::COPY: return "copy";
+        case IrOp::ADD: return "add";
+        case IrOp::SUB: return "sub";
+        case IrOp::MUL: return "mul";
+        case IrOp::DIV: return "div";
+        case IrOp::EQ: return "eq";
+        case IrOp::NE: return "ne";
+        case IrOp::LT: return "lt";
+        case IrOp::LE: return "le";
+        case IrOp::GT: return "gt";
+        case IrOp::GE: return "ge";
+        case IrOp::NOT: return "not";
+        case IrOp::CAST: return "cast";
+        case IrOp::STRING: return "string";
+        case IrOp::LOAD: return "load";
+        case IrOp::STORE: return "store";
+        case IrOp::CALL: return "call";
+        case IrOp::PRINT: return "print";
+        case IrOp::JMP: return "jmp";
+        case IrOp::BR: return "br";
+        case IrOp::RET: return "ret";
+    }
+    return "?";
+}
+
+static bool isInteger(Value::Type type) {
+    return type == Value::I8 || type == Value::I16 ||
+           type == Value::I32 || type == Value::I64;
+}
+
+// a type a temp or an operation can have
+static bool isScalar(Value::Type type) {
+    return isInteger(type) || type == Value::BOOL ||
+           type == Value::CHAR || type == Value::STR;
+}
+
+int64_t wrapTo(Value::Type type, int64_t value) {
+    switch (type) {
+        case Value::I8: return int8_t(value);
+        case Value::I16: return int16_t(value);
+        case Value::I32: return int32_t(value);
+        default: return value;
+    }
+}
+
+bool IrInstr::isTerminator() const {
+    return op == IrOp::JMP || op == IrOp::BR || op == IrOp::RET;
+}
+
+IrSuccessors IrBlock::successors() const {
+    const IrInstr& last = terminator();
+    switch (last.op) {
+        case IrOp::JMP: return {{last.target}, 1};
+        case IrOp::BR: return {{last.target, last.other}, 2};
+        default: return {};
+    }
+}
+
+std::span<const IrArg> IrFunction::argsOf(const IrInstr& instr) const {
+    return std::span<const IrArg>(args).subspan(instr.firstArg, instr.argCount);
+}
+
+std::vector<std::vector<uint32_t>> IrFunction::predecessors() const {
+    std::vector<std::vector<uint32_t>> preds(blocks.size());
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        for (uint32_t succ : blocks[b].successors()) {
+            preds[succ].push_back(b);
+        }
+    }
+    return preds;
+}
+
+void IrFunction::layOut() {
+    size_t count = blocks.size();
+    std::vector<uint32_t> postorder;
+    std::vector<bool> seen(count);
+    // block and how many of its successors were pushed
+    std::vector<std::pair<uint32_t, size_t>> stack {{0, 0}};
+    seen[0] = true;
+    while (!stack.empty()) {
+        auto& [block, done] = stack.back();
+        IrSuccessors succs = blocks[block].successors();
+        if (done == succs.size()) {
+            postorder.push_back(block);
+            stack.pop_back();
+            continue;
+        }
+        // the last successor is visited first, so the first comes first in the order
+        uint32_t next = succs[succs.size() - 1 - done++];
+        if (!seen[next]) {
+            seen[next] = true;
+            stack.emplace_back(next, 0);
+        }
+    }
+
+    std::vector<uint32_t> number(count);
+    std::vector<IrBlock> ordered;
+    ordered.reserve(postorder.size());
+    for (auto it = postorder.rbegin(); it != postorder.rend(); ++it) {
+        number[*it] = ordered.size();
+        ordered.push_back(std::move(blocks[*it]));
+    }
+    for (IrBlock& block : ordered) {
+        IrInstr& last = block.instrs.back();
+        if (last.op == IrOp::JMP || last.op == IrOp::BR) {
+            last.target = number[last.target];
+            last.other = number[last.other];
+        }
+    }
+    blocks = std::move(ordered);
+}
+
+static void printArg(std::ostream& out, IrArg arg) {
+    if (arg.isTemp()) out << '%' << arg.value;
+    else if (arg.isImm()) out << arg.value;
+}
+
+static void printInstr(std::ostream& out, const IrFunction& fun, const IrInstr& instr) {
+    out << "    ";
+    if (instr.dst >= 0) {
+        out << '%' << instr.dst << ": " << fun.temps[instr.dst] << " = ";
+    }
+    out << opName(instr.op);
+    switch (instr.op) {
+        case IrOp::EQ: case IrOp::NE: case IrOp::LT:
+        case IrOp::LE: case IrOp::GT: case IrOp::GE:
+        case IrOp::STORE:
+            out << ' ' << instr.type;
+            break;
+        default:
+            break;
+    }
+    switch (instr.op) {
+        case IrOp::STRING:
+            out << " $" << instr.index;
+            break;
+        case IrOp::LOAD:
+            out << " #" << instr.index << '[';
+            printArg(out, instr.a);
+            out << ']';
+            break;
+        case IrOp::STORE:
+            out << " #" << instr.index << '[';
+            printArg(out, instr.a);
+            out << "], ";
+            printArg(out, instr.b);
+            break;
+        case IrOp::CALL:
+        case IrOp::PRINT: {
+            if (instr.op == IrOp::CALL) out << ' ' << instr.callee << '(';
+            else out << " $" << instr.index << '(';
+            const char* separator = "";
+            for (IrArg arg : fun.argsOf(instr)) {
+                out << separator;
+                printArg(out, arg);
+                separator = ", ";
+            }
+            out << ')';
+            break;
+        }
+        case IrOp::JMP:
+            out << " b" << instr.target;
+            break;
+        case IrOp::BR:
+            out << ' ';
+            printArg(out, instr.a);
+            out << ", b" << instr.target << ", b" << instr.other;
+            break;
+        default:
+            if (instr.a.kind != IrArg::NONE) {
+                out << ' ';
+                printArg(out, instr.a);
+            }
+            if (instr.b.kind != IrArg::NONE) {
+                out << ", ";
+                printArg(out, instr.b);
+            }
+            break;
+    }
+    out << '\n';
+}
+
+void IrModule::print(std::ostream& out) const {
+    for (size_t i = 0; i < strings.size(); ++i) {
+        out << '$' << i << " = \"" << strings[i] << "\"\n";
+    }
+    for (const IrFunction& fun : functions) {
+        out << "\nfn " << fun.name << '(';
+        for (int p = 0; p < fun.params; ++p) {
+            out << (p ? ", %" : "%") << p << ": " << fun.temps[p];
+        }
+        out << ") -> " << fun.returnType << " {\n";
+        for (size_t f = 0; f < fun.frames.size(); ++f) {
+            out << "    #" << f << ": [" << fun.frames[f].type << "; " << fun.frames[f].size << "]\n";
+        }
+        for (size_t b = 0; b < fun.blocks.size(); ++b) {
+            out << "b" << b << ":\n";
+            for (const IrInstr& instr : fun.blocks[b].instrs) {
+                printInstr(out, fun, instr);
+            }
+        }
+        out << "}\n";
+    }
+}
+
+// checks one function, with where to say what is wrong
+class Verifier {
+public:
+    using Functions = std::unordered_map<Symbol, const IrFunction*>;
+
+    Verifier(const IrModule& module, const Functions& functions, const IrFunction& fun)
+        : module(module), functions(functions), fun(fun) {}
+
+    void verify() {
+        if (fun.params > int(fun.temps.size())) fail("more params than temps");
+        for (Value::Type type : fun.temps) {
+            if (!isScalar(type)) fail("a temp has no scalar type");
+        }
+        for (const IrFrame& frame : fun.frames) {
+            if (!isScalar(frame.type) || frame.size <= 0) fail("a frame object is not an array");
+        }
+        if (fun.blocks.empty()) fail("no blocks");
+        for (block = 0; block < fun.blocks.size(); ++block) {
+            const auto& instrs = fun.blocks[block].instrs;
+            if (instrs.empty() || !instrs.back().isTerminator()) fail("no terminator");
+            for (const IrInstr& instr : instrs) {
+                if (instr.isTerminator() && &instr != &instrs.back()) fail("terminator before the end");
+                check(instr);
+            }
+        }
+    }
+
+private:
+    const IrModule& module;
+    const Functions& functions;
+    const IrFunction& fun;
+    uint32_t block {};
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("invalid IR in " + fun.name.str() + ", block b" +
+                                 std::to_string(block) + ": " + what);
+    }
+
+    Value::Type typeOf(IrArg arg, Value::Type immType) const {
+        if (arg.isTemp()) {
+            if (arg.value < 0 || arg.value >= int64_t(fun.temps.size())) fail("no such temp");
+            return fun.temps[arg.value];
+        }
+        if (arg.isImm()) return immType;
+        fail("missing operand");
+    }
+
+    void expect(IrArg arg, Value::Type type) const {
+        if (typeOf(arg, type) != type) fail("operand of the wrong type");
+    }
+
+    Value::Type dstType(const IrInstr& instr) const {
+        if (instr.dst < 0 || instr.dst >= int(fun.temps.size())) fail("no result temp");
+        return fun.temps[instr.dst];
+    }
+
+    void checkBlock(uint32_t target) const {
+        if (target >= fun.blocks.size()) fail("jump to no block");
+    }
+
+    void check(const IrInstr& instr) const {
+        switch (instr.op) {
+            case IrOp::COPY:
+                expect(instr.a, dstType(instr));
+                break;
+            case IrOp::ADD: case IrOp::SUB: case IrOp::MUL: case IrOp::DIV:
+                if (!isInteger(instr.type) || dstType(instr) != instr.type) fail("arithmetic on no integer");
+                expect(instr.a, instr.type);
+                expect(instr.b, instr.type);
+                break;
+            case IrOp::EQ: case IrOp::NE: case IrOp::LT:
+            case IrOp::LE: case IrOp::GT: case IrOp::GE:
+                if (dstType(instr) != Value::BOOL) fail("comparison into no bool");
+                expect(instr.a, instr.type);
+                expect(instr.b, instr.type);
+                break;
+            case IrOp::NOT:
+                if (dstType(instr) != Value::BOOL) fail("not into no bool");
+                expect(instr.a, Value::BOOL);
+                break;
+            case IrOp::CAST:
+                if (!isInteger(dstType(instr)) && dstType(instr) != Value::CHAR) fail("cast to no number");
+                typeOf(instr.a, dstType(instr));
+                break;
+            case IrOp::STRING:
+                if (dstType(instr) != Value::STR) fail("string into no str");
+                if (instr.index >= module.strings.size()) fail("no such string");
+                break;
+            case IrOp::LOAD: case IrOp::STORE: {
+                if (instr.index >= fun.frames.size()) fail("no such frame object");
+                Value::Type element = fun.frames[instr.index].type;
+                if (!isInteger(typeOf(instr.a, Value::I64))) fail("index is no integer");
+                if (instr.op == IrOp::LOAD && dstType(instr) != element) fail("load of the wrong type");
+                if (instr.op == IrOp::STORE) expect(instr.b, element);
+                break;
+            }
+            case IrOp::CALL: {
+                if (instr.firstArg + instr.argCount > fun.args.size()) fail("arguments out of range");
+                auto found = functions.find(instr.callee);
+                if (found == functions.end()) fail("call to no fn");
+                const IrFunction& callee = *found->second;
+                if (int(instr.argCount) != callee.params) fail("wrong number of arguments");
+                auto args = fun.argsOf(instr);
+                for (int p = 0; p < callee.params; ++p) {
+                    expect(args[p], callee.temps[p]);
+                }
+                if (instr.dst >= 0 && dstType(instr) != callee.returnType) fail("call result of the wrong type");
+                break;
+            }
+            case IrOp::PRINT:
+                if (instr.firstArg + instr.argCount > fun.args.size()) fail("arguments out of range");
+                if (instr.index >= module.strings.size()) fail("no such format");
+                for (IrArg arg : fun.argsOf(instr)) {
+                    typeOf(arg, Value::I64);
+                }
+                break;
+            case IrOp::JMP:
+                checkBlock(instr.target);
+                break;
+            case IrOp::BR:
+                expect(instr.a, Value::BOOL);
+                checkBlock(instr.target);
+                checkBlock(instr.other);
+                break;
+            case IrOp::RET:
+                if (fun.returnType == Value::UNIT) {
+                    if (instr.a.kind != IrArg::NONE) fail("value returned from a unit fn");
+                }
+                else {
+                    expect(instr.a, fun.returnType);
+                }
+                break;
+        }
+    }
+};
+
+void IrModule::verify() const {
+    Verifier::Functions byName;
+    for (const IrFunction& fun : functions) {
+        byName.emplace(fun.name, &fun);
+    }
+    for (const IrFunction& fun : functions) {
+        Verifier(*this, byName, fun).verify();
+    }
+}
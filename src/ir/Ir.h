@@ -0,0 +1,147 @@
+#ifndef IR_H
+#define IR_H
+
+#include "../syntactic/Exp.h"
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+// Three-address code between the checked tree and the assembly. A function
+// is a list of basic blocks over numbered temporaries, each with a type;
+// the params are the first temps. A temp can be assigned more than once,
+// since the locals of the program live in them, so the code is not SSA.
+// Arrays live in frame objects, which only loads and stores reach. Every
+// block ends in exactly one terminator (jmp, br or ret), and the edges
+// those name are the control-flow graph.
+//
+// Integers are kept as the wrapped value of their type: every instruction
+// that makes an i8, i16 or i32 wraps its result to that width.
+
+enum class IrOp : uint8_t {
+    COPY,               // dst = a
+    ADD, SUB, MUL, DIV, // dst = a op b, all of type
+    EQ, NE, LT, LE, GT, GE, // dst: bool = a op b, with a and b of type
+    NOT,                // dst: bool = !a
+    CAST,               // dst: type = a, wrapped to type
+    STRING,             // dst: str = address of strings[index]
+    LOAD,               // dst: type = frames[index][a]
+    STORE,              // frames[index][a] = b: type
+    CALL,               // [dst: type =] callee(args)
+    PRINT,              // printf(strings[index], args)
+    JMP,                // to block target
+    BR,                 // to block target if a, else to block other
+    RET,                // [a: type]
+};
+
+// A temp, an immediate, or nothing. An immediate takes the type of the
+// instruction it is in.
+struct IrArg {
+    enum Kind : uint8_t {NONE, TEMP, IMM};
+
+    Kind kind {NONE};
+    int64_t value {};
+
+    static IrArg temp(int temp) { return {TEMP, temp}; }
+    static IrArg imm(int64_t value) { return {IMM, value}; }
+    bool isTemp() const { return kind == TEMP; }
+    bool isImm() const { return kind == IMM; }
+    bool operator==(const IrArg& other) const = default;
+};
+
+struct IrInstr {
+    // the fields past the operands are set by the instructions that use them
+    explicit IrInstr(IrOp op, Value::Type type = Value::UNIT, int dst = -1, IrArg a = {}, IrArg b = {})
+        : op(op), type(type), dst(dst), a(a), b(b) {}
+
+    IrOp op;
+    Value::Type type {Value::UNIT};
+    // temp written, or -1
+    int dst {-1};
+    IrArg a;
+    IrArg b;
+    // frame of a LOAD or STORE, string of a STRING or PRINT
+    uint32_t index {};
+    // blocks of a JMP or BR
+    uint32_t target {};
+    uint32_t other {};
+    Symbol callee {};
+    // arguments of a CALL or PRINT, in IrFunction::args
+    uint32_t firstArg {};
+    uint32_t argCount {};
+
+    bool isTerminator() const;
+};
+
+// the blocks a terminator goes to, held by value, as the passes ask for
+// them over and over
+struct IrSuccessors {
+    uint32_t blocks[2] {};
+    size_t count {};
+
+    const uint32_t* begin() const { return blocks; }
+    const uint32_t* end() const { return blocks + count; }
+    size_t size() const { return count; }
+    uint32_t operator[](size_t i) const { return blocks[i]; }
+};
+
+struct IrBlock {
+    std::vector<IrInstr> instrs;
+
+    const IrInstr& terminator() const { return instrs.back(); }
+    // the blocks the terminator goes to
+    IrSuccessors successors() const;
+};
+
+// an array in the stack frame
+struct IrFrame {
+    Value::Type type;
+    int size;
+};
+
+struct IrFunction {
+    Symbol name;
+    Value::Type returnType {Value::UNIT};
+    int params {};
+    // type of each temp
+    std::vector<Value::Type> temps;
+    std::vector<IrFrame> frames;
+    // the entry is block 0
+    std::vector<IrBlock> blocks;
+    std::vector<IrArg> args;
+
+    std::span<const IrArg> argsOf(const IrInstr& instr) const;
+    // calls f with each temp instr reads
+    template <class F>
+    void forEachUse(const IrInstr& instr, F f) const {
+        if (instr.a.isTemp()) f(int(instr.a.value));
+        if (instr.b.isTemp()) f(int(instr.b.value));
+        if (instr.op == IrOp::CALL || instr.op == IrOp::PRINT) {
+            for (IrArg arg : argsOf(instr)) {
+                if (arg.isTemp()) f(int(arg.value));
+            }
+        }
+    }
+    // predecessors of every block, in block order
+    std::vector<std::vector<uint32_t>> predecessors() const;
+    // Numbers the blocks reachable from the entry in reverse postorder, so a
+    // block mostly comes right after the one it falls out of, and drops the
+    // others: those that follow a return or a break, or a branch not taken.
+    void layOut();
+};
+
+struct IrModule {
+    std::vector<IrFunction> functions;
+    // string literals and print formats, as they go in the assembly
+    std::vector<std::string> strings;
+
+    void print(std::ostream& out) const;
+    // throws if a function breaks a rule of the IR, naming it
+    void verify() const;
+};
+
+// value wrapped to the width of an integer type; other types are unchanged
+int64_t wrapTo(Value::Type type, int64_t value);
+
+#endif
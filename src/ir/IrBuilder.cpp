@@ -0,0 +1,628 @@
+#include "IrBuilder.h"
+#include <algorithm>
+
+static bool isInteger(Value::Type type) {
+    return type == Value::I8 || type == Value::I16 ||
+           type == Value::I32 || type == Value::I64;
+}
+
+// types that have a value a temp can hold
+static bool hasValue(Value::Type type) {
+    return type != Value::UNIT && type != Value::UNDEFINED && type != Value::ID;
+}
+
+static int width(Value::Type type) {
+    switch (type) {
+        case Value::I8: return 1;
+        case Value::I16: return 2;
+        case Value::I32: return 4;
+        default: return 8;
+    }
+}
+
+// the type two operands of a comparison are compared at
+static Value::Type comparedAs(Value::Type a, Value::Type b) {
+    if (isInteger(a) && isInteger(b)) return width(a) >= width(b) ? a : b;
+    return a;
+}
+
+// an expression whose evaluation writes no local, so the value of one
+// evaluated before it needs no copy
+static bool writesNoLocal(Exp* exp) {
+    return exp->getKind() == Exp::LITERAL || exp->getKind() == Exp::VARIABLE;
+}
+
+static bool writesNoLocal(std::span<Exp* const> exps) {
+    return std::all_of(exps.begin(), exps.end(), [](Exp* exp) { return writesNoLocal(exp); });
+}
+
+IrBuilder::~IrBuilder() = default;
+
+void IrBuilder::unsupported(const std::string& what, int line, int col) {
+    throw IrUnsupported(what + " not supported by the IR at " +
+                             std::to_string(line) + ':' + std::to_string(col));
+}
+
+int IrBuilder::newTemp(Value::Type type) {
+    if (!hasValue(type)) return -1;
+    fun->temps.push_back(type);
+    isLocal.push_back(false);
+    return fun->temps.size() - 1;
+}
+
+uint32_t IrBuilder::newBlock() {
+    fun->blocks.emplace_back();
+    return fun->blocks.size() - 1;
+}
+
+void IrBuilder::setBlock(uint32_t block) {
+    current = block;
+}
+
+void IrBuilder::emit(IrInstr instr) {
+    fun->blocks[current].instrs.push_back(instr);
+}
+
+IrArg IrBuilder::emit(IrOp op, Value::Type type, IrArg a, IrArg b) {
+    bool boolean = op >= IrOp::EQ && op <= IrOp::NOT;
+    IrInstr instr(op, type, newTemp(boolean ? Value::BOOL : type), a, b);
+    emit(instr);
+    return IrArg::temp(instr.dst);
+}
+
+void IrBuilder::jump(uint32_t block) {
+    IrInstr instr(IrOp::JMP);
+    instr.target = block;
+    emit(instr);
+}
+
+void IrBuilder::branch(IrArg cond, uint32_t target, uint32_t other) {
+    IrInstr instr(IrOp::BR, Value::BOOL, -1, cond);
+    instr.target = target;
+    instr.other = other;
+    emit(instr);
+}
+
+void IrBuilder::copy(int temp, IrArg value) {
+    if (temp < 0 || value.kind == IrArg::NONE) return;
+    emit(IrInstr(IrOp::COPY, fun->temps[temp], temp, value));
+}
+
+IrArg IrBuilder::keep(IrArg value) {
+    if (!value.isTemp() || !isLocal[value.value]) return value;
+    int temp = newTemp(fun->temps[value.value]);
+    copy(temp, value);
+    return IrArg::temp(temp);
+}
+
+uint32_t IrBuilder::addArgs(const std::vector<IrArg>& args) {
+    uint32_t first = fun->args.size();
+    fun->args.insert(fun->args.end(), args.begin(), args.end());
+    return first;
+}
+
+uint32_t IrBuilder::string(const std::string& text) {
+    auto [it, inserted] = strings.emplace(text, ir.strings.size());
+    if (inserted) ir.strings.push_back(text);
+    return it->second;
+}
+
+IrArg IrBuilder::cast(IrArg value, Value::Type from, Value::Type to) {
+    if (!hasValue(to)) return {};
+    if (from == to || !isInteger(from) || !isInteger(to) || value.kind == IrArg::NONE) return value;
+    if (value.isImm()) return IrArg::imm(wrapTo(to, value.value));
+    return emit(IrOp::CAST, to, value);
+}
+
+IrArg IrBuilder::value(Exp* exp, Value::Type type) {
+    Value v = dispatch(exp);
+    return cast(result, v.type, type);
+}
+
+IrArg IrBuilder::arithmetic(BinaryExp::Operation op, Value::Type type, IrArg a, IrArg b, int dst) {
+    IrOp irOp;
+    switch (op) {
+        case BinaryExp::PLUS: irOp = IrOp::ADD; break;
+        case BinaryExp::MINUS: irOp = IrOp::SUB; break;
+        case BinaryExp::TIMES: irOp = IrOp::MUL; break;
+        case BinaryExp::DIV: irOp = IrOp::DIV; break;
+        default: throw std::runtime_error("Invalid binary operation");
+    }
+    if (dst < 0) return emit(irOp, type, a, b);
+    emit(IrInstr(irOp, type, dst, a, b));
+    return IrArg::temp(dst);
+}
+
+int IrBuilder::frameOf(int slot, int line, int col) const {
+    if (slot < 0 || locals[slot].frame < 0) unsupported("subscript of no array", line, col);
+    return locals[slot].frame;
+}
+
+void IrBuilder::storeElement(int frame, IrArg index, IrArg value) {
+    IrInstr store(IrOp::STORE, fun->frames[frame].type, -1, index, value);
+    store.index = frame;
+    emit(store);
+}
+
+// emits a loop over 0..size, with body(index) as its body
+template <class Body>
+void IrBuilder::countTo(int size, Body body) {
+    int index = newTemp(Value::I64);
+    copy(index, IrArg::imm(0));
+    uint32_t header = newBlock(), loop = newBlock(), exit = newBlock();
+    jump(header);
+    setBlock(header);
+    branch(emit(IrOp::LT, Value::I64, IrArg::temp(index), IrArg::imm(size)), loop, exit);
+    setBlock(loop);
+    body(IrArg::temp(index));
+    arithmetic(BinaryExp::PLUS, Value::I64, IrArg::temp(index), IrArg::imm(1), index);
+    jump(header);
+    setBlock(exit);
+}
+
+void IrBuilder::storeArray(int frame, Exp* exp) {
+    IrFrame target = fun->frames[frame];
+    switch (exp->getKind()) {
+        case Exp::ARRAY: {
+            // every element is evaluated before any is stored, as one may read the array
+            auto* array = static_cast<ArrayExp*>(exp);
+            std::vector<IrArg> elements;
+            for (size_t i = 0; i < array->elements.size(); ++i) {
+                IrArg element = value(array->elements[i], target.type);
+                auto rest = std::span<Exp* const>(array->elements).subspan(i + 1);
+                elements.push_back(writesNoLocal(rest) ? element : keep(element));
+            }
+            for (size_t i = 0; i < elements.size() && int(i) < target.size; ++i) {
+                storeElement(frame, IrArg::imm(i), elements[i]);
+            }
+            break;
+        }
+        case Exp::UNIFORM_ARRAY: {
+            IrArg element = value(static_cast<UniformArrayExp*>(exp)->value, target.type);
+            countTo(target.size, [&](IrArg index) { storeElement(frame, index, element); });
+            break;
+        }
+        case Exp::VARIABLE: {
+            auto* variable = static_cast<Variable*>(exp);
+            int source = frameOf(variable->slot, exp->line, exp->col);
+            if (source == frame) break;
+            int size = std::min(target.size, fun->frames[source].size);
+            countTo(size, [&](IrArg index) {
+                IrInstr load(IrOp::LOAD, target.type, newTemp(target.type), index);
+                load.index = source;
+                emit(load);
+                storeElement(frame, index, IrArg::temp(load.dst));
+            });
+            break;
+        }
+        default:
+            unsupported("an array that is not a literal or a variable", exp->line, exp->col);
+    }
+}
+
+void IrBuilder::visit(Program* program) {
+    ir = IrModule();
+    strings.clear();
+    funs.clear();
+    trueString = string("true");
+    falseString = string("false");
+    for (auto [id, f] : program->funs) {
+        funs.emplace(id, f);
+    }
+    ir.functions.reserve(program->funs.size());
+    for (auto [id, f] : program->funs) {
+        fun = &ir.functions.emplace_back();
+        fun->name = id;
+        dispatch(f);
+    }
+    fun = nullptr;
+}
+
+Value IrBuilder::visit(Fun* f) {
+    fun->returnType = hasValue(f->type) ? f->type : Value::UNIT;
+    fun->params = f->params.size();
+    locals.assign(f->slots, Local());
+    loops.clear();
+    isLocal.clear();
+    for (size_t i = 0; i < f->params.size(); ++i) {
+        if (!hasValue(f->params[i].type)) unsupported("a param of no value", f->params[i].line, f->params[i].col);
+        locals[i].temp = newTemp(f->params[i].type);
+        isLocal[i] = true;
+    }
+    setBlock(newBlock());
+
+    // the value of the body, if any, is what falls out of it
+    Value body = dispatch(f->block);
+    IrInstr ret(IrOp::RET, fun->returnType);
+    if (fun->returnType != Value::UNIT) {
+        ret.a = result.kind != IrArg::NONE ? cast(result, body.type, fun->returnType) : IrArg::imm(0);
+    }
+    emit(ret);
+    fun->layOut();
+    return {};
+}
+
+Value IrBuilder::visit(Block* block) {
+    Value last(Value::UNIT);
+    result = {};
+    for (auto stmt : block->stmts) {
+        last = dispatch(stmt);
+    }
+    return last;
+}
+
+Value IrBuilder::visit(BinaryExp* exp) {
+    switch (exp->op) {
+        case BinaryExp::LAND:
+        case BinaryExp::LOR: {
+            int both = newTemp(Value::BOOL);
+            copy(both, value(exp->lhs, Value::BOOL));
+            uint32_t rhs = newBlock(), done = newBlock();
+            if (exp->op == BinaryExp::LAND) branch(IrArg::temp(both), rhs, done);
+            else branch(IrArg::temp(both), done, rhs);
+            setBlock(rhs);
+            copy(both, value(exp->rhs, Value::BOOL));
+            jump(done);
+            setBlock(done);
+            result = IrArg::temp(both);
+            return Value(Value::BOOL);
+        }
+        case BinaryExp::PLUS: case BinaryExp::MINUS:
+        case BinaryExp::TIMES: case BinaryExp::DIV: {
+            IrArg a = value(exp->lhs, exp->type);
+            if (!writesNoLocal(exp->rhs)) a = keep(a);
+            IrArg b = value(exp->rhs, exp->type);
+            result = arithmetic(exp->op, exp->type, a, b);
+            return Value(exp->type);
+        }
+        default: {
+            Value lhs = dispatch(exp->lhs);
+            IrArg a = writesNoLocal(exp->rhs) ? result : keep(result);
+            Value rhs = dispatch(exp->rhs);
+            IrArg b = result;
+            Value::Type type = comparedAs(lhs.type, rhs.type);
+            a = cast(a, lhs.type, type);
+            b = cast(b, rhs.type, type);
+            IrOp op;
+            switch (exp->op) {
+                case BinaryExp::EQ: op = IrOp::EQ; break;
+                case BinaryExp::NEQ: op = IrOp::NE; break;
+                case BinaryExp::LT: op = IrOp::LT; break;
+                case BinaryExp::LE: op = IrOp::LE; break;
+                case BinaryExp::GT: op = IrOp::GT; break;
+                case BinaryExp::GE: op = IrOp::GE; break;
+                default: throw std::runtime_error("Invalid binary operation");
+            }
+            result = emit(op, type, a, b);
+            return Value(Value::BOOL);
+        }
+    }
+}
+
+Value IrBuilder::visit(UnaryExp* exp) {
+    switch (exp->op) {
+        case UnaryExp::LNOT:
+            result = emit(IrOp::NOT, Value::BOOL, value(exp->exp, Value::BOOL));
+            return Value(Value::BOOL);
+        default:
+            throw std::runtime_error("Invalid unary operation");
+    }
+}
+
+Value IrBuilder::visit(Literal* exp) {
+    switch (exp->value.type) {
+        case Value::STR: {
+            IrInstr instr(IrOp::STRING, Value::STR, newTemp(Value::STR));
+            instr.index = string(exp->value.text.str());
+            emit(instr);
+            result = IrArg::temp(instr.dst);
+            break;
+        }
+        case Value::UNIT:
+            result = {};
+            break;
+        default:
+            result = IrArg::imm(exp->value.scalar);
+            break;
+    }
+    return Value(exp->value.type);
+}
+
+Value IrBuilder::visit(Variable* exp) {
+    if (exp->slot < 0) unsupported("a fn used as a value", exp->line, exp->col);
+    const Local& local = locals[exp->slot];
+    if (local.frame >= 0) unsupported("an array used as a value", exp->line, exp->col);
+    if (local.temp < 0) {
+        result = {};
+        return Value(Value::UNIT);
+    }
+    result = IrArg::temp(local.temp);
+    return Value(fun->temps[local.temp]);
+}
+
+Value IrBuilder::visit(FunCall* exp) {
+    Fun* callee = funs.at(exp->id);
+    std::vector<IrArg> args;
+    for (size_t i = 0; i < exp->args.size(); ++i) {
+        IrArg arg = value(exp->args[i], callee->params[i].type);
+        auto rest = std::span<Exp* const>(exp->args).subspan(i + 1);
+        args.push_back(writesNoLocal(rest) ? arg : keep(arg));
+    }
+    Value::Type type = hasValue(callee->type) ? callee->type : Value::UNIT;
+    IrInstr call(IrOp::CALL, type, newTemp(type));
+    call.callee = exp->id;
+    call.firstArg = addArgs(args);
+    call.argCount = args.size();
+    emit(call);
+    result = call.dst >= 0 ? IrArg::temp(call.dst) : IrArg();
+    return Value(type);
+}
+
+Value IrBuilder::visit(IfExp* exp) {
+    int both = newTemp(exp->type);
+    uint32_t done = newBlock();
+    // the value of a branch, which is the value of the if
+    auto take = [&](Value branch) {
+        copy(both, cast(result, branch.type, exp->type));
+        jump(done);
+    };
+
+    std::vector<IfExp::IfBranch*> branches {exp->ifBranch};
+    branches.insert(branches.end(), exp->elseIfBranches.begin(), exp->elseIfBranches.end());
+    for (auto br : branches) {
+        IrArg cond = value(br->cond, Value::BOOL);
+        uint32_t then = newBlock(), next = newBlock();
+        branch(cond, then, next);
+        setBlock(then);
+        take(dispatch(br->block));
+        setBlock(next);
+    }
+    if (exp->elseBranch) {
+        take(dispatch(exp->elseBranch->block));
+    }
+    else {
+        jump(done);
+    }
+    setBlock(done);
+    result = both >= 0 ? IrArg::temp(both) : IrArg();
+    return Value(both >= 0 ? exp->type : Value::UNIT);
+}
+
+Value IrBuilder::visit(LoopExp* exp) {
+    int both = newTemp(exp->type);
+    uint32_t body = newBlock(), exit = newBlock();
+    jump(body);
+    setBlock(body);
+    loops.push_back({exit, both});
+    dispatch(exp->block);
+    loops.pop_back();
+    jump(body);
+    setBlock(exit);
+    result = both >= 0 ? IrArg::temp(both) : IrArg();
+    return Value(both >= 0 ? exp->type : Value::UNIT);
+}
+
+Value IrBuilder::visit(SubscriptExp* exp) {
+    int frame = frameOf(exp->slot, exp->line, exp->col);
+    Value::Type type = fun->frames[frame].type;
+    dispatch(exp->exp);
+    IrInstr load(IrOp::LOAD, type, newTemp(type), result);
+    load.index = frame;
+    emit(load);
+    result = IrArg::temp(load.dst);
+    return Value(type);
+}
+
+Value IrBuilder::visit(SliceExp* exp) {
+    unsupported("a slice", exp->line, exp->col);
+}
+
+Value IrBuilder::visit(ReferenceExp* exp) {
+    // a reference reads as the value it refers to
+    return dispatch(exp->exp);
+}
+
+Value IrBuilder::visit(ArrayExp* exp) {
+    unsupported("an array outside a let or an assignment", exp->line, exp->col);
+}
+
+Value IrBuilder::visit(UniformArrayExp* exp) {
+    unsupported("an array outside a let or an assignment", exp->line, exp->col);
+}
+
+Value IrBuilder::visit(DecStmt* stmt) {
+    Local& local = locals[stmt->slot];
+    if (stmt->var.size > 0) {
+        local.frame = fun->frames.size();
+        fun->frames.push_back({stmt->var.type, stmt->var.size});
+        if (stmt->rhs) storeArray(local.frame, stmt->rhs);
+    }
+    else {
+        IrArg rhs;
+        if (stmt->rhs) rhs = value(stmt->rhs, stmt->var.type);
+        local.temp = newTemp(stmt->var.type);
+        if (local.temp >= 0) isLocal[local.temp] = true;
+        copy(local.temp, rhs);
+    }
+    result = {};
+    return Value(Value::UNIT);
+}
+
+Value IrBuilder::visit(AssignStmt* stmt) {
+    // the value is evaluated before the place it goes to, as in Rust
+    if (stmt->lhs->getKind() == Exp::SUBSCRIPT) {
+        auto* lhs = static_cast<SubscriptExp*>(stmt->lhs);
+        int frame = frameOf(lhs->slot, lhs->line, lhs->col);
+        IrArg rhs = value(stmt->rhs, fun->frames[frame].type);
+        if (!writesNoLocal(lhs->exp)) rhs = keep(rhs);
+        dispatch(lhs->exp);
+        storeElement(frame, result, rhs);
+    }
+    else {
+        auto* lhs = static_cast<Variable*>(stmt->lhs);
+        if (lhs->slot < 0) unsupported("an assignment to a fn", lhs->line, lhs->col);
+        const Local& local = locals[lhs->slot];
+        if (local.frame >= 0) {
+            storeArray(local.frame, stmt->rhs);
+        }
+        else if (local.temp >= 0) {
+            copy(local.temp, value(stmt->rhs, fun->temps[local.temp]));
+        }
+        else {
+            dispatch(stmt->rhs);
+        }
+    }
+    result = {};
+    return Value(Value::UNIT);
+}
+
+Value IrBuilder::visit(CompoundAssignStmt* stmt) {
+    Value rhs = dispatch(stmt->rhs);
+    IrArg operand = result;
+    if (stmt->lhs->getKind() == Exp::SUBSCRIPT) {
+        auto* lhs = static_cast<SubscriptExp*>(stmt->lhs);
+        int frame = frameOf(lhs->slot, lhs->line, lhs->col);
+        Value::Type type = fun->frames[frame].type;
+        operand = cast(operand, rhs.type, type);
+        if (!writesNoLocal(lhs->exp)) operand = keep(operand);
+        dispatch(lhs->exp);
+        IrArg index = result;
+        IrInstr load(IrOp::LOAD, type, newTemp(type), index);
+        load.index = frame;
+        emit(load);
+        storeElement(frame, index, arithmetic(stmt->op, type, IrArg::temp(load.dst), operand));
+    }
+    else {
+        auto* lhs = static_cast<Variable*>(stmt->lhs);
+        if (lhs->slot < 0 || locals[lhs->slot].temp < 0) unsupported("a compound assignment to no number", lhs->line, lhs->col);
+        int temp = locals[lhs->slot].temp;
+        Value::Type type = fun->temps[temp];
+        arithmetic(stmt->op, type, IrArg::temp(temp), cast(operand, rhs.type, type), temp);
+    }
+    result = {};
+    return Value(Value::UNIT);
+}
+
+Value IrBuilder::visit(ForStmt* stmt) {
+    // the range is evaluated once, before the first iteration
+    Value start = dispatch(stmt->start);
+    IrArg first = writesNoLocal(stmt->end) ? result : keep(result);
+    Value end = dispatch(stmt->end);
+    IrArg last = keep(result);
+    Value::Type type = comparedAs(start.type, end.type);
+    first = cast(first, start.type, type);
+    last = cast(last, end.type, type);
+
+    int index = newTemp(type);
+    locals[stmt->slot].temp = index;
+    isLocal[index] = true;
+    copy(index, first);
+
+    uint32_t header = newBlock(), body = newBlock(), exit = newBlock();
+    jump(header);
+    setBlock(header);
+    branch(emit(stmt->inclusive ? IrOp::LE : IrOp::LT, type, IrArg::temp(index), last), body, exit);
+    setBlock(body);
+    loops.push_back({exit, -1});
+    dispatch(stmt->block);
+    loops.pop_back();
+    arithmetic(BinaryExp::PLUS, type, IrArg::temp(index), IrArg::imm(1), index);
+    jump(header);
+    setBlock(exit);
+    result = {};
+    return Value(Value::UNIT);
+}
+
+Value IrBuilder::visit(WhileStmt* stmt) {
+    uint32_t header = newBlock(), body = newBlock(), exit = newBlock();
+    jump(header);
+    setBlock(header);
+    branch(value(stmt->cond, Value::BOOL), body, exit);
+    setBlock(body);
+    loops.push_back({exit, -1});
+    dispatch(stmt->block);
+    loops.pop_back();
+    jump(header);
+    setBlock(exit);
+    result = {};
+    return Value(Value::UNIT);
+}
+
+Value IrBuilder::visit(PrintStmt* stmt) {
+    std::vector<IrArg> args;
+    for (size_t i = 0; i < stmt->args.size(); ++i) {
+        Value v = dispatch(stmt->args[i]);
+        IrArg arg = result;
+        if (v.type == Value::BOOL) {
+            // printed as the text of the value
+            int text = newTemp(Value::STR);
+            IrInstr yes(IrOp::STRING, Value::STR, text), no(IrOp::STRING, Value::STR, text);
+            yes.index = trueString;
+            no.index = falseString;
+            if (arg.isImm()) {
+                emit(arg.value ? yes : no);
+            }
+            else {
+                uint32_t isTrue = newBlock(), isFalse = newBlock(), done = newBlock();
+                branch(arg, isTrue, isFalse);
+                setBlock(isTrue);
+                emit(yes);
+                jump(done);
+                setBlock(isFalse);
+                emit(no);
+                jump(done);
+                setBlock(done);
+            }
+            arg = IrArg::temp(text);
+        }
+        auto rest = std::span<Exp* const>(stmt->args).subspan(i + 1);
+        args.push_back(writesNoLocal(rest) ? arg : keep(arg));
+    }
+    IrInstr print(IrOp::PRINT);
+    print.index = string(stmt->format);
+    print.firstArg = addArgs(args);
+    print.argCount = args.size();
+    emit(print);
+    result = {};
+    return Value(Value::UNIT);
+}
+
+Value IrBuilder::visit(BreakStmt* stmt) {
+    if (loops.empty()) unsupported("a break outside of a loop", stmt->line, stmt->col);
+    Loop loop = loops.back();
+    if (stmt->exp) {
+        Value v = dispatch(stmt->exp);
+        if (loop.result >= 0) copy(loop.result, cast(result, v.type, fun->temps[loop.result]));
+    }
+    jump(loop.exit);
+    // what follows the break is not reached
+    setBlock(newBlock());
+    result = {};
+    return Value(Value::UNIT);
+}
+
+Value IrBuilder::visit(ReturnStmt* stmt) {
+    IrInstr ret(IrOp::RET, fun->returnType);
+    if (stmt->exp) {
+        IrArg value = this->value(stmt->exp, fun->returnType);
+        if (fun->returnType != Value::UNIT) ret.a = value;
+    }
+    else if (fun->returnType != Value::UNIT) {
+        ret.a = IrArg::imm(0);
+    }
+    emit(ret);
+    setBlock(newBlock());
+    result = {};
+    return Value(Value::UNIT);
+}
+
+Value IrBuilder::visit(ExpStmt* stmt) {
+    result = {};
+    if (!stmt->exp) return Value(Value::UNIT);
+    Value v = dispatch(stmt->exp);
+    if (!stmt->returnValue) {
+        result = {};
+        return Value(Value::UNIT);
+    }
+    return v;
+}
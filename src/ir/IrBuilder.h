@@ -0,0 +1,106 @@
+#ifndef IRBUILDER_H
+#define IRBUILDER_H
+
+#include "Ir.h"
+#include "../semantic/Visitor.h"
+#include <stdexcept>
+#include <unordered_map>
+
+// thrown for a construct the IR does not translate yet
+class IrUnsupported : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Translates a checked program to IR. Each visit of an expression leaves
+// its value in result, as CodeGen leaves it in %rax, and returns its type;
+// && and || only evaluate their right side when they need it, as in Rust.
+// Slices, subscripts of a str and arrays anywhere but the value of a let or
+// an assignment are not translated, and throw IrUnsupported.
+class IrBuilder final : public PassVisitor<IrBuilder> {
+public:
+    IrBuilder() : PassVisitor(&unused) {}
+    ~IrBuilder() override;
+
+    // the IR of the last program visited
+    IrModule& module() { return ir; }
+
+    Value visit(Block* block) override;
+    Value visit(BinaryExp* exp) override;
+    Value visit(UnaryExp* exp) override;
+    Value visit(Literal* exp) override;
+    Value visit(Variable* exp) override;
+    Value visit(FunCall* exp) override;
+    Value visit(IfExp* exp) override;
+    Value visit(LoopExp* exp) override;
+    Value visit(SubscriptExp* exp) override;
+    Value visit(SliceExp* exp) override;
+    Value visit(ReferenceExp* exp) override;
+    Value visit(ArrayExp* exp) override;
+    Value visit(UniformArrayExp* exp) override;
+    Value visit(DecStmt* stmt) override;
+    Value visit(AssignStmt* stmt) override;
+    Value visit(CompoundAssignStmt* stmt) override;
+    Value visit(ForStmt* stmt) override;
+    Value visit(WhileStmt* stmt) override;
+    Value visit(PrintStmt* stmt) override;
+    Value visit(BreakStmt* stmt) override;
+    Value visit(ReturnStmt* stmt) override;
+    Value visit(ExpStmt* stmt) override;
+    Value visit(Fun* fun) override;
+    void visit(Program* program) override;
+
+private:
+    // where a local of the source lives: a temp, or a frame object for an array
+    struct Local {
+        int temp {-1};
+        int frame {-1};
+    };
+    struct Loop {
+        uint32_t exit;
+        // temp a break with a value writes, or -1
+        int result;
+    };
+
+    SymbolTable unused;
+    IrModule ir;
+    IrFunction* fun {};
+    uint32_t current {};
+    IrArg result;
+    std::vector<Local> locals;
+    // whether each temp holds a local
+    std::vector<bool> isLocal;
+    std::vector<Loop> loops;
+    std::unordered_map<Symbol, Fun*> funs;
+    std::unordered_map<std::string, uint32_t> strings;
+    uint32_t trueString {};
+    uint32_t falseString {};
+
+    int newTemp(Value::Type type);
+    uint32_t newBlock();
+    void setBlock(uint32_t block);
+    void emit(IrInstr instr);
+    IrArg emit(IrOp op, Value::Type type, IrArg a, IrArg b = {});
+    void jump(uint32_t block);
+    void branch(IrArg cond, uint32_t target, uint32_t other);
+    void copy(int temp, IrArg value);
+    // value, copied if a local holds it, to read it after code that may write the local
+    IrArg keep(IrArg value);
+    uint32_t addArgs(const std::vector<IrArg>& args);
+    uint32_t string(const std::string& text);
+
+    // the value of exp as type
+    IrArg value(Exp* exp, Value::Type type);
+    IrArg cast(IrArg value, Value::Type from, Value::Type to);
+    // fills a frame object with the array exp stands for
+    void storeArray(int frame, Exp* exp);
+    void storeElement(int frame, IrArg index, IrArg value);
+    template <class Body>
+    void countTo(int size, Body body);
+    // into dst, or a new temp if it is -1
+    IrArg arithmetic(BinaryExp::Operation op, Value::Type type, IrArg a, IrArg b, int dst = -1);
+    int frameOf(int slot, int line, int col) const;
+    [[noreturn]] static void unsupported(const std::string& what, int line, int col);
+};
+
+#endif
@@ -0,0 +1,373 @@
+#include "IrLowering.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// registers the arguments of a call go in, in order
+static constexpr Register ARGS[] = {DI, SI, DX, CX, R8, R9};
+
+static bool isComparison(IrOp op) {
+    return op >= IrOp::EQ && op <= IrOp::GE;
+}
+
+static C condition(IrOp op) {
+    switch (op) {
+        case IrOp::EQ: return EQ;
+        case IrOp::NE: return NE;
+        case IrOp::LT: return LT;
+        case IrOp::LE: return LE;
+        case IrOp::GT: return GT;
+        case IrOp::GE: return GE;
+        default: throw std::runtime_error("Invalid comparison");
+    }
+}
+
+static C negate(C cond) {
+    switch (cond) {
+        case EQ: return NE;
+        case NE: return EQ;
+        case LT: return GE;
+        case LE: return GT;
+        case GT: return LE;
+        case GE: return LT;
+        default: throw std::runtime_error("Invalid condition");
+    }
+}
+
+static bool fitsImm(int64_t value) {
+    return value >= std::numeric_limits<int32_t>::min() &&
+           value <= std::numeric_limits<int32_t>::max();
+}
+
+static bool same(const Operand& a, const Operand& b) {
+    return a.kind == b.kind && a.reg == b.reg && a.value == b.value &&
+           a.label == b.label && a.index == b.index;
+}
+
+static std::string stringLabel(uint32_t index) {
+    return ".LS" + std::to_string(index);
+}
+
+IrLowering::IrLowering(std::ostream& out) : out(out) {}
+
+std::string IrLowering::label(uint32_t block) const {
+    return ".LI" + std::to_string(funIndex) + '_' + std::to_string(block);
+}
+
+Operand IrLowering::location(int temp) const {
+    const Location& loc = allocation.temps[temp];
+    if (loc.kind == Location::REG) return reg(loc.reg);
+    // the saved registers come first in the frame, then the spilled temps
+    return mem(BP, -8 * int(allocation.saved.size() + loc.slot + 1));
+}
+
+Operand IrLowering::operand(IrArg arg, Register scratch) {
+    if (arg.isTemp()) return location(arg.value);
+    if (fitsImm(arg.value)) return imm(arg.value);
+    out << "movabsq " << imm(arg.value) << ", " << reg(scratch) << '\n';
+    return reg(scratch);
+}
+
+Register IrLowering::target(int dst) const {
+    Operand loc = location(dst);
+    return loc.kind == Operand::REG ? loc.reg : AX;
+}
+
+Operand IrLowering::element(uint32_t frame, IrArg index) {
+    if (index.isImm()) return mem(BP, frames[frame] + 8 * int(index.value));
+    Operand at = location(index.value);
+    if (at.kind != Operand::REG) {
+        move(at, reg(CX));
+        at = reg(CX);
+    }
+    return mem(BP, frames[frame], at.reg, 8);
+}
+
+void IrLowering::move(Operand src, Operand dst) {
+    if (same(src, dst)) return;
+    if (src.kind == Operand::MEM && dst.kind == Operand::MEM) {
+        out.instruction(AsmWriter::MOV, Q, src, reg(AX));
+        src = reg(AX);
+    }
+    out.instruction(AsmWriter::MOV, Q, src, dst);
+}
+
+void IrLowering::parallelMove(std::vector<Move> moves) {
+    std::erase_if(moves, [](const Move& m) { return same(m.src, m.dst); });
+    auto isRead = [&](const Operand& dst) {
+        return std::any_of(moves.begin(), moves.end(), [&](const Move& m) {
+            return same(m.src, dst);
+        });
+    };
+    while (!moves.empty()) {
+        auto ready = std::find_if(moves.begin(), moves.end(), [&](const Move& m) {
+            return !isRead(m.dst);
+        });
+        if (ready != moves.end()) {
+            move(ready->src, ready->dst);
+            moves.erase(ready);
+            continue;
+        }
+        // every destination is still to be read: the first one is kept in %rax
+        Operand kept = moves.front().dst;
+        move(kept, reg(AX));
+        for (Move& m : moves) {
+            if (same(m.src, kept)) m.src = reg(AX);
+        }
+    }
+}
+
+void IrLowering::wrap(Value::Type type, Register r) {
+    switch (type) {
+        case Value::I8: out.extend(true, reg(r, B), reg(r, Q)); break;
+        case Value::I16: out.extend(true, reg(r, W), reg(r, Q)); break;
+        case Value::I32: out.extend(true, reg(r, D), reg(r, Q)); break;
+        default: break;
+    }
+}
+
+void IrLowering::lower(const IrModule& module) {
+    out << ".section .rodata\n";
+    for (uint32_t i = 0; i < module.strings.size(); ++i) {
+        out << stringLabel(i) << ":\n";
+        out << ".string \"" << module.strings[i] << "\"\n";
+    }
+    for (funIndex = 0; funIndex < module.functions.size(); ++funIndex) {
+        lower(module.functions[funIndex]);
+    }
+    out << ".section .note.GNU-stack,\"\",@progbits\n";
+    out.flush();
+}
+
+void IrLowering::lower(const IrFunction& function) {
+    fun = &function;
+    allocation = allocateRegisters(function);
+    uses.assign(function.temps.size(), 0);
+    for (const IrBlock& block : function.blocks) {
+        for (const IrInstr& instr : block.instrs) {
+            function.forEachUse(instr, [&](int temp) { ++uses[temp]; });
+        }
+    }
+
+    int size = 8 * (allocation.saved.size() + allocation.slots);
+    frames.clear();
+    for (const IrFrame& frame : function.frames) {
+        size += 8 * frame.size;
+        frames.push_back(-size);
+    }
+    // keeps %rsp 16-byte aligned at calls
+    size = (size + 15) & ~15;
+
+    out << ".text\n";
+    out << ".globl " << function.name << '\n';
+    out << ".type " << function.name << ", @function\n";
+    out << function.name << ":\n";
+    out.instruction(AsmWriter::PUSH, Q, reg(BP));
+    out.instruction(AsmWriter::MOV, Q, reg(SP), reg(BP));
+    if (size) out.instruction(AsmWriter::SUB, Q, imm(size), reg(SP));
+    for (size_t i = 0; i < allocation.saved.size(); ++i) {
+        out.instruction(AsmWriter::MOV, Q, reg(allocation.saved[i]), mem(BP, -8 * int(i + 1)));
+    }
+    // the params past the registers were pushed by the caller, above the return address
+    std::vector<Move> params;
+    for (int p = 0; p < function.params; ++p) {
+        if (allocation.temps[p].kind == Location::NONE) continue;
+        int stacked = p - int(std::size(ARGS));
+        params.push_back({stacked < 0 ? reg(ARGS[p]) : mem(BP, 16 + 8 * stacked), location(p)});
+    }
+    parallelMove(params);
+
+    for (uint32_t b = 0; b < function.blocks.size(); ++b) {
+        out << label(b) << ":\n";
+        const auto& instrs = function.blocks[b].instrs;
+        for (size_t i = 0; i < instrs.size(); ++i) {
+            const IrInstr& instr = instrs[i];
+            if (isComparison(instr.op) && i + 1 < instrs.size() && instrs[i + 1].op == IrOp::BR &&
+                instrs[i + 1].a == IrArg::temp(instr.dst) && uses[instr.dst] == 1) {
+                compare(instr);
+                branch(instrs[++i], condition(instr.op), b + 1);
+                continue;
+            }
+            lower(instr, b + 1);
+        }
+    }
+}
+
+// sets the flags from the operands of a comparison
+void IrLowering::compare(const IrInstr& instr) {
+    Operand a = operand(instr.a, AX);
+    Operand b = operand(instr.b, CX);
+    if (a.kind == Operand::CONST || (a.kind == Operand::MEM && b.kind == Operand::MEM)) {
+        move(a, reg(AX));
+        a = reg(AX);
+    }
+    out.instruction(AsmWriter::CMP, Q, b, a);
+}
+
+// jumps to the target of instr if cond holds, else to its other block
+void IrLowering::branch(const IrInstr& instr, C cond, uint32_t next) {
+    if (instr.target == next) {
+        out.jump(negate(cond), label(instr.other));
+        return;
+    }
+    out.jump(cond, label(instr.target));
+    if (instr.other != next) out.jump(NONE, label(instr.other));
+}
+
+// the arguments go in the registers from ARGS[firstReg] on, and the rest
+// on the stack, the first of them lowest
+int IrLowering::call(const IrInstr& instr, int firstReg) {
+    auto args = fun->argsOf(instr);
+    size_t inRegs = std::min(args.size(), std::size(ARGS) - firstReg);
+    size_t stacked = args.size() - inRegs;
+    // %rsp stays 16-byte aligned at the call
+    if (stacked % 2) out.instruction(AsmWriter::SUB, Q, imm(8), reg(SP));
+    for (size_t i = args.size(); i-- > inRegs;) {
+        out.instruction(AsmWriter::PUSH, Q, operand(args[i], AX));
+    }
+    // immediates read no register, so they go last
+    std::vector<Move> moves;
+    for (size_t i = 0; i < inRegs; ++i) {
+        if (args[i].isTemp()) moves.push_back({location(args[i].value), reg(ARGS[firstReg + i])});
+    }
+    parallelMove(moves);
+    for (size_t i = 0; i < inRegs; ++i) {
+        if (args[i].isImm()) move(operand(args[i], ARGS[firstReg + i]), reg(ARGS[firstReg + i]));
+    }
+    return 8 * int((stacked + 1) & ~size_t(1));
+}
+
+// pops what call pushed
+void IrLowering::drop(int bytes) {
+    if (bytes) out.instruction(AsmWriter::ADD, Q, imm(bytes), reg(SP));
+}
+
+void IrLowering::ret() {
+    for (size_t i = 0; i < allocation.saved.size(); ++i) {
+        out.instruction(AsmWriter::MOV, Q, mem(BP, -8 * int(i + 1)), reg(allocation.saved[i]));
+    }
+    out << "leave\n";
+    out << "ret\n";
+}
+
+// next is the block laid out after the one instr is in
+void IrLowering::lower(const IrInstr& instr, uint32_t next) {
+    switch (instr.op) {
+        case IrOp::COPY:
+            move(operand(instr.a, AX), location(instr.dst));
+            break;
+        case IrOp::ADD: case IrOp::SUB: case IrOp::MUL: {
+            AsmWriter::Op op = instr.op == IrOp::ADD ? AsmWriter::ADD :
+                               instr.op == IrOp::SUB ? AsmWriter::SUB : AsmWriter::IMUL;
+            // the result is made where it goes, unless b is there
+            Register t = target(instr.dst);
+            IrArg a = instr.a, b = instr.b;
+            if (b.isTemp() && same(location(b.value), reg(t))) {
+                if (instr.op == IrOp::SUB) t = AX;
+                else std::swap(a, b);
+            }
+            move(operand(a, t), reg(t));
+            out.instruction(op, Q, operand(b, CX), reg(t));
+            wrap(instr.type, t);
+            move(reg(t), location(instr.dst));
+            break;
+        }
+        case IrOp::DIV: {
+            move(operand(instr.a, AX), reg(AX));
+            Operand divisor = operand(instr.b, CX);
+            if (divisor.kind == Operand::CONST) {
+                move(divisor, reg(CX));
+                divisor = reg(CX);
+            }
+            // a narrower type divides in 32 bits, which is faster; its values are sign-extended
+            if (instr.type == Value::I64) {
+                out << "cqto\n";
+                out << "idivq " << divisor << '\n';
+            }
+            else {
+                divisor.lvl = D;
+                out << "cltd\n";
+                out << "idivl " << divisor << '\n';
+            }
+            wrap(instr.type, AX);
+            move(reg(AX), location(instr.dst));
+            break;
+        }
+        case IrOp::EQ: case IrOp::NE: case IrOp::LT:
+        case IrOp::LE: case IrOp::GT: case IrOp::GE: {
+            compare(instr);
+            Register t = target(instr.dst);
+            out.instruction(AsmWriter::SET, condition(instr.op), reg(t, B));
+            out.extend(false, reg(t, B), reg(t, Q));
+            move(reg(t), location(instr.dst));
+            break;
+        }
+        case IrOp::NOT: {
+            Register t = target(instr.dst);
+            move(operand(instr.a, t), reg(t));
+            out.instruction(AsmWriter::XOR, Q, imm(1), reg(t));
+            move(reg(t), location(instr.dst));
+            break;
+        }
+        case IrOp::CAST: {
+            Register t = target(instr.dst);
+            move(operand(instr.a, t), reg(t));
+            wrap(fun->temps[instr.dst], t);
+            move(reg(t), location(instr.dst));
+            break;
+        }
+        case IrOp::STRING: {
+            Register t = target(instr.dst);
+            std::string name = stringLabel(instr.index);
+            out.instruction(AsmWriter::LEA, Q, mem(IP, name), reg(t));
+            move(reg(t), location(instr.dst));
+            break;
+        }
+        case IrOp::LOAD:
+            move(element(instr.index, instr.a), location(instr.dst));
+            break;
+        case IrOp::STORE: {
+            Operand value = operand(instr.b, AX);
+            if (value.kind == Operand::MEM) {
+                move(value, reg(AX));
+                value = reg(AX);
+            }
+            move(value, element(instr.index, instr.a));
+            break;
+        }
+        case IrOp::CALL: {
+            int stacked = call(instr, 0);
+            out << "call " << instr.callee << '\n';
+            drop(stacked);
+            if (instr.dst >= 0) move(reg(AX), location(instr.dst));
+            break;
+        }
+        case IrOp::PRINT: {
+            // the format is the first argument
+            int stacked = call(instr, 1);
+            std::string format = stringLabel(instr.index);
+            out.instruction(AsmWriter::LEA, Q, mem(IP, format), reg(DI));
+            out.instruction(AsmWriter::MOV, D, imm(0), reg(D));
+            out << "call printf@PLT\n";
+            drop(stacked);
+            break;
+        }
+        case IrOp::JMP:
+            if (instr.target != next) out.jump(NONE, label(instr.target));
+            break;
+        case IrOp::BR:
+            if (instr.a.isImm()) {
+                uint32_t to = instr.a.value ? instr.target : instr.other;
+                if (to != next) out.jump(NONE, label(to));
+                break;
+            }
+            out.instruction(AsmWriter::CMP, Q, imm(0), location(instr.a.value));
+            branch(instr, NE, next);
+            break;
+        case IrOp::RET:
+            if (instr.a.kind != IrArg::NONE) move(operand(instr.a, AX), reg(AX));
+            else out.instruction(AsmWriter::MOV, D, imm(0), reg(D));
+            ret();
+            break;
+    }
+}
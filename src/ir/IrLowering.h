@@ -0,0 +1,59 @@
+#ifndef IRLOWERING_H
+#define IRLOWERING_H
+
+#include "Ir.h"
+#include "RegAlloc.h"
+#include "../semantic/AsmWriter.h"
+
+// Writes the x86-64 assembly of an IR module. The temps of each function
+// live where allocateRegisters puts them, and %rax, %rcx and %rdx are
+// scratch. A value is kept sign-extended to 64 bits whatever its type,
+// and array elements take 8 bytes each. Arguments past the sixth go on the
+// stack, as the System V ABI has them. A comparison whose only use is the
+// branch right after it becomes a cmp and a conditional jump.
+class IrLowering {
+public:
+    explicit IrLowering(std::ostream& out);
+
+    void lower(const IrModule& module);
+
+private:
+    struct Move {
+        Operand src;
+        Operand dst;
+    };
+
+    AsmWriter out;
+    const IrFunction* fun {};
+    uint32_t funIndex {};
+    Allocation allocation;
+    // offset from %rbp of each frame object
+    std::vector<int> frames;
+    // how many times each temp is read
+    std::vector<int> uses;
+
+    void lower(const IrFunction& function);
+    void lower(const IrInstr& instr, uint32_t next);
+    void compare(const IrInstr& instr);
+    void branch(const IrInstr& instr, C cond, uint32_t next);
+    // returns the bytes it pushed
+    int call(const IrInstr& instr, int firstReg);
+    void drop(int bytes);
+    void ret();
+
+    Operand location(int temp) const;
+    // arg as an operand; an immediate that needs 64 bits goes to scratch
+    Operand operand(IrArg arg, Register scratch);
+    // the register a result is made in: that of dst, or %rax
+    Register target(int dst) const;
+    // element index of a frame object; an index off a register goes to %rcx
+    Operand element(uint32_t frame, IrArg index);
+    void move(Operand src, Operand dst);
+    // moves that all read before any writes; a cycle goes through %rax
+    void parallelMove(std::vector<Move> moves);
+    // wraps reg to the width of type
+    void wrap(Value::Type type, Register reg);
+    std::string label(uint32_t block) const;
+};
+
+#endif
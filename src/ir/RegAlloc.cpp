@@ -0,0 +1,189 @@
+#include "RegAlloc.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+// the registers a temp can have: the caller-saved ones come first, leaving
+// the callee-saved ones to the intervals that span a call
+static constexpr Register ALLOCATABLE[] = {SI, DI, R8, R9, R10, R11, BX, R12, R13, R14, R15};
+static constexpr size_t CALLER_SAVED = 6;
+
+static bool isCalleeSaved(Register reg) {
+    auto calleeSaved = std::begin(ALLOCATABLE) + CALLER_SAVED;
+    return std::find(calleeSaved, std::end(ALLOCATABLE), reg) != std::end(ALLOCATABLE);
+}
+
+// a set of the temps of a function, one bit each
+class TempSet {
+public:
+    explicit TempSet(size_t size = 0) : words((size + 63) / 64) {}
+
+    void insert(int temp) { words[temp / 64] |= uint64_t(1) << (temp % 64); }
+    bool contains(int temp) const { return words[temp / 64] >> (temp % 64) & 1; }
+    bool operator==(const TempSet& other) const = default;
+
+    // this = (this - without) | with
+    void update(const TempSet& without, const TempSet& with) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] = (words[i] & ~without.words[i]) | with.words[i];
+        }
+    }
+    void merge(const TempSet& other) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] |= other.words[i];
+        }
+    }
+    template <class F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            for (uint64_t word = words[i]; word; word &= word - 1) {
+                f(int(i * 64 + std::countr_zero(word)));
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+// the points a temp is live at, as positions in the code
+struct Interval {
+    int temp;
+    int start {INT_MAX};
+    int end {-1};
+    // whether a call happens while it is live
+    bool call {};
+    Location* location {};
+};
+
+// temps live on entry to each block
+static std::vector<TempSet> liveIn(const IrFunction& fun) {
+    size_t count = fun.blocks.size(), temps = fun.temps.size();
+    std::vector<TempSet> uses(count, TempSet(temps)), defs(count, TempSet(temps));
+    for (size_t b = 0; b < count; ++b) {
+        for (const IrInstr& instr : fun.blocks[b].instrs) {
+            fun.forEachUse(instr, [&](int temp) {
+                if (!defs[b].contains(temp)) uses[b].insert(temp);
+            });
+            if (instr.dst >= 0) defs[b].insert(instr.dst);
+        }
+    }
+
+    // backwards over the blocks, which mostly follow each other, until nothing changes
+    std::vector<TempSet> in(uses);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t b = count; b-- > 0;) {
+            TempSet live(temps);
+            for (uint32_t succ : fun.blocks[b].successors()) {
+                live.merge(in[succ]);
+            }
+            live.update(defs[b], uses[b]);
+            if (!(live == in[b])) {
+                in[b] = std::move(live);
+                changed = true;
+            }
+        }
+    }
+    return in;
+}
+
+// Every instruction has two positions: it reads its operands at the first
+// and writes its result at the second.
+static std::vector<Interval> intervals(const IrFunction& fun) {
+    std::vector<Interval> result(fun.temps.size());
+    for (size_t t = 0; t < result.size(); ++t) {
+        result[t].temp = t;
+    }
+    auto extend = [&](int temp, int pos) {
+        result[temp].start = std::min(result[temp].start, pos);
+        result[temp].end = std::max(result[temp].end, pos);
+    };
+
+    std::vector<TempSet> in = liveIn(fun);
+    std::vector<int> calls;
+    int pos = 0;
+    for (size_t b = 0; b < fun.blocks.size(); ++b) {
+        in[b].forEach([&](int temp) { extend(temp, pos); });
+        for (const IrInstr& instr : fun.blocks[b].instrs) {
+            fun.forEachUse(instr, [&](int temp) { extend(temp, pos); });
+            if (instr.dst >= 0) extend(instr.dst, pos + 1);
+            if (instr.op == IrOp::CALL || instr.op == IrOp::PRINT) calls.push_back(pos);
+            pos += 2;
+        }
+        // what is live out of the block is live past its terminator
+        for (uint32_t succ : fun.blocks[b].successors()) {
+            in[succ].forEach([&](int temp) { extend(temp, pos - 1); });
+        }
+    }
+
+    for (Interval& interval : result) {
+        auto call = std::lower_bound(calls.begin(), calls.end(), interval.start);
+        interval.call = call != calls.end() && *call < interval.end;
+    }
+    std::erase_if(result, [](const Interval& interval) { return interval.end < 0; });
+    std::sort(result.begin(), result.end(), [](const Interval& a, const Interval& b) {
+        return a.start < b.start;
+    });
+    return result;
+}
+
+Allocation allocateRegisters(const IrFunction& fun) {
+    Allocation allocation;
+    allocation.temps.resize(fun.temps.size());
+    std::vector<Interval> all = intervals(fun);
+    std::vector<Interval*> active;
+    std::vector<Register> free(std::begin(ALLOCATABLE), std::end(ALLOCATABLE));
+
+    auto spill = [&](Interval* interval) {
+        *interval->location = {Location::STACK, AX, allocation.slots++};
+    };
+    auto assign = [&](Interval* interval, Register reg) {
+        *interval->location = {Location::REG, reg};
+        if (isCalleeSaved(reg) && std::find(allocation.saved.begin(), allocation.saved.end(), reg) == allocation.saved.end()) {
+            allocation.saved.push_back(reg);
+        }
+        active.push_back(interval);
+    };
+
+    for (Interval& current : all) {
+        current.location = &allocation.temps[current.temp];
+        // the registers of the intervals that ended are free again, in the order they were
+        std::erase_if(active, [&](Interval* interval) {
+            if (interval->end >= current.start) return false;
+            Register reg = interval->location->reg;
+            auto place = std::find_if(free.begin(), free.end(), [&](Register other) {
+                return isCalleeSaved(other) >= isCalleeSaved(reg);
+            });
+            free.insert(place, reg);
+            return true;
+        });
+
+        auto found = std::find_if(free.begin(), free.end(), [&](Register reg) {
+            return !current.call || isCalleeSaved(reg);
+        });
+        if (found != free.end()) {
+            Register reg = *found;
+            free.erase(found);
+            assign(&current, reg);
+            continue;
+        }
+
+        // the interval that ends last, of those whose register current can have, goes to the stack
+        Interval* victim = nullptr;
+        for (Interval* interval : active) {
+            if (current.call && !isCalleeSaved(interval->location->reg)) continue;
+            if (!victim || interval->end > victim->end) victim = interval;
+        }
+        if (victim && victim->end > current.end) {
+            Register reg = victim->location->reg;
+            spill(victim);
+            std::erase(active, victim);
+            assign(&current, reg);
+        }
+        else {
+            spill(&current);
+        }
+    }
+    return allocation;
+}
@@ -0,0 +1,34 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include "Ir.h"
+#include "../semantic/AsmWriter.h"
+
+// where a temp lives in the code of its function
+struct Location {
+    enum Kind : uint8_t {NONE, REG, STACK};
+
+    Kind kind {NONE};
+    Register reg {AX};
+    // index of the stack slot of a spilled temp
+    int slot {};
+};
+
+struct Allocation {
+    // indexed by temp; NONE for a temp that is never live
+    std::vector<Location> temps;
+    // callee-saved registers the function uses, to save on entry
+    std::vector<Register> saved;
+    // stack slots of the spilled temps
+    int slots {};
+};
+
+// Linear-scan register allocation over the live intervals of the temps of
+// a function. The code is not SSA, so an interval is the hull of every
+// point where the temp is live, from liveness over the CFG in block
+// order. An interval that spans a call only gets a callee-saved register;
+// when none is free, the interval that ends last is spilled to the stack.
+// %rax, %rcx and %rdx are left out, as the lowering needs them as scratch.
+Allocation allocateRegisters(const IrFunction& fun);
+
+#endif
@@ -0,0 +1,275 @@
+#include "CharScan.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CHARSCAN_X86
+#include <immintrin.h>
+#endif
+
+// SCALAR
+
+static bool isIdentifierChar(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')
+        || (ch >= '0' && ch <= '9') || ch == '_';
+}
+
+static size_t scalarWhitespace(const char* p, size_t n, int& newlines, size_t& lastNewline) {
+    size_t i = 0;
+    for (; i < n; ++i) {
+        char ch = p[i];
+        if (ch == '\n') {
+            ++newlines;
+            lastNewline = i;
+        }
+        else if (ch != ' ' && ch != '\r' && ch != '\t') {
+            break;
+        }
+    }
+    return i;
+}
+
+static size_t scalarUntilNewline(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && p[i] != '\n') ++i;
+    return i;
+}
+
+static size_t scalarIdentifier(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && isIdentifierChar(p[i])) ++i;
+    return i;
+}
+
+static size_t scalarDigits(const char* p, size_t n) {
+    size_t i = 0;
+    while (i < n && p[i] >= '0' && p[i] <= '9') ++i;
+    return i;
+}
+
+#ifdef CHARSCAN_X86
+
+// adds the newlines flagged in bits (relative to block offset i) to the counters
+static inline void countNewlines(unsigned bits, size_t i, int& newlines, size_t& lastNewline) {
+    if (bits) {
+        newlines += __builtin_popcount(bits);
+        lastNewline = i + 31 - __builtin_clz(bits);
+    }
+}
+
+// SSE2 (16 bytes per step)
+
+__attribute__((target("sse2")))
+static inline unsigned sse2Whitespace(__m128i v) {
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+    return _mm_movemask_epi8(m);
+}
+
+__attribute__((target("sse2")))
+static inline unsigned sse2Digits(__m128i v) {
+    __m128i m = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                              _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+    return _mm_movemask_epi8(m);
+}
+
+__attribute__((target("sse2")))
+static inline unsigned sse2Identifier(__m128i v) {
+    // folding to lower case maps both letter ranges onto 'a'..'z'
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), lower));
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_movemask_epi8(_mm_or_si128(alpha, underscore)) | sse2Digits(v);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2Whitespace(const char* p, size_t n, int& newlines, size_t& lastNewline) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned nl = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        unsigned stop = ~sse2Whitespace(v) & 0xFFFF;
+        if (stop) {
+            unsigned k = __builtin_ctz(stop);
+            countNewlines(nl & ((1u << k) - 1), i, newlines, lastNewline);
+            return i + k;
+        }
+        countNewlines(nl, i, newlines, lastNewline);
+    }
+    size_t lastTail = 0;
+    int before = newlines;
+    size_t k = scalarWhitespace(p + i, n - i, newlines, lastTail);
+    if (newlines != before) lastNewline = i + lastTail;
+    return i + k;
+}
+
+__attribute__((target("sse2")))
+static size_t sse2UntilNewline(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned nl = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        if (nl) return i + __builtin_ctz(nl);
+    }
+    return i + scalarUntilNewline(p + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2Identifier(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned stop = ~sse2Identifier(v) & 0xFFFF;
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return i + scalarIdentifier(p + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static size_t sse2Digits(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned stop = ~sse2Digits(v) & 0xFFFF;
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return i + scalarDigits(p + i, n - i);
+}
+
+// AVX2 (32 bytes per step)
+
+__attribute__((target("avx2")))
+static inline unsigned avx2Whitespace(__m256i v) {
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+    return _mm256_movemask_epi8(m);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned avx2Digits(__m256i v) {
+    __m256i m = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                 _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    return _mm256_movemask_epi8(m);
+}
+
+__attribute__((target("avx2")))
+static inline unsigned avx2Identifier(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_movemask_epi8(_mm256_or_si256(alpha, underscore)) | avx2Digits(v);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Whitespace(const char* p, size_t n, int& newlines, size_t& lastNewline) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned nl = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        unsigned stop = ~avx2Whitespace(v);
+        if (stop) {
+            unsigned k = __builtin_ctz(stop);
+            countNewlines(nl & ((1u << k) - 1), i, newlines, lastNewline);
+            return i + k;
+        }
+        countNewlines(nl, i, newlines, lastNewline);
+    }
+    size_t lastTail = 0;
+    int before = newlines;
+    size_t k = sse2Whitespace(p + i, n - i, newlines, lastTail);
+    if (newlines != before) lastNewline = i + lastTail;
+    return i + k;
+}
+
+__attribute__((target("avx2")))
+static size_t avx2UntilNewline(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned nl = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        if (nl) return i + __builtin_ctz(nl);
+    }
+    return i + sse2UntilNewline(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Identifier(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned stop = ~avx2Identifier(v);
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return i + sse2Identifier(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2Digits(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned stop = ~avx2Digits(v);
+        if (stop) return i + __builtin_ctz(stop);
+    }
+    return i + sse2Digits(p + i, n - i);
+}
+
+#endif
+
+// DISPATCH
+
+struct CharScanImpl {
+    const char* name;
+    size_t (*whitespace)(const char*, size_t, int&, size_t&);
+    size_t (*untilNewline)(const char*, size_t);
+    size_t (*identifier)(const char*, size_t);
+    size_t (*digits)(const char*, size_t);
+};
+
+static CharScanImpl chooseImpl() {
+    const CharScanImpl scalar {"scalar", scalarWhitespace, scalarUntilNewline, scalarIdentifier, scalarDigits};
+#ifdef CHARSCAN_X86
+    const CharScanImpl sse2 {"sse2", sse2Whitespace, sse2UntilNewline, sse2Identifier, sse2Digits};
+    const CharScanImpl avx2 {"avx2", avx2Whitespace, avx2UntilNewline, avx2Identifier, avx2Digits};
+
+    __builtin_cpu_init();
+    bool hasSse2 = __builtin_cpu_supports("sse2");
+    bool hasAvx2 = __builtin_cpu_supports("avx2");
+
+    const char* forced = std::getenv("RUSTY_SIMD");
+    if (forced && strcmp(forced, "scalar") == 0) return scalar;
+    if (forced && strcmp(forced, "sse2") == 0 && hasSse2) return sse2;
+    if (hasAvx2) return avx2;
+    if (hasSse2) return sse2;
+#endif
+    return scalar;
+}
+
+static const CharScanImpl& impl() {
+    static const CharScanImpl chosen = chooseImpl();
+    return chosen;
+}
+
+size_t CharScan::whitespace(const char* p, size_t n, int& newlines, size_t& lastNewline) {
+    return impl().whitespace(p, n, newlines, lastNewline);
+}
+
+size_t CharScan::untilNewline(const char* p, size_t n) {
+    return impl().untilNewline(p, n);
+}
+
+size_t CharScan::identifier(const char* p, size_t n) {
+    return impl().identifier(p, n);
+}
+
+size_t CharScan::digits(const char* p, size_t n) {
+    return impl().digits(p, n);
+}
+
+const char* CharScan::implementation() {
+    return impl().name;
+}
@@ -0,0 +1,24 @@
+#ifndef CHARSCAN_H
+#define CHARSCAN_H
+
+#include <cstddef>
+
+// Byte-run scanners used by the Scanner. Each one measures how many bytes
+// at the start of [p, p + n) belong to a run and never reads past p + n.
+// The implementation (AVX2, SSE2 or scalar) is picked once at startup from
+// the running CPU; setting RUSTY_SIMD=scalar|sse2|avx2 overrides the choice.
+class CharScan {
+public:
+    // whitespace run; counts the '\n' inside it and the index of the last one
+    static size_t whitespace(const char* p, size_t n, int& newlines, size_t& lastNewline);
+    // bytes before the next '\n' (n if there is none)
+    static size_t untilNewline(const char* p, size_t n);
+    // [A-Za-z0-9_] run
+    static size_t identifier(const char* p, size_t n);
+    // [0-9] run
+    static size_t digits(const char* p, size_t n);
+
+    static const char* implementation();
+};
+
+#endif
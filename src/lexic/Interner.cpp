@@ -0,0 +1,39 @@
+#include "Interner.h"
+
+const std::string& Symbol::str() const {
+    return Interner::name(*this);
+}
+
+std::ostream& operator<<(std::ostream& out, Symbol symbol) {
+    return out << symbol.str();
+}
+
+Interner::Interner() {
+    // symbol 0 is reserved for the empty name
+    names.emplace_back();
+    ids.emplace(names.back(), 0);
+}
+
+Interner& Interner::instance() {
+    static Interner interner;
+    return interner;
+}
+
+Symbol Interner::intern(std::string_view name) {
+    Interner& self = instance();
+    if (auto found = self.ids.find(name); found != self.ids.end()) {
+        return {found->second};
+    }
+    uint32_t id = self.names.size();
+    self.names.emplace_back(name);
+    self.ids.emplace(self.names.back(), id);
+    return {id};
+}
+
+const std::string& Interner::name(Symbol symbol) {
+    return instance().names[symbol.id];
+}
+
+size_t Interner::size() {
+    return instance().names.size();
+}
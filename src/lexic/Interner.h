@@ -0,0 +1,45 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// handle of an interned identifier; ids are dense and 0 is the empty name
+struct Symbol {
+    uint32_t id {};
+
+    bool operator==(const Symbol& other) const = default;
+    auto operator<=>(const Symbol& other) const = default;
+    bool empty() const { return id == 0; }
+    const std::string& str() const;
+    friend std::ostream& operator<<(std::ostream& out, Symbol symbol);
+};
+
+template <>
+struct std::hash<Symbol> {
+    size_t operator()(Symbol symbol) const noexcept { return symbol.id; }
+};
+
+// Process-wide identifier table shared by every pass. Identifiers are
+// interned by the Scanner, so later stages only compare and hash integers.
+class Interner {
+public:
+    static Symbol intern(std::string_view name);
+    static const std::string& name(Symbol symbol);
+    static size_t size();
+
+private:
+    Interner();
+    static Interner& instance();
+
+    // a deque never moves its elements, so the views used as keys stay valid
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
+#endif
@@ -2,46 +2,71 @@
 #define SCANNER_H
 
 #include "Token.h"
+#include <span>
+#include <vector>
 
 class Scanner {
 private:
     // snapshot of the configuration of Scanner at one instant
+    // (the whole file is lexed upfront, so a position in the token buffer is enough)
     class Snapshot {
     private:
         friend class Scanner;
 
-        int pos;
-        int line;
-        int col;
-        Token current;
+        size_t index;
     public:
-      Snapshot(int pos, int line, int col, const Token& current)
-          : pos(pos), line(line), col(col), current(current) {}
+      explicit Snapshot(size_t index) : index(index) {}
     };
 
-    char* source;
-    int size;
+    // the source is either memory-mapped or, as a fallback, owned
+    const char* source {""};
+    void* mapped {};
+    std::string owned;
+    int size {};
     int pos {};
+    // start of the token being lexed
+    int start {};
     int line {1};
     int col {1};
     Token current {};
 
+    // every token of the file, from BEG to END
+    std::vector<Token> tokens;
+    // the buffer being read: tokens, or those of the scanner this one is a cursor over
+    std::span<const Token> buffer;
+    size_t index {};
+
     int increasePos ();
     int increasePos (const int& rhs);
-    bool isWhitespace (char ch);
+    char charAt (int i) const;
+    std::string_view lexeme () const;
+    void skipWhitespace ();
+    void lex ();
+    void tokenize ();
     void advance ();
 public:
     explicit Scanner(char* filename);
+    // lexes text owned by the caller, numbering its first line as line
+    Scanner(std::string_view text, int line);
+    // an independent cursor over the tokens of lexed, starting at index;
+    // lexed must outlive it
+    Scanner(const Scanner& lexed, size_t index);
     ~Scanner();
 
+    Scanner(const Scanner&) = delete;
+    Scanner& operator=(const Scanner&) = delete;
+
     bool eof ();
-    Token::Type peek();
-    bool check (const Token& token);
-    bool match (const Token& token);
+    Token::Type peek(int k = 1);
+    bool check (Token::Type type);
+    bool match (Token::Type type);
     void next ();
-    Token getToken ();
-    std::string getTokenContent ();
+    const Token& getToken ();
+    std::string_view getTokenContent ();
     Token getNextToken ();
+    // the whole token buffer, from BEG to END, and the position in it
+    std::span<const Token> getTokens () const;
+    size_t getIndex () const;
     Snapshot getSnapshot ();
     void restoreSnapshot (const Snapshot& snapshot);
 };
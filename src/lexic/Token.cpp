@@ -5,19 +5,21 @@ Token::Token() : type(BEG) {}
 
 Token::Token(Type type) : type(type) {}
 
-Token::Token(Type type, std::string content, int col, int line)
+Token::Token(Type type, std::string_view content, int col, int line)
     : type(type), content(content), col(col), line(line) {}
 
-Token::~Token() {}
-
 Token::Type Token::getType() const {
     return type;
 }
 
-std::string Token::getContent() const {
+std::string_view Token::getContent() const {
     return content;
 }
 
+Symbol Token::getSymbol() const {
+    return sym;
+}
+
 Token::operator std::string() const {
     switch (type) {
         case Token::BEG: return "BEG";
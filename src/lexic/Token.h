@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include "Interner.h"
 
 class Scanner;
 
@@ -24,18 +26,23 @@ public:
 
     Token();
     explicit Token(Type type);
-    Token(Type type, std::string content, int col, int line);
-    ~Token();
+    Token(Type type, std::string_view content, int col, int line);
+    ~Token() = default;
     Type getType() const;
-    std::string getContent() const;
+    std::string_view getContent() const;
+    Symbol getSymbol() const;
     operator std::string() const;
 
 private:
     friend class Scanner;
     friend class Parser;
+    friend class Incremental;
 
     Type type;
-    std::string content;
+    // view into the Scanner's source, valid while the Scanner is alive
+    std::string_view content;
+    // interned text of ID and STRING tokens
+    Symbol sym {};
     int col{};
     int line{};
     friend std::ostream& operator<<(std::ostream& out, const Token& token);
@@ -0,0 +1,143 @@
+#include "AsmWriter.h"
+#include <cassert>
+#include <charconv>
+
+// text written before the buffer grows
+static constexpr size_t INITIAL_CAPACITY = 1 << 20;
+
+// indexed by Op, then by L; empty where x86-64 has no such instruction
+static constexpr std::string_view SIZED[][4] = {
+    {"movb", "movw", "movl", "movq"},
+    {"addb", "addw", "addl", "addq"},
+    {"subb", "subw", "subl", "subq"},
+    {"", "imulw", "imull", "imulq"},
+    {"andb", "andw", "andl", "andq"},
+    {"orb", "orw", "orl", "orq"},
+    {"notb", "notw", "notl", "notq"},
+    {"incb", "incw", "incl", "incq"},
+    {"decb", "decw", "decl", "decq"},
+    {"", "pushw", "", "pushq"},
+    {"", "popw", "", "popq"},
+    {"", "leaw", "leal", "leaq"},
+    {"cmpb", "cmpw", "cmpl", "cmpq"},
+    {"xorb", "xorw", "xorl", "xorq"},
+};
+
+// indexed by CondOp, then by C
+static constexpr std::string_view CONDITIONAL[][7] = {
+    {"jmp", "je", "jne", "jg", "jl", "jge", "jle"},
+    {"set", "sete", "setne", "setg", "setl", "setge", "setle"},
+    {"cmov", "cmove", "cmovne", "cmovg", "cmovl", "cmovge", "cmovle"},
+};
+
+// indexed by signed, then by the L of the source and of the destination;
+// empty where the source is not the narrower one
+static constexpr std::string_view EXTEND[2][4][4] = {
+    {{"", "movzbw", "movzbl", "movzbq"},
+     {"", "", "movzwl", "movzwq"},
+     {"", "", "", "movl"},
+     {"", "", "", ""}},
+    {{"", "movsbw", "movsbl", "movsbq"},
+     {"", "", "movswl", "movswq"},
+     {"", "", "", "movslq"},
+     {"", "", "", ""}},
+};
+
+// indexed by Register, then by L; %rip only has the 64-bit name
+static constexpr std::string_view REGISTERS[][4] = {
+    {"%al", "%ax", "%eax", "%rax"},
+    {"%bl", "%bx", "%ebx", "%rbx"},
+    {"%cl", "%cx", "%ecx", "%rcx"},
+    {"%dl", "%dx", "%edx", "%rdx"},
+    {"%sil", "%si", "%esi", "%rsi"},
+    {"%dil", "%di", "%edi", "%rdi"},
+    {"%bpl", "%bp", "%ebp", "%rbp"},
+    {"%spl", "%sp", "%esp", "%rsp"},
+    {"", "", "", "%rip"},
+    {"%r8b", "%r8w", "%r8d", "%r8"},
+    {"%r9b", "%r9w", "%r9d", "%r9"},
+    {"%r10b", "%r10w", "%r10d", "%r10"},
+    {"%r11b", "%r11w", "%r11d", "%r11"},
+    {"%r12b", "%r12w", "%r12d", "%r12"},
+    {"%r13b", "%r13w", "%r13d", "%r13"},
+    {"%r14b", "%r14w", "%r14d", "%r14"},
+    {"%r15b", "%r15w", "%r15d", "%r15"},
+};
+
+AsmWriter::AsmWriter(std::ostream& out) : out(out) {
+    buffer.reserve(INITIAL_CAPACITY);
+}
+
+void AsmWriter::instruction(Op op, L lvl, Operand dst) {
+    assert(!SIZED[op][lvl].empty() && "an operation x86-64 has no form of at this size");
+    *this << SIZED[op][lvl] << ' ' << dst << '\n';
+}
+
+void AsmWriter::instruction(Op op, L lvl, Operand src, Operand dst) {
+    assert(!SIZED[op][lvl].empty() && "an operation x86-64 has no form of at this size");
+    *this << SIZED[op][lvl] << ' ' << src << ", " << dst << '\n';
+}
+
+void AsmWriter::instruction(CondOp op, C cond, Operand dst) {
+    *this << CONDITIONAL[op][cond] << ' ' << dst << '\n';
+}
+
+void AsmWriter::instruction(CondOp op, C cond, Operand src, Operand dst) {
+    *this << CONDITIONAL[op][cond] << ' ' << src << ", " << dst << '\n';
+}
+
+void AsmWriter::jump(C cond, std::string_view label) {
+    *this << CONDITIONAL[J][cond] << ' ' << label << '\n';
+}
+
+void AsmWriter::extend(bool sign, Operand src, Operand dst) {
+    std::string_view mnemonic = EXTEND[sign][src.lvl][dst.lvl];
+    assert(!mnemonic.empty() && "extend to a size no larger than the source");
+    // writing a 32-bit register clears the upper half of the 64-bit one
+    if (!sign && src.lvl == D) dst.lvl = D;
+    *this << mnemonic << ' ' << src << ", " << dst << '\n';
+}
+
+AsmWriter& AsmWriter::operator<<(std::string_view text) {
+    buffer.append(text);
+    return *this;
+}
+
+AsmWriter& AsmWriter::operator<<(char c) {
+    buffer.push_back(c);
+    return *this;
+}
+
+AsmWriter& AsmWriter::operator<<(int64_t value) {
+    char digits[24];
+    auto [end, error] = std::to_chars(digits, digits + sizeof digits, value);
+    buffer.append(digits, end);
+    return *this;
+}
+
+AsmWriter& AsmWriter::operator<<(Symbol symbol) {
+    return *this << std::string_view(symbol.str());
+}
+
+AsmWriter& AsmWriter::operator<<(Operand op) {
+    switch (op.kind) {
+        case Operand::REG:
+            assert(!REGISTERS[op.reg][op.lvl].empty() && "no register of that size");
+            return *this << REGISTERS[op.reg][op.lvl];
+        case Operand::CONST:
+            return *this << '$' << op.value;
+        case Operand::MEM:
+            if (op.value) *this << op.value;
+            else *this << op.label;
+            // the base and the index are addresses, so always whole registers
+            *this << '(' << REGISTERS[op.reg][Q];
+            if (op.index != SP) *this << ',' << REGISTERS[op.index][Q] << ',' << int64_t(op.scale);
+            return *this << ')';
+    }
+    return *this;
+}
+
+void AsmWriter::flush() {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
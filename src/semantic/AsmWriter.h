@@ -0,0 +1,89 @@
+#ifndef ASMWRITER_H
+#define ASMWRITER_H
+
+#include "../lexic/Interner.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+enum L {B, W, D, Q};
+enum C {NONE, EQ, NE, GT, LT, GE, LE};
+enum Register : uint8_t {AX, BX, CX, DX, SI, DI, BP, SP, IP, R8, R9, R10, R11, R12, R13, R14, R15};
+
+// An instruction operand: a register, an immediate, or the memory at a
+// register plus an offset or a label, and a scaled index register if any.
+// It is a plain value, made where the instruction is emitted and passed by
+// copy; a label is not owned and must outlive the instruction.
+struct Operand {
+    enum Kind : uint8_t {REG, CONST, MEM};
+
+    Kind kind {REG};
+    L lvl {Q};
+    Register reg {AX};
+    // the immediate of a CONST, the offset of a MEM
+    int64_t value {};
+    std::string_view label {};
+    // SP, which cannot be an index, for none
+    Register index {SP};
+    uint8_t scale {1};
+};
+
+inline Operand reg(Register reg = AX, L lvl = Q) {
+    return {Operand::REG, lvl, reg};
+}
+inline Operand reg(L lvl) {
+    return reg(AX, lvl);
+}
+inline Operand imm(int64_t value, L lvl = Q) {
+    return {Operand::CONST, lvl, AX, value};
+}
+// memory at a 64-bit base register
+inline Operand mem(Register base, int offset, L lvl = Q) {
+    return {Operand::MEM, lvl, base, offset};
+}
+inline Operand mem(Register base, std::string_view label, L lvl = Q) {
+    return {Operand::MEM, lvl, base, 0, label};
+}
+// memory at base + offset + index * scale
+inline Operand mem(Register base, int offset, Register index, uint8_t scale, L lvl = Q) {
+    return {Operand::MEM, lvl, base, offset, {}, index, scale};
+}
+
+// The assembly text of a program. Instructions are formatted into one
+// buffer from tables of mnemonics and register names, with no stream in
+// between, and the whole text goes to the stream in a single write.
+class AsmWriter {
+public:
+    // instructions with a size suffix
+    enum Op : uint8_t {MOV, ADD, SUB, IMUL, AND, OR, NOT, INC, DEC, PUSH, POP, LEA, CMP, XOR};
+    // instructions with a condition suffix; J with NONE is jmp
+    enum CondOp : uint8_t {J, SET, CMOV};
+
+    explicit AsmWriter(std::ostream& out);
+
+    void instruction(Op op, L lvl, Operand dst);
+    void instruction(Op op, L lvl, Operand src, Operand dst);
+    void instruction(CondOp op, C cond, Operand dst);
+    void instruction(CondOp op, C cond, Operand src, Operand dst);
+    void jump(C cond, std::string_view label);
+    // movs or movz from the size of src to the larger size of dst; a zero
+    // extension from 32 bits is a movl to the low half of dst
+    void extend(bool sign, Operand src, Operand dst);
+
+    // anything else: directives, labels, instructions without operands
+    AsmWriter& operator<<(std::string_view text);
+    AsmWriter& operator<<(char c);
+    AsmWriter& operator<<(int64_t value);
+    AsmWriter& operator<<(Symbol symbol);
+    AsmWriter& operator<<(Operand op);
+
+    // hands what was written so far to the stream
+    void flush();
+
+private:
+    std::ostream& out;
+    std::string buffer;
+};
+
+#endif
@@ -1,60 +1,5 @@
 #include "CodeGen.h"
 
-Operand::~Operand() = default;
-std::ostream& operator<<(std::ostream& out, Operand* op) {
-    op->print(out);
-    return out;
-}
-
-Reg::~Reg() {}
-void Reg::print(ostream& out) {
-    out << "%";
-    if (reg.length() > 1 && isdigit(reg[1])) {
-        out << reg;
-        switch(lvl) {
-            case B: out << 'b'; break;
-            case W: out << 'w'; break;
-            case D: out << 'd'; break;
-            default: break;
-        }
-        return;
-    }
-    if (lvl == D) out << 'e';
-    else if (lvl == Q) out << 'r';
-    out << reg;
-    if (lvl != B) {
-        if (reg.length() == 1) out << "x";
-    }
-    else out << 'l';
-}
-
-Const::~Const() {}
-void Const::print(ostream& out) {
-    out << "$";
-    out << value.numericValues.front();
-}
-
-Mem::~Mem() {
-    delete reg;
-}
-void Mem::print(ostream& out) {
-    if (offset) out << to_string(offset);
-    else if (!label.empty()) out << label;
-    out << "(";
-    out << reg;
-    out << ")";
-}
-
-ostream& operator<<(ostream& out, L lvl) {
-    switch (lvl) {
-        case B: out << 'b'; break;
-        case W: out << 'w'; break;
-        case D: out << 'l'; break;
-        case Q: out << 'q'; break;
-    }
-    return out;
-}
-
 char CodeGen::nextL(L lvl) {
     switch (lvl) {
         case B: return 'w';
@@ -64,19 +9,6 @@ char CodeGen::nextL(L lvl) {
     }
 }
 
-ostream& operator<<(ostream& out, C cond) {
-    switch (cond) {
-        case EQ: out << "e"; break;
-        case NE: out << "ne"; break;
-        case GT: out << "g"; break;
-        case LT: out << "l"; break;
-        case GE: out << "ge"; break;
-        case LE: out << "le"; break;
-        default: break;
-    }
-    return out;
-}
-
 int CodeGen::typeLen(L lvl) {
     switch (lvl) {
         case B: return 1;
@@ -106,9 +38,6 @@ int CodeGen::typeLen(Value value) {
     else if (value.ref) {
         return 8;
     } 
-    else if (value.right) {
-        return 2 * 8;
-    }
     else {
         return typeLen(value.type);
     }
@@ -144,64 +73,65 @@ L CodeGen::valueToL(Value value) {
     return typeToL(value.type);
 }
 
-void CodeGen::mov() {
-    auto c = dynamic_cast<Const*>(l);
-    if (c) {
-        out << "mov" << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::mov(Operand src, Operand dst) {
+    if (src.kind == Operand::CONST) {
+        out.instruction(AsmWriter::MOV, dst.lvl, src, dst);
         return;
     }
-    auto m = dynamic_cast<Mem*>(r);
-    if (m) {
-        out << "mov" << l->lvl << ' ' << l << ", " << r << '\n';
+    if (dst.kind == Operand::MEM) {
+        out.instruction(AsmWriter::MOV, src.lvl, src, dst);
         return;
     }
 
-    if (l->lvl < r->lvl) {
-        return movs(); // sign-extend
+    if (src.lvl < dst.lvl) {
+        return movs(src, dst); // sign-extend
     }
-    else if (l->lvl > r->lvl) {
-        l->lvl = r->lvl; // downgrade to destination's level
+    else if (src.lvl > dst.lvl) {
+        src.lvl = dst.lvl; // downgrade to destination's level
     }
-    out << "mov" << (m ? l->lvl : r->lvl) << ' ' << l << ", " << r << '\n';
+    out.instruction(AsmWriter::MOV, dst.lvl, src, dst);
 }
-void CodeGen::movz() {
-    out << "movz" << l->lvl << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::movz(Operand src, Operand dst) {
+    out.extend(false, src, dst);
 }
-void CodeGen::movs() {
-    out << "movs" << l->lvl << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::movs(Operand src, Operand dst) {
+    out.extend(true, src, dst);
 }
-void CodeGen::add() {
-    out << "add" << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::add(Operand src, Operand dst) {
+    out.instruction(AsmWriter::ADD, dst.lvl, src, dst);
 }
 void CodeGen::addSP(int off, bool early) {
     if (off == 0) return;
 
-    l = new Const(Value(Value::I64, off));
-    r = new Reg("sp");
-    out << "add" << r->lvl << ' ' << l << ", " << r << '\n';
+    add(imm(off), reg(SP));
     if (!early) offset -= off;
 }
-void CodeGen::inc() {
-    out << "inc" << r->lvl << ' ' << r << '\n';
+void CodeGen::inc(Operand dst) {
+    out.instruction(AsmWriter::INC, dst.lvl, dst);
 }
-void CodeGen::sub() {
-    out << "sub" << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::sub(Operand src, Operand dst) {
+    out.instruction(AsmWriter::SUB, dst.lvl, src, dst);
 }
 void CodeGen::subSP(int off) {
     if (off == 0) return;
-    l = new Const(Value(Value::I64, off));
-    r = new Reg("sp");
-    out << "sub" << r->lvl << ' ' << l << ", " << r << '\n';
+    sub(imm(off), reg(SP));
     offset += off;
 }
-void CodeGen::dec() {
-    out << "dec" << r->lvl << ' ' << r << '\n';
+void CodeGen::dec(Operand dst) {
+    out.instruction(AsmWriter::DEC, dst.lvl, dst);
 }
-void CodeGen::mul() {
-    out << "imul" << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::mul(Operand src, Operand dst) {
+    // imul has no 8-bit two-operand form; the low byte of the 32-bit product
+    // is the same
+    if (dst.lvl == B) {
+        movs(src, reg(src.reg, D));
+        movs(dst, reg(dst.reg, D));
+        src.lvl = dst.lvl = D;
+    }
+    out.instruction(AsmWriter::IMUL, dst.lvl, src, dst);
 }
-void CodeGen::div() {
-    switch (r->lvl) {
+void CodeGen::div(Operand divisor, Operand dividend) {
+    switch (dividend.lvl) {
         case Q:
             out << "cqto\n";
             break;
@@ -217,81 +147,54 @@ void CodeGen::div() {
         default:
             break;
     }
-    out << "idiv" << ' ' << l << '\n';
+    out << "idiv" << ' ' << divisor << '\n';
 }
-void CodeGen::land() {
-    out << "and" << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::bnot(Operand dst) {
+    out.instruction(AsmWriter::NOT, dst.lvl, dst);
 }
-void CodeGen::lor() {
-    out << "or" << r->lvl << ' ' << l << ", " << r << '\n';
-}
-void CodeGen::bnot() {
-    out << "not" << r->lvl << ' ' << r << '\n';
-}
-void CodeGen::push() {
-    if (typeLen(r->lvl) < typeLen(Q)) {
-        l = r;
-        r = new Reg("r11");
-        mov();
+void CodeGen::push(Operand src) {
+    if (typeLen(src.lvl) < typeLen(Q)) {
+        mov(src, reg(R11));
+        src = reg(R11);
     }
-    out << "push" << r->lvl << ' ' << r << '\n';
+    out.instruction(AsmWriter::PUSH, src.lvl, src);
     offset += typeLen(Q);
 }
-void CodeGen::pop() {
-    if (typeLen(r->lvl) < typeLen(Q)) {
-        l = r;
-        r = new Reg("r11");
-        out << "pop" << r->lvl << ' ' << r << '\n';
-        r = l;
-        l = new Reg("r11");
-        mov();
+void CodeGen::pop(Operand dst) {
+    if (typeLen(dst.lvl) < typeLen(Q)) {
+        out.instruction(AsmWriter::POP, Q, reg(R11));
+        mov(reg(R11), dst);
     }
     else {
-        out << "pop" << r->lvl << ' ' << r << '\n';
+        out.instruction(AsmWriter::POP, dst.lvl, dst);
     }
     offset -= typeLen(Q);
 }
-void CodeGen::lea() {
-    out << "lea" << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::lea(Operand src, Operand dst) {
+    out.instruction(AsmWriter::LEA, dst.lvl, src, dst);
 }
-void CodeGen::cmp() {
-    out << "cmp" << r->lvl << ' ' << l << ", " << r << '\n';
+void CodeGen::cmp(Operand src, Operand dst) {
+    out.instruction(AsmWriter::CMP, dst.lvl, src, dst);
 }
-void CodeGen::jmp(C cond) {
-    if (cond!=NONE) {
-        out << "j" << cond;
-    }
-    else {
-        out << "jmp";
-    }
-    out << ' ' << r << '\n';
+void CodeGen::jmp(Operand target, C cond) {
+    out.instruction(AsmWriter::J, cond, target);
 }
 void CodeGen::jmp(string label, C cond) {
-    if (cond!=NONE) {
-        out << "j" << cond;
-    }
-    else {
-        out << "jmp";
-    }
-    out << ' ' << label << '\n';
+    out.jump(cond, label);
 }
-void CodeGen::set(C cond) {
-    out << "set" << cond << ' ' << r << '\n';
+void CodeGen::set(Operand dst, C cond) {
+    out.instruction(AsmWriter::SET, cond, dst);
 }
-void CodeGen::cmov(C cond) {
-    out << "cmov" << cond << ' ' << l << ", " << r << '\n';
+void CodeGen::cmov(Operand src, Operand dst, C cond) {
+    out.instruction(AsmWriter::CMOV, cond, src, dst);
 }
 void CodeGen::call(string label, bool external) {
     out << "call " << label << "\n";
     if (!external) offset += typeLen(Q);
 }
 void CodeGen::enter() {
-    r = new Reg("bp");
-    push();
-
-    l = new Reg("sp");
-    r = new Reg("bp");
-    mov();
+    push(reg(BP));
+    mov(reg(SP), reg(BP));
 
     bp.push(offset);
 }
@@ -369,9 +272,12 @@ int CodeGen::getReturnDeallocate() {
     // call (Q) will be restore with ret
     return offset - 2 * typeLen(Q);
 }
-int CodeGen::getOffset(string label, int idx) {
-    Value v = *(table->lookup(label));
-    return -1 * (int(v) + idx * typeLen(typeToL(v.type)));
+int CodeGen::getOffset(const Value& local, int idx) {
+    return -1 * (local.scalar + idx * typeLen(typeToL(local.type)));
+}
+Value CodeGen::local(int slot, Value::Type type) {
+    // a fn named where a variable goes has no slot, and sits at offset 0
+    return slot < 0 ? Value(type, int64_t(0)) : slots[slot];
 }
 
 // Destructor
@@ -380,20 +286,15 @@ CodeGen::~CodeGen() = default;
 // Visit methods for expressions
 Value CodeGen::visit(Block* block) {
     if (init) {
-        table->pushScope();
-
-        Value val;
         for(auto stmt : block->stmts) {
-            val = stmt->accept(this);
+            dispatch(stmt);
         }
 
-        table->popScope();
-
         return Value(block->type);
     }
     else {
         for(auto stmt : block->stmts) {
-            stmt->accept(this);
+            dispatch(stmt);
         }
         // toAllocate[curFun] = ((toAllocate[curFun] + 15) / 16) * 16;
 
@@ -403,78 +304,74 @@ Value CodeGen::visit(Block* block) {
 
 Value CodeGen::visit(BinaryExp* exp) {
     if (init) {
+        if (exp->op == BinaryExp::LAND || exp->op == BinaryExp::LOR) {
+            // the right side is only evaluated when the left one does not
+            // decide the value, as in Rust
+            accept(exp->lhs);
+            string done = ".LSC" + to_string(++lsc);
+            cmp(imm(0), reg(B));
+            jmp(done, exp->op == BinaryExp::LAND ? EQ : NE);
+            accept(exp->rhs);
+            out << done << ":\n";
+            return Value(Value::BOOL);
+        }
+
         auto lhs = accept(exp->lhs);
         L lvl = typeToL(lhs.type);
 
-        r = new Reg(lvl);
-        push();
+        push(reg(lvl));
 
-        auto rhs = accept(exp->rhs);
-        l = new Reg(lvl);
-        r = new Reg("c", lvl);
-        mov();
+        accept(exp->rhs);
+        mov(reg(lvl), reg(CX, lvl));
 
-        r = new Reg(lvl);
-        pop();
+        pop(reg(lvl));
 
-        l = new Reg("c", lvl);
-        r = new Reg(lvl);
+        Operand src = reg(CX, lvl);
+        Operand dst = reg(lvl);
         switch (exp->op) {
-            case BinaryExp::LAND:
-                land();
-                return Value(Value::BOOL);
-            case BinaryExp::LOR:
-                lor();
-                return Value(Value::BOOL);
             case BinaryExp::GT:
-                cmp();
-                r = new Reg(B);
-                set(GT);
+                cmp(src, dst);
+                set(reg(B), GT);
                 return Value(Value::BOOL);
             case BinaryExp::LT:
-                cmp();
-                r = new Reg(B);
-                set(LT);
+                cmp(src, dst);
+                set(reg(B), LT);
                 return Value(Value::BOOL);
             case BinaryExp::GE:
-                cmp();
-                r = new Reg(B);
-                set(GE);
+                cmp(src, dst);
+                set(reg(B), GE);
                 return Value(Value::BOOL);
             case BinaryExp::LE:
-                cmp();
-                r = new Reg(B);
-                set(LE);
+                cmp(src, dst);
+                set(reg(B), LE);
                 return Value(Value::BOOL);
             case BinaryExp::EQ:
-                cmp();
-                r = new Reg(B);
-                set(EQ);
+                cmp(src, dst);
+                set(reg(B), EQ);
                 return Value(Value::BOOL);
             case BinaryExp::NEQ:
-                cmp();
-                r = new Reg(B);
-                set(NE);
+                cmp(src, dst);
+                set(reg(B), NE);
                 return Value(Value::BOOL);
             case BinaryExp::PLUS:
-                add();
+                add(src, dst);
                 return Value(lhs.type);
             case BinaryExp::MINUS:
-                sub();
+                sub(src, dst);
                 return Value(lhs.type);
             case BinaryExp::TIMES:
-                mul();
+                mul(src, dst);
                 return Value(lhs.type);
             case BinaryExp::DIV:
-                div();
+                div(src, dst);
                 return Value(lhs.type);
             default:
                 throw std::runtime_error("Invalid binary operation");
         }
     }
     else {
-        exp->lhs->accept(this);
-        exp->rhs->accept(this);
+        dispatch(exp->lhs);
+        dispatch(exp->rhs);
         return {};
     }
 
@@ -487,10 +384,8 @@ Value CodeGen::visit(UnaryExp* exp) {
 
         switch (exp->op) {
             case UnaryExp::LNOT:
-                l = new Const(Value(Value::BOOL, 0));
-                r = new Reg(B);
-                cmp();
-                set(EQ);
+                cmp(imm(0), reg(B));
+                set(reg(B), EQ);
                 break;
             default:
                 throw std::runtime_error("Invalid unary operation");
@@ -499,7 +394,7 @@ Value CodeGen::visit(UnaryExp* exp) {
         return Value(Value::BOOL);
     }
     else {
-        exp->exp->accept(this);
+        dispatch(exp->exp);
         return {};
     }
 }
@@ -507,26 +402,21 @@ Value CodeGen::visit(UnaryExp* exp) {
 Value CodeGen::visit(Literal* exp) {
     if (init) {
         if (exp->value.type == Value::STR) {
-            Reg* reg = new Reg("ip");
-            l = new Mem(reg, string(exp->value));
-            r = new Reg();
-            lea();
+            lea(mem(IP, exp->value.text.str()), reg());
             exp->value.ref = false;
         }
         else {
             L lvl = valueToL(exp->value);
-            l = new Const(exp->value, lvl);
-            r = new Reg(lvl);
-            mov();
+            mov(imm(exp->value.scalar, lvl), reg(lvl));
         }
         return exp->value;
     }
     else {
         if (exp->value.type == Value::STR) {
-            string label = LCLabel(exp->value.stringValues.front());
+            string label = LCLabel(exp->value.text.str());
 
             exp->value.type = Value::STR;
-            exp->value.stringValues.front() = label;
+            exp->value.text = Interner::intern(label);
         }
         return {};
     }
@@ -534,24 +424,19 @@ Value CodeGen::visit(Literal* exp) {
 
 Value CodeGen::visit(Variable* exp) {
     if (init) {
-        Value value = *(table->lookup(exp->name));
+        Value value = local(exp->slot, exp->type);
 
-        Reg* reg = new Reg("bp");
         if (value.size && !inLhs) {
             auto it2 = funCallArgs.begin();
 
             L lvl = typeToL(value.type);
 
             for (int i=0; i<value.size; ++i, ++it2) {
-                l = new Mem(reg, getOffset(exp->name, i), lvl);
-                r = new Reg(*it2, lvl);
-                mov();
+                mov(mem(BP, getOffset(value, i), lvl), reg(*it2, lvl));
             }
         }
         else {
-            l = new Mem(reg, getOffset(exp->name));
-            r = new Reg();
-            lea();
+            lea(mem(BP, getOffset(value)), reg());
         }
 
         return value;
@@ -569,18 +454,16 @@ Value CodeGen::visit(FunCall* exp) {
             Value value = accept(*it);
             L lvl = typeToL(value.type);
 
-            l = new Reg(lvl);
-            r = new Reg(*it2, lvl);
-            mov();
+            mov(reg(lvl), reg(*it2, lvl));
         }
 
-        call(exp->id);
+        call(exp->id.str());
 
         return Value(exp->type);
     }
     else {
         for (auto arg : exp->args) {
-            arg->accept(this);
+            dispatch(arg);
         }
         return {};
     }
@@ -592,11 +475,9 @@ Value CodeGen::visit(IfExp* exp) {
 
         L lvl = B;
 
-        Value value = accept(exp->ifBranch->cond);
+        accept(exp->ifBranch->cond);
 
-        l = new Const(Value(Value::BOOL, 0));
-        r = new Reg(lvl);
-        cmp();
+        cmp(imm(0), reg(lvl));
 
         string nextLabel = end(label);
         if (!exp->elseIfBranches.empty() || exp->elseBranch) {
@@ -604,7 +485,7 @@ Value CodeGen::visit(IfExp* exp) {
         }
         jmp(nextLabel, EQ);
 
-        exp->ifBranch->block->accept(this);
+        dispatch(exp->ifBranch->block);
 
         if (nextLabel != end(label)) jmp(end(label));
 
@@ -620,29 +501,27 @@ Value CodeGen::visit(IfExp* exp) {
 
             accept(br->cond);
 
-            l = new Const(Value(Value::BOOL, 0));
-            r = new Reg(lvl);
-            cmp();
+            cmp(imm(0), reg(lvl));
             jmp(nextLabel, EQ);
 
-            br->block->accept(this);
+            dispatch(br->block);
 
             if (nextLabel != end(label)) jmp(end(label));
         }
         if (exp->elseBranch) {
             LIBLabel2();
-            exp->elseBranch->block->accept(this);
+            dispatch(exp->elseBranch->block);
         }
 
         LIELabel();
         return {exp->type};
     }
     else {
-        exp->ifBranch->block->accept(this);
+        dispatch(exp->ifBranch->block);
         for (auto branch : exp->elseIfBranches) {
-            branch->block->accept(this);
+            dispatch(branch->block);
         }
-        if (exp->elseBranch) exp->elseBranch->block->accept(this);
+        if (exp->elseBranch) dispatch(exp->elseBranch->block);
         return {};
     }
 }
@@ -650,44 +529,33 @@ Value CodeGen::visit(IfExp* exp) {
 Value CodeGen::visit(LoopExp* exp) {
     if (init) {
         LBLabel();
-        exp->block->accept(this);
+        dispatch(exp->block);
         jmp(labels.top());
         LELabel();
         return {exp->type};
     }
     else {
-        exp->block->accept(this);
+        dispatch(exp->block);
         return {};
     }
 }
 
 Value CodeGen::visit(SubscriptExp* exp) {
     if (init) {
-        Reg* reg = new Reg("bp");
-        l = new Mem(reg, getOffset(exp->id));
-        r = new Reg();
-        lea();
+        lea(mem(BP, getOffset(local(exp->slot, exp->type))), reg());
 
-        r = new Reg();
-        push();
+        push(reg());
 
         auto value = accept(exp->exp);
         L lvl = valueToL(value);
 
-        l = new Reg(lvl);
-        r = new Reg("c", lvl);
-        mov();
+        mov(reg(lvl), reg(CX, lvl));
 
-        l = new Const(Value(Value::I64, typeLen(value)));
-        r = new Reg("c");
-        mul();
+        mul(imm(typeLen(value)), reg(CX));
 
-        r = new Reg();
-        pop();
+        pop(reg());
 
-        l = new Reg("c");
-        r = new Reg();
-        sub();
+        sub(reg(CX), reg());
 
         value = Value(exp->type);
         value.ref = true;
@@ -712,13 +580,13 @@ Value CodeGen::visit(SliceExp* exp) {
 
 Value CodeGen::visit(ReferenceExp* exp) {
     if (init) {
-        auto value = exp->exp->accept(this);
+        auto value = dispatch(exp->exp);
         value.type = Value::I64;
         value.ref = false;
         return value;
     }
     else {
-        exp->exp->accept(this);
+        dispatch(exp->exp);
         return {};
     }
 }
@@ -728,12 +596,10 @@ Value CodeGen::visit(ArrayExp* exp) {
         auto it2 = funCallArgs.begin();
 
         for (auto el : exp->elements) {
-            auto value = accept(el);
+            accept(el);
             L lvl = typeToL(exp->type);
 
-            l = new Reg(lvl);
-            r = new Reg(*it2, lvl);
-            mov();
+            mov(reg(lvl), reg(*it2, lvl));
 
             ++it2;
         }
@@ -744,7 +610,7 @@ Value CodeGen::visit(ArrayExp* exp) {
     }
     else {
         for (auto el : exp->elements) {
-            el->accept(this);
+            dispatch(el);
         }
         return {};
     }
@@ -752,33 +618,25 @@ Value CodeGen::visit(ArrayExp* exp) {
 
 Value CodeGen::visit(UniformArrayExp* exp) {
     if (init) {
-        auto size = accept(exp->size);
-        r = new Reg();
-        push();
+        accept(exp->size);
+        push(reg());
 
         auto value = accept(exp->value);
         L lvl = valueToL(value);
 
-        r = new Reg("c");
-        pop();
+        pop(reg(CX));
 
-        l = new Const(Value(Value::I64, 0));
-        r = new Reg("r11");
-        mov();
+        mov(imm(0), reg(R11));
 
         LBLabel();
 
-        l = new Reg("c");
-        r = new Reg("r11");
-        cmp();
+        cmp(reg(CX), reg(R11));
 
         jmp(end(labels.top()), GE);
 
-        r = new Reg(lvl);
-        push();
+        push(reg(lvl));
 
-        r = new Reg("r11");
-        inc();
+        inc(reg(R11));
         jmp(labels.top());
 
         LELabel();
@@ -788,7 +646,7 @@ Value CodeGen::visit(UniformArrayExp* exp) {
         return ret;
     }
     else {
-        exp->value->accept(this);
+        dispatch(exp->value);
         return {};
     }
 }
@@ -804,30 +662,25 @@ Value CodeGen::visit(DecStmt* stmt) {
         Value val = Value(value.type, allocated[curFun]);
         val.ref = true;
         val.size = value.size;
-        table->declare(stmt->id, val);
+        slots[stmt->slot] = val;
 
-        Reg* reg = new Reg("bp");
 
         if (stmt->rhs) {
             if (value.size) {
-                auto rhs = stmt->rhs->accept(this);
+                dispatch(stmt->rhs);
 
                 auto it2 = funCallArgs.begin();
 
                 for (int i=0; i<value.size; ++i, ++it2) {
-                    l = new Reg(*it2, lvl);
-                    r = new Mem(reg, getOffset(stmt->id, i), lvl);
-                    mov();
+                    mov(reg(*it2, lvl), mem(BP, getOffset(val, i), lvl));
                 }
 
                 allocated[curFun] += typeLen(value) - typeLen(lvl);
             }
             else {
-                auto rhs = accept(stmt->rhs);
+                accept(stmt->rhs);
 
-                l = new Reg(lvl);
-                r = new Mem(reg, getOffset(stmt->id), lvl);
-                mov();
+                mov(reg(lvl), mem(BP, getOffset(val), lvl));
             }
         }
         return Value(Value::UNIT, 0);
@@ -835,7 +688,7 @@ Value CodeGen::visit(DecStmt* stmt) {
     else {
         toAllocate[curFun] += typeLen(stmt->var);
         if (stmt->var.type == Value::STR) {
-            if (stmt->rhs) stmt->rhs->accept(this);
+            if (stmt->rhs) dispatch(stmt->rhs);
         }
         return {};
     }
@@ -844,112 +697,91 @@ Value CodeGen::visit(DecStmt* stmt) {
 Value CodeGen::visit(AssignStmt* stmt) {
     if (init) {
         inLhs = true;
-        auto lhs = stmt->lhs->accept(this);
+        auto lhs = dispatch(stmt->lhs);
         inLhs = false;
 
         L lvl = typeToL(lhs.type);
 
         if (lhs.size == 0) {
-            r = new Reg();
-            push();
+            push(reg());
 
             auto rhs = accept(stmt->rhs);
 
-            r = new Reg("c");
-            pop();
+            pop(reg(CX));
 
-            l = new Reg(valueToL(rhs));
-            auto reg = new Reg("c");
-            r = new Mem(reg, 0);
-            mov();
+            mov(reg(valueToL(rhs)), mem(CX, 0));
         }
         else {
-            auto rhs = stmt->rhs->accept(this);
+            dispatch(stmt->rhs);
 
             auto it2 = funCallArgs.begin();
 
-            string id;
+            int slot = -1;
             // Lhs is either Variable
-            auto var = dynamic_cast<Variable*>(stmt->lhs);
-            if (var) {
-                id = var->name;
+            if (stmt->lhs->kind == Exp::VARIABLE) {
+                slot = static_cast<Variable*>(stmt->lhs)->slot;
             }
             // or SubscriptExp
-            auto var2 = dynamic_cast<SubscriptExp*>(stmt->lhs);
-            if (var2) {
-                id = var2->id;
+            if (stmt->lhs->kind == Exp::SUBSCRIPT) {
+                slot = static_cast<SubscriptExp*>(stmt->lhs)->slot;
             }
 
-            Value value = *(table->lookup(id));
+            Value value = local(slot, lhs.type);
 
-            auto reg = new Reg("bp");
             for (int i=0; i<value.size; ++i, ++it2) {
-                l = new Reg(*it2, lvl);
-                r = new Mem(reg, getOffset(id, i), lvl);
-                mov();
+                mov(reg(*it2, lvl), mem(BP, getOffset(value, i), lvl));
             }
         }
         return Value(Value::UNIT, 0);
     }
     else {
-        stmt->rhs->accept(this);
+        dispatch(stmt->rhs);
         return {};
     }
 }
 
 Value CodeGen::visit(CompoundAssignStmt* stmt) {
     if (init) {
-        auto lhs = stmt->lhs->accept(this);
+        auto lhs = dispatch(stmt->lhs);
 
         L ptrLen = valueToL(lhs);
         L lvl = typeToL(lhs.type);
 
         // store temporarily address of lhs
-        l = new Reg(ptrLen);
-        r = new Reg("b", ptrLen);
-        mov();
+        mov(reg(ptrLen), reg(BX, ptrLen));
 
         // push value in address
-        Reg* reg = new Reg(ptrLen);
-        l = new Mem(reg, 0);
-        r = new Reg(lvl);
-        mov();
-        push();
+        mov(mem(AX, 0), reg(lvl));
+        push(reg(lvl));
 
-        auto rhs = accept(stmt->rhs);
+        accept(stmt->rhs);
 
-        l = new Reg(lvl);
-        r = new Reg("c", lvl);
-        mov();
+        mov(reg(lvl), reg(CX, lvl));
 
-        r = new Reg(lvl);
-        pop();
+        pop(reg(lvl));
 
-        l = new Reg("c", lvl);
-        r = new Reg(lvl);
+        Operand src = reg(CX, lvl);
+        Operand dst = reg(lvl);
 
         switch (stmt->op) {
             case BinaryExp::PLUS:
-                add();
+                add(src, dst);
                 break;
             case BinaryExp::MINUS:
-                sub();
+                sub(src, dst);
                 break;
             case BinaryExp::TIMES:
-                mul();
+                mul(src, dst);
                 break;
             case BinaryExp::DIV:
-                div();
+                div(src, dst);
                 break;
             default:
                 throw std::runtime_error("Invalid binary operation");
         }
 
         // store result of operation in previously cached address
-        l = new Reg(lvl);
-        reg = new Reg("b");
-        r = new Mem(reg, 0, ptrLen);
-        mov();
+        mov(reg(lvl), mem(BX, 0, ptrLen));
 
         return Value(Value::UNIT);
     }
@@ -960,43 +792,40 @@ Value CodeGen::visit(CompoundAssignStmt* stmt) {
 
 Value CodeGen::visit(ForStmt* stmt) {
     if (init) {
-        table->pushScope();
-
         auto value = accept(stmt->start);
         L lvl = valueToL(value);
 
         allocated[curFun] += typeLen(lvl);
-        table->declare(stmt->id, Value(value.type, allocated[curFun], true));
+        slots[stmt->slot] = Value(value.type, allocated[curFun], true);
 
-        l = new Reg(lvl);
-        Reg* reg = new Reg("bp");
-        auto it = new Mem(reg, getOffset(stmt->id), lvl);
-        r = it;
-        mov();
+        Operand it = mem(BP, getOffset(slots[stmt->slot]), lvl);
+        mov(reg(lvl), it);
 
-        LBLabel();
+        // the end is evaluated once, before the first iteration, as in Rust
         value = accept(stmt->end);
-        l = new Reg(valueToL(value));
-        r = it;
-        cmp();
+        L endLvl = valueToL(value);
+        allocated[curFun] += typeLen(endLvl);
+        Operand last = mem(BP, -allocated[curFun], endLvl);
+        mov(reg(endLvl), last);
+
+        LBLabel();
+        mov(last, reg(endLvl));
+        cmp(reg(endLvl), it);
 
         jmp(end(labels.top()), stmt->inclusive ? GT : GE);
 
-        stmt->block->accept(this);
+        dispatch(stmt->block);
 
-        r = it;
-        inc();
+        inc(it);
         jmp(labels.top());
 
         LELabel();
 
-        table->popScope();
-
         return Value(Value::UNIT, 0);
     }
     else {
-        toAllocate[curFun] += typeLen(stmt->start->type);
-        stmt->block->accept(this);
+        toAllocate[curFun] += typeLen(stmt->start->type) + typeLen(stmt->end->type);
+        dispatch(stmt->block);
         return {};
     }
 }
@@ -1005,14 +834,12 @@ Value CodeGen::visit(WhileStmt* stmt) {
     if (init) {
         LBLabel();
 
-        auto value = accept(stmt->cond);
-        l = new Const(Value(Value::I64, 0));
-        r = new Reg();
-        cmp();
+        accept(stmt->cond);
+        cmp(imm(0), reg());
 
         jmp(end(labels.top()), EQ);
 
-        stmt->block->accept(this);
+        dispatch(stmt->block);
 
         jmp(labels.top());
 
@@ -1020,7 +847,7 @@ Value CodeGen::visit(WhileStmt* stmt) {
         return Value(Value::UNIT, 0);
     }
     else {
-        stmt->block->accept(this);
+        dispatch(stmt->block);
         return {};
     }
 }
@@ -1030,10 +857,7 @@ Value CodeGen::visit(PrintStmt* stmt) {
     if (init) {
         auto it2 = funCallArgs.begin();
 
-        Reg* reg = new Reg("ip");
-        l = new Mem(reg, stmt->strLiteral);
-        r = new Reg(*it2);
-        lea();
+        lea(mem(IP, stmt->label), reg(*it2));
 
         for (auto it = stmt->args.begin(); it != stmt->args.end(); ++it) {
             ++it2;
@@ -1042,51 +866,34 @@ Value CodeGen::visit(PrintStmt* stmt) {
 
             L lvl = typeToL(value.type);
 
-            Reg* valReg = new Reg(lvl);
+            Operand valReg = reg(lvl);
 
             if (value.type == Value::BOOL) {
                 // bool value in valReg -> convert to pointer to "true"/"false"
-                Reg* regTrue = new Reg("r11");
-                reg = new Reg("ip");
-                l = new Mem(reg, boolTrueLabel);
-                r = regTrue;
-                lea();
-
-                Reg* regFalse = new Reg("r12");
-                reg = new Reg("ip");
-                l = new Mem(reg, boolFalseLabel);
-                r = regFalse;
-                lea();
-
-                l = new Const(Value(Value::BOOL, 0));
-                r = valReg;
-                cmp();
-
-                l = regFalse;
-                r = regTrue;
-                cmov(EQ);
-
-                l = regTrue;
-                r = new Reg(*it2);
-                mov();
+                Operand regTrue = reg(R11);
+                lea(mem(IP, boolTrueLabel), regTrue);
+
+                Operand regFalse = reg(R12);
+                lea(mem(IP, boolFalseLabel), regFalse);
+
+                cmp(imm(0), valReg);
+
+                cmov(regFalse, regTrue, EQ);
+
+                mov(regTrue, reg(*it2));
             } else {
-                l = valReg;
-                r = new Reg(*it2);
-                mov();
+                mov(valReg, reg(*it2));
             }
         }
 
-        l = new Const(Value(Value::I64, 0));
-        r = new Reg();
-        mov();
+        mov(imm(0), reg());
 
         call(print, true);
 
         return Value (Value::UNIT, 0);
     }
     else {
-        string s = LCLabel(stmt->strLiteral);
-        stmt->strLiteral = s;
+        stmt->label = LCLabel(stmt->format);
         return {};
     }
 }
@@ -1095,13 +902,13 @@ Value CodeGen::visit(BreakStmt* stmt) {
     if (init) {
         Value value (Value::UNIT, 0);
         if (stmt->exp) {
-            value = stmt->exp->accept(this);
+            value = dispatch(stmt->exp);
         }
         jmp(end(labels.top()));
         return value;
     }
     else {
-        if (stmt->exp) stmt->exp->accept(this);
+        if (stmt->exp) dispatch(stmt->exp);
         return {};
     }
 }
@@ -1114,9 +921,7 @@ Value CodeGen::visit(ReturnStmt* stmt) {
         }
         else {
             value = Value(Value::UNIT, 0);
-            l = new Const(value);
-            r = new Reg("a", l->lvl);
-            mov();
+            mov(imm(value.scalar), reg(AX));
         }
 
         jmp(getCurFunLbl());
@@ -1124,53 +929,48 @@ Value CodeGen::visit(ReturnStmt* stmt) {
         return value;
     }
     else {
-        stmt->exp->accept(this);
+        dispatch(stmt->exp);
         return {};
     }
 }
 
 Value CodeGen::visit(ExpStmt* stmt) {
     if (init) {
-        return stmt->exp->accept(this);
+        return dispatch(stmt->exp);
     }
     else {
-        return stmt->exp->accept(this);
+        return dispatch(stmt->exp);
     }
 }
 
 // Visit methods for functions and programs
 Value CodeGen::visit(Fun* fun) {
     if (init) {
-        table->pushScope();
+        slots.assign(fun->slots, Value());
 
         subSP(toAllocate[curFun]);
 
         // assigning arguments to parameters
         auto it2 = funCallArgs.begin();
-        Reg* reg = new Reg("bp");
 
-        for (auto param : fun->params) {
-            L lvl = typeToL(param.type);
+        for (size_t i = 0; i < fun->params.size(); ++i) {
+            L lvl = typeToL(fun->params[i].type);
 
             allocated[curFun] += typeLen(lvl);
 
-            Value value = Value(param.type, allocated[curFun]);
+            Value value = Value(fun->params[i].type, allocated[curFun]);
             value.ref = true;
-            table->declare(param.id, value);
+            slots[i] = value;
 
-            l = new Reg(*it2, lvl);
-            r = new Mem(reg, getOffset(param.id), lvl);
-            mov();
+            mov(reg(*it2, lvl), mem(BP, getOffset(value), lvl));
 
             ++it2;
         }
 
-        fun->block->accept(this);
+        dispatch(fun->block);
 
         addSP(toAllocate[curFun]);
 
-        table->popScope();
-
         return Value(fun->type);
     }
     else {
@@ -1178,14 +978,12 @@ Value CodeGen::visit(Fun* fun) {
             L lvl = typeToL(param.type);
             toAllocate[curFun] += typeLen(lvl);
         }
-        fun->block->accept(this);
+        dispatch(fun->block);
         return {};
     }
 }
 
 void CodeGen::visit(Program* program) {
-    table->pushScope();
-
     // emit boolean string constants once
     out << ".section .rodata\n";
     if (boolTrueLabel.empty()) {
@@ -1194,18 +992,11 @@ void CodeGen::visit(Program* program) {
     }
 
     for (auto [id, fun] : program->funs) {
-        Value value (fun->type, id);
-        value.fun = true;
-        for (auto param : fun->params) {
-            value.addType(param.type);
-        }
-        table->declare(id, value);
-
         curFun = id;
 
         out << ".section .rodata\n";
         init = false;
-        fun->accept(this);
+        dispatch(fun);
 
         // prologue
         init = true;
@@ -1218,7 +1009,7 @@ void CodeGen::visit(Program* program) {
         LFBLabel();
         enter();
 
-        fun->accept(this);
+        dispatch(fun);
 
         // epilogue
         LFELabel();
@@ -1226,57 +1017,45 @@ void CodeGen::visit(Program* program) {
         ret();
     }
 
-    table->popScope();
-    out << ".section .note.GNU-stack,\"\",@progbits"<<endl;
+    out << ".section .note.GNU-stack,\"\",@progbits\n";
+    out.flush();
 }
 
 Value CodeGen::accept(Block* block) {
-    Value value = block->accept(this);
+    Value value = dispatch(block);
 
     if (value.ref) {
-        Reg* reg = new Reg();
-        l = new Mem(reg, 0);
-        r = new Reg(typeToL(value.type));
-        mov();
+        mov(mem(AX, 0), reg(typeToL(value.type)));
     }
 
     value.ref = false;
     return value;
 }
 Value CodeGen::accept(Exp* exp) {
-    Value value = exp->accept(this);
+    Value value = dispatch(exp);
 
     if (value.ref) {
-        Reg* reg = new Reg();
-        l = new Mem(reg, 0);
-        r = new Reg(typeToL(value.type));
-        mov();
+        mov(mem(AX, 0), reg(typeToL(value.type)));
         value.ref = false;
     }
 
     return value;
 }
 Value CodeGen::accept(Stmt* stmt) {
-    Value value = stmt->accept(this);
+    Value value = dispatch(stmt);
 
     if (value.ref) {
-        Reg* reg = new Reg();
-        l = new Mem(reg, 0);
-        r = new Reg(typeToL(value.type));
-        mov();
+        mov(mem(AX, 0), reg(typeToL(value.type)));
         value.ref = false;
     }
 
     return value;
 }
 Value CodeGen::accept(Fun* fun) {
-    Value value = fun->accept(this);
+    Value value = dispatch(fun);
 
     if (value.ref) {
-        Reg* reg = new Reg();
-        l = new Mem(reg, 0);
-        r = new Reg(typeToL(value.type));
-        mov();
+        mov(mem(AX, 0), reg(typeToL(value.type)));
         value.ref = false;
     }
 
@@ -1,122 +1,49 @@
 #ifndef RUSTY_GENCODE_H
 #define RUSTY_GENCODE_H
 
+#include "AsmWriter.h"
 #include "Visitor.h"
-#include <map>
+#include <list>
+#include <unordered_map>
 #include <stack>
 
 using namespace std;
 
-enum L {B, W, D, Q};
-enum C {NONE, EQ, NE, GT, LT, GE, LE};
-
-class Operand {
-public:
-    L lvl {L::Q};
-    Operand(L lvl) : lvl(lvl) {}
-    virtual ~Operand() = 0;
-    virtual void print(std::ostream &out) = 0;
-    friend ostream& operator<<(ostream& out, Operand* op);
-};
-
-class Reg : public Operand {
-    friend class CodeGen;
-
-    string reg {"a"};
-    Reg(L lvl = Q) : Operand(lvl) {}
-    Reg(string reg, L lvl = Q) : Operand(lvl), reg(reg) {}
-public:
-    ~Reg();
-    void print(std::ostream &out) override;
-};
-
-class Const : public Operand {
-    friend class CodeGen;
-
-    Value value {};
-    Const(Value value, L lvl = Q) : Operand(lvl), value(value) {
-        switch(value.type) {
-            case Value::CHAR:
-                value.numericValues.push_back(
-                    value.stringValues.front()[0]
-                );
-            case Value::I8:
-            case Value::BOOL:
-                lvl = B;
-                break;
-            case Value::I16:
-                lvl = W;
-                break;
-            case Value::I32:
-                lvl = D;
-                break;
-            default: lvl = Q;
-        }
-    }
-public:
-    ~Const();
-    void print(std::ostream &out) override;
-};
-
-class Mem : public Operand {
-    friend class CodeGen;
-
-    Reg* reg;
-    int offset {};
-    string label {};
-    Mem(Reg* reg, int offset, L lvl = Q) 
-    : Operand(lvl), reg(reg), offset(offset) {
-        if (reg->lvl != Q) throw runtime_error("nonono");
-    }
-    Mem(Reg* reg, string label, L lvl = Q) 
-    : Operand(lvl), reg(reg), label(label) {
-        if (reg->lvl != Q) throw runtime_error("nonono");
-    }
-    Mem(Reg* reg, int offset, string label, L lvl = Q) 
-    : Operand(lvl), reg(reg), offset(offset), label(label) {
-        if (reg->lvl != Q) throw runtime_error("nonono");
-    }
-public:
-    ~Mem();
-    void print(std::ostream &out) override;
-};
-
-class CodeGen : public Visitor {
+class CodeGen final : public PassVisitor<CodeGen> {
 private:
-    ostream& out;
+    AsmWriter out;
 
     char nextL(L lvl);
     L valueToL(Value value);
     L typeToL(Value::Type type);
     Value::Type LToNumericType(L lvl);
 
-    void mov();
-    void movz();
-    void movs();
+    // emitters; a two-operand instruction reads src and writes dst
+    void mov(Operand src, Operand dst);
+    void movz(Operand src, Operand dst);
+    void movs(Operand src, Operand dst);
     // arithmetic
-    void add();
+    void add(Operand src, Operand dst);
     void addSP(int off, bool early=false);
-    void inc();
-    void sub();
+    void inc(Operand dst);
+    void sub(Operand src, Operand dst);
     void subSP(int off);
-    void dec();
-    void mul();
-    void div();
-    void land();
-    void lor();
-    void lnot();
-    void bnot();
+    void dec(Operand dst);
+    void mul(Operand src, Operand dst);
+    void div(Operand divisor, Operand dividend);
+    void lnot(Operand dst);
+    void bnot(Operand dst);
     // stack
-    void push();
-    void pop();
+    void push(Operand src);
+    void pop(Operand dst);
     // memory
-    void lea();
+    void lea(Operand src, Operand dst);
     // conditional
-    void cmp();
-    void jmp(C=NONE);
+    void cmp(Operand src, Operand dst);
+    void jmp(Operand target, C=NONE);
     void jmp(string label, C=NONE);
-    void set(C=NONE);
-    void cmov(C=NONE);
+    void set(Operand dst, C=NONE);
+    void cmov(Operand src, Operand dst, C=NONE);
     void call(string label, bool exteneral=false);
     void enter();
     void leave(bool early=false);
@@ -134,37 +61,41 @@ private:
     string getCurFunLbl();
     string end(string label);
     int getReturnDeallocate();
-    int getOffset(string label, int idx=0);
+    int getOffset(const Value& local, int idx=0);
+    Value local(int slot, Value::Type type);
 
     int lb {};
     int lc {};
     int lf {};
     int lib {};
     int lie {};
+    // labels that end a && or ||
+    int lsc {};
     stack<int> lis;
     stack<int> lbs;
     stack<int> bp {};
     stack<string> labels {};
-    string curFun {};
+    Symbol curFun {};
     int offset {};
     bool init {};
     bool inLhs {};
-    Operand* l;
-    Operand* r;
-    map<string, int> allocated;
-    map<string, int> toAllocate;
+    unordered_map<Symbol, int> allocated;
+    unordered_map<Symbol, int> toAllocate;
+    // locals of the function being emitted, indexed by the slots NameRes gave
+    // them; each holds its frame offset in the scalar
+    vector<Value> slots;
 
     // labels for boolean printing
     std::string boolTrueLabel;
     std::string boolFalseLabel;
 
-    std::list<string> funCallArgs = {"di", "si", "d", "c", "r8", "r9"};
+    std::list<Register> funCallArgs = {DI, SI, DX, CX, R8, R9};
 
 public:
     CodeGen(SymbolTable* table, std::ostream& out)
-        : Visitor(table), out(out), boolTrueLabel(), boolFalseLabel() {}
+        : PassVisitor(table), out(out), boolTrueLabel(), boolFalseLabel() {}
     explicit CodeGen(std::ostream& out)
-        : Visitor(nullptr), out(out), boolTrueLabel(), boolFalseLabel() {}
+        : PassVisitor(nullptr), out(out), boolTrueLabel(), boolFalseLabel() {}
     ~CodeGen() override;
     static int typeLen(L lvl);
     static int typeLen(Value value);
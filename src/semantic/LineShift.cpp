@@ -0,0 +1,180 @@
+#include "LineShift.h"
+
+// LINE SHIFT VISITOR
+
+LineShift::~LineShift() = default;
+
+void LineShift::shift(Fun* fun, int delta) {
+    if (delta == 0) return;
+    this->delta = delta;
+    dispatch(fun);
+}
+
+Value LineShift::visit(Block* block) {
+    block->line += delta;
+    for (Stmt* stmt : block->stmts) {
+        dispatch(stmt);
+    }
+    return {};
+}
+
+Value LineShift::visit(BinaryExp* exp) {
+    exp->line += delta;
+    dispatch(exp->lhs);
+    dispatch(exp->rhs);
+    return {};
+}
+
+Value LineShift::visit(UnaryExp* exp) {
+    exp->line += delta;
+    dispatch(exp->exp);
+    return {};
+}
+
+Value LineShift::visit(Literal* exp) {
+    exp->line += delta;
+    return {};
+}
+
+Value LineShift::visit(Variable* exp) {
+    exp->line += delta;
+    return {};
+}
+
+Value LineShift::visit(FunCall* exp) {
+    exp->line += delta;
+    for (Exp* arg : exp->args) {
+        dispatch(arg);
+    }
+    return {};
+}
+
+Value LineShift::visit(IfExp* exp) {
+    exp->line += delta;
+    dispatch(exp->ifBranch->getCondition());
+    dispatch(exp->ifBranch->getBlock());
+    for (auto& br : exp->elseIfBranches) {
+        dispatch(br->getCondition());
+        dispatch(br->getBlock());
+    }
+    if (exp->elseBranch) {
+        dispatch(exp->elseBranch->getBlock());
+    }
+    return {};
+}
+
+Value LineShift::visit(LoopExp* exp) {
+    exp->line += delta;
+    dispatch(exp->block);
+    return {};
+}
+
+Value LineShift::visit(SubscriptExp* exp) {
+    exp->line += delta;
+    dispatch(exp->exp);
+    return {};
+}
+
+Value LineShift::visit(SliceExp* exp) {
+    exp->line += delta;
+    if (exp->start) dispatch(exp->start);
+    if (exp->end) dispatch(exp->end);
+    return {};
+}
+
+Value LineShift::visit(ReferenceExp* exp) {
+    exp->line += delta;
+    dispatch(exp->exp);
+    return {};
+}
+
+Value LineShift::visit(ArrayExp* exp) {
+    exp->line += delta;
+    for (Exp* element : exp->elements) {
+        dispatch(element);
+    }
+    return {};
+}
+
+Value LineShift::visit(UniformArrayExp* exp) {
+    exp->line += delta;
+    dispatch(exp->value);
+    dispatch(exp->size);
+    return {};
+}
+
+Value LineShift::visit(DecStmt* stmt) {
+    stmt->line += delta;
+    if (stmt->rhs) dispatch(stmt->rhs);
+    return {};
+}
+
+Value LineShift::visit(AssignStmt* stmt) {
+    stmt->line += delta;
+    dispatch(stmt->lhs);
+    dispatch(stmt->rhs);
+    return {};
+}
+
+Value LineShift::visit(CompoundAssignStmt* stmt) {
+    stmt->line += delta;
+    dispatch(stmt->lhs);
+    dispatch(stmt->rhs);
+    return {};
+}
+
+Value LineShift::visit(ForStmt* stmt) {
+    stmt->line += delta;
+    dispatch(stmt->start);
+    dispatch(stmt->end);
+    dispatch(stmt->block);
+    return {};
+}
+
+Value LineShift::visit(WhileStmt* stmt) {
+    stmt->line += delta;
+    dispatch(stmt->cond);
+    dispatch(stmt->block);
+    return {};
+}
+
+Value LineShift::visit(PrintStmt* stmt) {
+    stmt->line += delta;
+    for (Exp* arg : stmt->args) {
+        dispatch(arg);
+    }
+    return {};
+}
+
+Value LineShift::visit(BreakStmt* stmt) {
+    stmt->line += delta;
+    if (stmt->exp) dispatch(stmt->exp);
+    return {};
+}
+
+Value LineShift::visit(ReturnStmt* stmt) {
+    stmt->line += delta;
+    if (stmt->exp) dispatch(stmt->exp);
+    return {};
+}
+
+Value LineShift::visit(ExpStmt* stmt) {
+    stmt->line += delta;
+    if (stmt->exp) dispatch(stmt->exp);
+    return {};
+}
+
+Value LineShift::visit(Fun* fun) {
+    fun->line += delta;
+    for (auto& param : fun->params) {
+        param.line += delta;
+    }
+    dispatch(fun->block);
+    return {};
+}
+
+void LineShift::visit(Program* program) {
+    for (const auto& [id, fun] : program->funs) {
+        dispatch(fun);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef LINESHIFT_H
+#define LINESHIFT_H
+
+#include "Visitor.h"
+
+// Moves every node of a function by a number of lines, so that a subtree
+// parsed before an edit above it can be reused instead of parsed again.
+class LineShift final : public PassVisitor<LineShift> {
+public:
+    LineShift() : PassVisitor(&unused) {}
+    ~LineShift() override;
+
+    void shift(Fun* fun, int delta);
+
+    Value visit(Block* block) override;
+    Value visit(BinaryExp* exp) override;
+    Value visit(UnaryExp* exp) override;
+    Value visit(Literal* exp) override;
+    Value visit(Variable* exp) override;
+    Value visit(FunCall* exp) override;
+    Value visit(IfExp* exp) override;
+    Value visit(LoopExp* exp) override;
+    Value visit(SubscriptExp* exp) override;
+    Value visit(SliceExp* exp) override;
+    Value visit(ReferenceExp* exp) override;
+    Value visit(ArrayExp* exp) override;
+    Value visit(UniformArrayExp* exp) override;
+    Value visit(DecStmt* stmt) override;
+    Value visit(AssignStmt* stmt) override;
+    Value visit(CompoundAssignStmt* stmt) override;
+    Value visit(ForStmt* stmt) override;
+    Value visit(WhileStmt* stmt) override;
+    Value visit(PrintStmt* stmt) override;
+    Value visit(BreakStmt* stmt) override;
+    Value visit(ReturnStmt* stmt) override;
+    Value visit(ExpStmt* stmt) override;
+    Value visit(Fun* fun) override;
+    void visit(Program* program) override;
+
+private:
+    // the walk never declares anything; the table only satisfies Visitor
+    SymbolTable unused;
+    int delta {};
+};
+
+#endif
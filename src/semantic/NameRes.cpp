@@ -5,41 +5,121 @@
 
 NameRes::~NameRes() = default;
 
-void NameRes::declare(const std::string& id, const Value& val, int line, int col) const {
+void NameRes::declare(Symbol id, const Value& val, int line, int col) const {
     if (!table->declare(id, val)) {
         throw std::runtime_error("redeclaration on the same scope " + std::to_string(line) + ':' + std::to_string(col));
     }
 }
 
-void NameRes::update(const std::string& id, const Value& val, int line, int col) const {
+void NameRes::update(Symbol id, const Value& val, int line, int col) const {
     if (!table->update(id, val)) {
-        throw std::runtime_error("update of undefined identifier '" + id + "' at " + std::to_string(line) + ':' + std::to_string(col));
+        throw std::runtime_error("update of undefined identifier '" + id.str() + "' at " + std::to_string(line) + ':' + std::to_string(col));
     }
 }
 
-Value NameRes::lookup(const std::string& id, int line, int col) const {
+Value NameRes::lookup(Symbol id, int line, int col) const {
     if (auto val = table->lookup(id); val) {
         return *val;
-    } throw std::runtime_error("undefined identifier '" + id + "' at " + std::to_string(line) + ':' + std::to_string(col));
+    } throw std::runtime_error("undefined identifier '" + id.str() + "' at " + std::to_string(line) + ':' + std::to_string(col));
 }
 
-Value NameRes::visit(Block* block) {
+// the table maps a local to its slot, kept in the scalar, and a fn to its signature
+int NameRes::declareLocal(Symbol id, int line, int col) {
+    declare(id, Value(Value::UNDEFINED, int64_t(slots)), line, col);
+    return slots++;
+}
+
+int NameRes::local(Symbol id, int line, int col) const {
+    Value val = lookup(id, line, col);
+    return val.isFunction() ? -1 : int(val);
+}
+
+// STEPS
+
+void NameRes::enter(Program* program) {
     table->pushScope();
-    for (auto stmt : block->stmts) {
-        stmt->accept(this);
+    for (const auto& [id, fun]: program->funs) {
+        Value val(fun->type);
+        val.fun = true;
+        val.signature = fun->signature();
+        declare(id, val, fun->line, fun->col);
+    }
+}
+
+void NameRes::leave(Program* program) {
+    (void)program; // unused
+    table->popScope();
+}
+
+void NameRes::enter(Fun* fun) {
+    table->pushScope();
+    slots = 0;
+    for (auto& param : fun->params) {
+        declareLocal(param.id, param.line, param.col);
     }
+}
+
+void NameRes::leave(Fun* fun) {
+    fun->slots = slots;
+    table->popScope();
+}
+
+void NameRes::enterScope() {
+    table->pushScope();
+}
+
+void NameRes::leaveScope() {
     table->popScope();
+}
+
+void NameRes::resolve(Variable* exp) {
+    exp->slot = local(exp->name, exp->line, exp->col);
+}
+
+void NameRes::resolve(FunCall* exp) {
+    if (auto val = lookup(exp->id, exp->line, exp->col); !val.isFunction()) {
+        throw std::runtime_error(
+            "‘" + exp->id.str() + "’ is not a function at " +
+            std::to_string(exp->line) + ":" +
+            std::to_string(exp->col));
+    }
+}
+
+void NameRes::resolve(SubscriptExp* exp) {
+    exp->slot = local(exp->id, exp->line, exp->col);
+}
+
+void NameRes::resolve(SliceExp* exp) {
+    lookup(exp->id, exp->line, exp->col);
+}
+
+void NameRes::declare(DecStmt* stmt) {
+    stmt->slot = declareLocal(stmt->id, stmt->line, stmt->col);
+}
+
+void NameRes::declare(ForStmt* stmt) {
+    stmt->slot = declareLocal(stmt->id, stmt->line, stmt->col);
+}
+
+// WALK
+
+Value NameRes::visit(Block* block) {
+    enterScope();
+    for (auto stmt : block->stmts) {
+        dispatch(stmt);
+    }
+    leaveScope();
     return {};
 }
 
 Value NameRes::visit(BinaryExp* exp) {
-    exp->lhs->accept(this);
-    exp->rhs->accept(this);
+    dispatch(exp->lhs);
+    dispatch(exp->rhs);
     return {};
 }
 
 Value NameRes::visit(UnaryExp* exp) {
-    exp->exp->accept(this);
+    dispatch(exp->exp);
     return {};
 }
 
@@ -49,155 +129,135 @@ Value NameRes::visit(Literal* exp) {
 }
 
 Value NameRes::visit(Variable* exp) {
-    lookup(exp->name, exp->line, exp->col);
+    resolve(exp);
     return {Value::ID, exp->name};
 }
 
 Value NameRes::visit(FunCall* exp) {
-    if (auto val = lookup(exp->id, exp->line, exp->col); !val.isFunction()) {
-        throw std::runtime_error(
-            "‘" + exp->id + "’ is not a function at " +
-            std::to_string(exp->line) + ":" +
-            std::to_string(exp->col));
-    }
+    resolve(exp);
     for (auto* arg : exp->args)
-        arg->accept(this);
+        dispatch(arg);
     return {};
 }
 
 Value NameRes::visit(IfExp* exp) {
-    exp->ifBranch->getCondition()->accept(this);
-    exp->ifBranch->getBlock()->accept(this);
+    dispatch(exp->ifBranch->getCondition());
+    dispatch(exp->ifBranch->getBlock());
     for (auto& br : exp->elseIfBranches) {
-        br->getCondition()->accept(this);
-        br->getBlock()->accept(this);
+        dispatch(br->getCondition());
+        dispatch(br->getBlock());
     }
     if (exp->elseBranch) {
-        exp->elseBranch->getBlock()->accept(this);
+        dispatch(exp->elseBranch->getBlock());
     }
     return {};
 }
 
 Value NameRes::visit(LoopExp* exp) {
-    exp->block->accept(this);
+    dispatch(exp->block);
     return {};
 }
 
 Value NameRes::visit(SubscriptExp* exp) {
-    lookup(exp->id, exp->line, exp->col);
-    exp->exp->accept(this);
+    resolve(exp);
+    dispatch(exp->exp);
     return {Value::ID, exp->id};
 }
 
 Value NameRes::visit(SliceExp* exp) {
-    lookup(exp->id, exp->line, exp->col);
-    if (exp->start) exp->start->accept(this);
-    if (exp->end) exp->end->accept(this);
+    resolve(exp);
+    if (exp->start) dispatch(exp->start);
+    if (exp->end) dispatch(exp->end);
     return {Value::ID, exp->id};
 }
 
 Value NameRes::visit(ReferenceExp* exp) {
-    exp->exp->accept(this);
+    dispatch(exp->exp);
     return {};
 }
 
 Value NameRes::visit(ArrayExp* exp) {
     for (auto el : exp->elements) {
-        el->accept(this);
+        dispatch(el);
     }
     return {};
 }
 
 Value NameRes::visit(UniformArrayExp* exp) {
-    exp->value->accept(this);
-    exp->size->accept(this);
+    dispatch(exp->value);
+    dispatch(exp->size);
     return {};
 }
 
 Value NameRes::visit(DecStmt* stmt) {
-    declare(stmt->id, stmt->var, stmt->line, stmt->col);
+    declare(stmt);
     if (stmt->rhs) {
-        stmt->rhs->accept(this);
+        dispatch(stmt->rhs);
     }
     return {};
 }
 
 Value NameRes::visit(AssignStmt* stmt) {
-    stmt->lhs->accept(this);
-    stmt->rhs->accept(this);
+    dispatch(stmt->lhs);
+    dispatch(stmt->rhs);
     return {};
 }
 
 Value NameRes::visit(CompoundAssignStmt* stmt) {
-    stmt->lhs->accept(this);
-    stmt->rhs->accept(this);
+    dispatch(stmt->lhs);
+    dispatch(stmt->rhs);
     return {};
 }
 
 Value NameRes::visit(ForStmt* stmt) {
-    stmt->start->accept(this);
-    stmt->end->accept(this);
-    table->pushScope();
-    Value value {};
-    value.initialized = true;
-    declare(stmt->id, value, stmt->line, stmt->col);
-    stmt->block->accept(this);
-    table->popScope();
+    dispatch(stmt->start);
+    dispatch(stmt->end);
+    enterScope();
+    declare(stmt);
+    dispatch(stmt->block);
+    leaveScope();
     return {};
 }
 
 Value NameRes::visit(WhileStmt* stmt) {
-    stmt->cond->accept(this);
-    stmt->block->accept(this);
+    dispatch(stmt->cond);
+    dispatch(stmt->block);
     return {};
 }
 
 Value NameRes::visit(PrintStmt* stmt) {
     for (auto exp : stmt->args) {
-        exp->accept(this);
+        dispatch(exp);
     }
     return {};
 }
 
 Value NameRes::visit(BreakStmt* stmt) {
-    if (stmt->exp) stmt->exp->accept(this);
+    if (stmt->exp) dispatch(stmt->exp);
     return {};
 }
 
 Value NameRes::visit(ReturnStmt* stmt) {
-    if (stmt->exp) stmt->exp->accept(this);
+    if (stmt->exp) dispatch(stmt->exp);
     return {};
 }
 
 Value NameRes::visit(ExpStmt* stmt) {
-    stmt->exp->accept(this);
+    dispatch(stmt->exp);
     return {};
 }
 
 Value NameRes::visit(Fun* fun) {
-    table->pushScope();
-    for (auto& param : fun->params) {
-        Value val;
-        val.type = param.type;
-        val.initialized = true; // parameters are initialized when the function is called
-        declare(param.id, val, param.line, param.col);
-    }
-    fun->block->accept(this);
-    table->popScope();
+    enter(fun);
+    dispatch(fun->block);
+    leave(fun);
     return {};
 }
 
 void NameRes::visit(Program* program) {
-    table->pushScope();
-    for (const auto& [id, fun]: program->funs) {
-        Value val(fun->type);
-        val.fun = true;
-        for (const auto& param : fun->params)
-            val.addType(param.type);
-        declare(id, val, fun->line, fun->col);
-    }
+    enter(program);
     for (const auto &fun: program->funs | std::views::values) {
-        fun->accept(this);
+        dispatch(fun);
     }
-    table->popScope();
+    leave(program);
 }
@@ -7,9 +7,9 @@
 
 #include "Visitor.h"
 
-class NameRes final : public Visitor {
+class NameRes final : public PassVisitor<NameRes> {
 public:
-    explicit NameRes(SymbolTable* table) : Visitor(table) {}
+    explicit NameRes(SymbolTable* table) : PassVisitor(table) {}
     ~NameRes() override;
     Value visit(Block* block) override;
     Value visit(BinaryExp* exp) override;
@@ -36,10 +36,32 @@ public:
     Value visit(Fun* fun) override;
     void visit(Program* program) override;
 
+    // What the walk does at each node besides visiting its children, for
+    // TypeCheck to resolve names in its own walk. Scopes open where the
+    // walk above opens them: a let is declared before its rhs is visited,
+    // and a for index after its range.
+    void enter(Program* program);
+    void leave(Program* program);
+    void enter(Fun* fun);
+    void leave(Fun* fun);
+    void enterScope();
+    void leaveScope();
+    void resolve(Variable* exp);
+    void resolve(FunCall* exp);
+    void resolve(SubscriptExp* exp);
+    void resolve(SliceExp* exp);
+    void declare(DecStmt* stmt);
+    void declare(ForStmt* stmt);
+
 private:
-    void declare(const std::string& id, const Value& val, int line, int col) const;
-    void update(const std::string& id, const Value& val, int line, int col) const;
-    Value lookup(const std::string& id, int line, int col) const;
+    void declare(Symbol id, const Value& val, int line, int col) const;
+    void update(Symbol id, const Value& val, int line, int col) const;
+    Value lookup(Symbol id, int line, int col) const;
+    int declareLocal(Symbol id, int line, int col);
+    int local(Symbol id, int line, int col) const;
+
+    // locals declared so far in the function being resolved
+    int slots {};
 };
 
 
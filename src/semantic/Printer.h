@@ -3,9 +3,9 @@
 
 #include "Visitor.h"
 
-class Printer : public Visitor {
+class Printer final : public PassVisitor<Printer> {
 public:
-    Printer() = default;
+    explicit Printer(std::ostream& out = std::cout) : out(out) {}
     ~Printer() override;
     Value visit(Block* block) override;
     Value visit(BinaryExp* exp) override;
@@ -31,6 +31,9 @@ public:
     Value visit(ExpStmt* stmt) override;
     Value visit(Fun* fun) override;
     void visit(Program* program) override;
+
+private:
+    std::ostream& out;
 };
 
 #endif
@@ -4,28 +4,47 @@
 
 #include "SymbolTable.h"
 
-#include <ranges>
+SymbolTable::Binding& SymbolTable::binding(uint32_t index) {
+    return chunks_[index / CHUNK_SIZE][index % CHUNK_SIZE];
+}
 
 void SymbolTable::pushScope() {
-    scopes_.emplace_back();
+    scopes_.push_back(size_);
 }
 
 void SymbolTable::popScope() {
-    if (!scopes_.empty()) {
-        scopes_.pop_back();
+    if (scopes_.empty()) {
+        return;
+    }
+    // undo the scope's declarations, innermost first
+    while (size_ > scopes_.back()) {
+        Binding& undone = binding(--size_);
+        innermost_[undone.name.id] = undone.shadowed;
     }
+    scopes_.pop_back();
 }
 
-bool SymbolTable::declare(const std::string& name, const Value& value) {
+bool SymbolTable::declare(Symbol name, const Value& value) {
     if (scopes_.empty()) {
         pushScope();
     }
-    auto& current = scopes_.back();
-    auto [_, inserted] = current.emplace(name, value);
-    return inserted;
+    if (name.id >= innermost_.size()) {
+        innermost_.resize(name.id + 1, NONE);
+    }
+    uint32_t shadowed = innermost_[name.id];
+    // a name is declared once per scope
+    if (shadowed != NONE && shadowed >= scopes_.back()) {
+        return false;
+    }
+    if (size_ == chunks_.size() * CHUNK_SIZE) {
+        chunks_.push_back(std::make_unique<Binding[]>(CHUNK_SIZE));
+    }
+    binding(size_) = {value, name, shadowed};
+    innermost_[name.id] = size_++;
+    return true;
 }
 
-bool SymbolTable::update(const std::string& name, const Value& value) {
+bool SymbolTable::update(Symbol name, const Value& value) {
     if (auto* sym = lookup(name)) {
         *sym = value;
         return true;
@@ -33,14 +52,11 @@ bool SymbolTable::update(const std::string& name, const Value& value) {
     return false;
 }
 
-Value* SymbolTable::lookup(const std::string& name) {
-    for (auto & scope : std::ranges::reverse_view(scopes_)) {  // reverse iteration
-        auto found = scope.find(name);
-        if (found != scope.end()) {
-            return &found->second;
-        }
+Value* SymbolTable::lookup(Symbol name) {
+    if (name.id >= innermost_.size() || innermost_[name.id] == NONE) {
+        return nullptr;
     }
-    return nullptr;
+    return &binding(innermost_[name.id]).value;
 }
 
 int SymbolTable::getScopeDepth() const {
@@ -5,23 +5,49 @@
 #ifndef SYMBOLTABLE_H
 #define SYMBOLTABLE_H
 
-#include <string>
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include <unordered_map>
 #include "../syntactic/Exp.h"
 
+// Scoped bindings from names to Values. Every binding lives in one stack,
+// innermost last, and a scope is the suffix of the stack that starts at its
+// mark. Each binding remembers the one of the same name it shadows, and a
+// dense array indexed by symbol id points at the innermost binding of every
+// name: a lookup is one index whatever the depth, and popping a scope walks
+// its bindings back, restoring what they shadowed. The stack keeps its
+// storage between scopes, so blocks allocate nothing once it has grown.
 class SymbolTable {
 public:
     void pushScope();
     void popScope();
-    bool declare(const std::string& name, const Value& value);
-    bool update(const std::string& name, const Value& value);
-    Value* lookup(const std::string& name);
+    bool declare(Symbol name, const Value& value);
+    bool update(Symbol name, const Value& value);
+    // stays valid until the scope of the binding is popped
+    Value* lookup(Symbol name);
     int getScopeDepth() const;
 
 private:
-    std::vector<std::unordered_map<std::string, Value>> scopes_;
+    static constexpr uint32_t NONE = UINT32_MAX;
+    // bindings are kept in fixed chunks so that declaring never moves the
+    // Values callers hold pointers to
+    static constexpr uint32_t CHUNK_SIZE = 256;
 
+    struct Binding {
+        Value value;
+        Symbol name;
+        // binding of the same name in an enclosing scope, or NONE
+        uint32_t shadowed;
+    };
+
+    std::vector<std::unique_ptr<Binding[]>> chunks_;
+    uint32_t size_ {};
+    // first binding of each open scope
+    std::vector<uint32_t> scopes_;
+    // innermost binding of each symbol id, or NONE
+    std::vector<uint32_t> innermost_;
+
+    Binding& binding(uint32_t index);
 };
 
 #endif //SYMBOLTABLE_H
@@ -1,5 +1,22 @@
 #include "TypeCheck.h"
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <memory>
 #include <ranges>
+#include <thread>
+
+// functions handed to a worker at a time, and the fewest worth a thread
+static constexpr size_t FUNS_PER_TASK = 16;
+static constexpr size_t FUNS_PER_THREAD = 64;
+
+// number of checking threads; RUSTY_THREADS overrides the number of cores
+static unsigned checkThreads() {
+    if (const char* forced = std::getenv("RUSTY_THREADS")) {
+        return std::max(1, atoi(forced));
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
 
 static bool isNumeric(Value::Type type) {
     return type == Value::I8 || type == Value::I16 ||
@@ -14,11 +31,14 @@ static Value::Type promoteNumeric(Value::Type a, Value::Type b) {
 }
 
 
-Value TypeCheck::lookup(const std::string& id) const {
-    return *table->lookup(id);
+// NameRes lets a let name itself in its rhs, where there is no binding yet
+Value* TypeCheck::lookup(Symbol id, int line, int col) const {
+    if (Value* entry = table->lookup(id)) return entry;
+    throw std::runtime_error("undefined identifier '" + id.str() + "' at " +
+                             std::to_string(line) + ':' + std::to_string(col));
 }
 
-void TypeCheck::declare(const std::string& id, const Value& val) const {
+void TypeCheck::declare(Symbol id, const Value& val) const {
         table->declare(id, val);
 }
 
@@ -69,10 +89,12 @@ TypeCheck::~TypeCheck() = default;
 Value TypeCheck::visit(Block* block) {
     ++blockDepth;
     table->pushScope();
+    if (names) names->enterScope();
     Value::Type last = Value::UNIT;
     for (auto stmt : block->stmts) {
-        last = stmt->accept(this).type;
+        last = dispatch(stmt).type;
     }
+    if (names) names->leaveScope();
     table->popScope();
     --blockDepth;
     block->type = last;
@@ -80,8 +102,8 @@ Value TypeCheck::visit(Block* block) {
 }
 
 Value TypeCheck::visit(BinaryExp* exp) {
-    Value lhs = exp->lhs->accept(this);
-    Value rhs = exp->rhs->accept(this);
+    Value lhs = dispatch(exp->lhs);
+    Value rhs = dispatch(exp->rhs);
     switch (exp->op) {
         case BinaryExp::LAND:
         case BinaryExp::LOR:
@@ -121,7 +143,7 @@ Value TypeCheck::visit(BinaryExp* exp) {
 }
 
 Value TypeCheck::visit(UnaryExp* exp) {
-    Value v = exp->exp->accept(this);
+    Value v = dispatch(exp->exp);
     switch (exp->op) {
         case UnaryExp::LNOT:
             assertType(v, Value::BOOL, exp->line, exp->col);
@@ -138,8 +160,13 @@ Value TypeCheck::visit(Literal* exp) {
 }
 
 Value TypeCheck::visit(Variable* exp) {
-    Value* entry = table->lookup(exp->name);
+    if (names) names->resolve(exp);
+    Value* entry = lookup(exp->name, exp->line, exp->col);
     Value v = *entry;
+    if (!lhsContext && v.fun)
+        throw std::runtime_error("function '" + exp->name.str() + "' used as a value at " +
+                                 std::to_string(exp->line) + ':' +
+                                 std::to_string(exp->col));
     if (!lhsContext && !v.initialized)
         throw std::runtime_error("use of uninitialized variable at " +
                                  std::to_string(exp->line) + ':' +
@@ -153,18 +180,20 @@ Value TypeCheck::visit(Variable* exp) {
 }
 
 Value TypeCheck::visit(FunCall* exp) {
-    Value fn = lookup(exp->id);
-    if (fn.types.size() < exp->args.size())
-        throw std::runtime_error("too many arguments for " + exp->id + " at " +
+    if (names) names->resolve(exp);
+    Value fn = *lookup(exp->id, exp->line, exp->col);
+    const auto& types = fn.signature.types();
+    if (types.size() < exp->args.size())
+        throw std::runtime_error("too many arguments for " + exp->id.str() + " at " +
                                  std::to_string(exp->line) + ':' +
                                  std::to_string(exp->col));
-    if (fn.types.size() > exp->args.size())
-        throw std::runtime_error("not enough arguments for " + exp->id + " at " +
+    if (types.size() > exp->args.size())
+        throw std::runtime_error("not enough arguments for " + exp->id.str() + " at " +
                                  std::to_string(exp->line) + ':' +
                                  std::to_string(exp->col));
-    auto it = fn.types.begin();
+    auto it = types.begin();
     for (auto arg : exp->args) {
-        Value a = arg->accept(this);
+        Value a = dispatch(arg);
         assertType(a, *it, arg->line, arg->col);
         ++it;
     }
@@ -173,34 +202,35 @@ Value TypeCheck::visit(FunCall* exp) {
 }
 
 Value TypeCheck::visit(IfExp* exp) {
-    Value cond = exp->ifBranch->getCondition()->accept(this);
+    Value cond = dispatch(exp->ifBranch->getCondition());
     Exp* condex = exp->ifBranch->getCondition();
     assertType(cond, Value::BOOL, condex->line, condex->col);
-    Value t = exp->ifBranch->getBlock()->accept(this);
+    Value t = dispatch(exp->ifBranch->getBlock());
     Value e = {Value::UNIT};
     for (auto br : exp->elseIfBranches) {
-        Value c = br->getCondition()->accept(this);
+        Value c = dispatch(br->getCondition());
         Exp* cex = br->getCondition();
         assertType(c, Value::BOOL, cex->line, cex->col);
-        e = br->getBlock()->accept(this);
+        e = dispatch(br->getBlock());
     }
     if (exp->elseBranch)
-        e = exp->elseBranch->getBlock()->accept(this);
+        e = dispatch(exp->elseBranch->getBlock());
     assertType(t, e, exp->line, exp->col);
     exp->type = t.type;
     return {exp->type};
 }
 
 Value TypeCheck::visit(LoopExp* exp) {
-    Value v = exp->block->accept(this);
+    Value v = dispatch(exp->block);
     exp->type = v.type;
     return v;
 }
 
 Value TypeCheck::visit(SubscriptExp* exp) {
-    Value* entry = table->lookup(exp->id);
+    if (names) names->resolve(exp);
+    Value* entry = lookup(exp->id, exp->line, exp->col);
     Value coll = *entry;
-    Value idx = exp->exp->accept(this);
+    Value idx = dispatch(exp->exp);
     assertType(idx, Value::I32, exp->line, exp->col);
     if (!(coll.type == Value::STR || coll.size > 0))
         throw std::runtime_error("subscript on non-indexable at " +
@@ -215,14 +245,15 @@ Value TypeCheck::visit(SubscriptExp* exp) {
 }
 
 Value TypeCheck::visit(SliceExp* exp) {
-    lookup(exp->id);
+    if (names) names->resolve(exp);
+    lookup(exp->id, exp->line, exp->col);
     if (exp->start) {
-        Value s = exp->start->accept(this);
+        Value s = dispatch(exp->start);
         Exp* ex = exp->start;
         assertType(s, Value::I32, ex->line, ex->col);
     }
     if (exp->end) {
-        Value e = exp->end->accept(this);
+        Value e = dispatch(exp->end);
         Exp* ex = exp->end;
         assertType(e, Value::I32, ex->line, ex->col);
     }
@@ -231,7 +262,7 @@ Value TypeCheck::visit(SliceExp* exp) {
 }
 
 Value TypeCheck::visit(ReferenceExp* exp) {
-    Value v = exp->exp->accept(this);
+    Value v = dispatch(exp->exp);
     v.ref = true;
     exp->type = v.type;
     return v;
@@ -241,7 +272,7 @@ Value TypeCheck::visit(ArrayExp* exp) {
     Value::Type elType = Value::UNDEFINED;
     bool ref = true;
     for (auto el : exp->elements) {
-        Value v = el->accept(this);
+        Value v = dispatch(el);
         if (elType == Value::UNDEFINED)
             elType = v.type;
         else
@@ -256,30 +287,31 @@ Value TypeCheck::visit(ArrayExp* exp) {
 }
 
 Value TypeCheck::visit(UniformArrayExp* exp) {
-    Value v = exp->value->accept(this);
+    Value v = dispatch(exp->value);
     assertStringRef(v, exp->line, exp->col);
-    Value s = exp->size->accept(this);
+    Value s = dispatch(exp->size);
     Exp* size = exp->size;
     assertType(s, Value::I32, size->line, size->col);
-    if (s.numericValues.empty()) {
+    if (!s.hasScalar) {
         throw std::runtime_error("array size must be constant at " +
                                  std::to_string(size->line) + ':' +
                                  std::to_string(size->col));
     }
-    if (s.numericValues.front() <= 0) {
+    if (s.scalar <= 0) {
         throw std::runtime_error("array size must be positive at " +
                                  std::to_string(size->line) + ':' +
                                  std::to_string(size->col));
     }
     exp->type = v.type;
     Value val{v.type};
-    val.size = s.numericValues.front();
+    val.size = s.scalar;
     val.ref = v.ref;
     return val;
 }
 
 // Visit methods for statements
 Value TypeCheck::visit(DecStmt* stmt) {
+    if (names) names->declare(stmt);
     if (stmt->var.type == Value::STR)
         assertStringRef(stmt->var, stmt->line, stmt->col);
     if (stmt->var.size < 0)
@@ -288,7 +320,7 @@ Value TypeCheck::visit(DecStmt* stmt) {
                                  std::to_string(stmt->col));
     Value rhs{stmt->var.type};
     if (stmt->rhs) {
-        rhs = stmt->rhs->accept(this);
+        rhs = dispatch(stmt->rhs);
         if (stmt->var.type == Value::UNDEFINED)
             stmt->var.type = rhs.type;
         stmt->var.type = assertType(rhs, stmt->var, stmt->line, stmt->col).type;
@@ -307,27 +339,26 @@ Value TypeCheck::visit(AssignStmt* stmt) {
     lhsContext = true;
     lhsIsVariable = false;
     lhsEntry = nullptr;
-    Value lhs = stmt->lhs->accept(this);
+    Value lhs = dispatch(stmt->lhs);
     lhsContext = false;
-    Value rhs = stmt->rhs->accept(this);
+    Value rhs = dispatch(stmt->rhs);
     assertStringRef(rhs, stmt->line, stmt->col);
     if (lhsIsVariable && lhsEntry) {
-        if (!lhsEntry->initialized) {
+        // a fn is never initialized, but it is not a variable either
+        if (!lhsEntry->initialized && !lhsEntry->fun) {
             if (lhsEntry->type == Value::UNDEFINED)
                 lhsEntry->type = rhs.type;
             lhsEntry->ref = rhs.ref;
             if (rhs.size > 0)
                 lhsEntry->size = rhs.size;
             lhsEntry->initialized = true;
-            std::string id;
-            auto var = dynamic_cast<Variable*>(stmt->lhs);
-            if (var) {
-                id = var->name;
+            Symbol id;
+            if (stmt->lhs->kind == Exp::VARIABLE) {
+                id = static_cast<Variable*>(stmt->lhs)->name;
             }
             // or SubscriptExp
-            auto var2 = dynamic_cast<SubscriptExp*>(stmt->lhs);
-            if (var2) {
-                id = var2->id;
+            if (stmt->lhs->kind == Exp::SUBSCRIPT) {
+                id = static_cast<SubscriptExp*>(stmt->lhs)->id;
             }
             table->update(id, *lhsEntry);
             dec[id]->var = *lhsEntry;
@@ -345,8 +376,8 @@ Value TypeCheck::visit(AssignStmt* stmt) {
 }
 
 Value TypeCheck::visit(CompoundAssignStmt* stmt) {
-    Value lhs = stmt->lhs->accept(this);
-    Value rhs = stmt->rhs->accept(this);
+    Value lhs = dispatch(stmt->lhs);
+    Value rhs = dispatch(stmt->rhs);
     assertMut(lhs, stmt->line, stmt->col);
     if (!lhs.isNumber() || !rhs.isNumber())
         throw std::runtime_error("Invalid compound assignment");
@@ -354,26 +385,31 @@ Value TypeCheck::visit(CompoundAssignStmt* stmt) {
 }
 
 Value TypeCheck::visit(ForStmt* stmt) {
-    Value val = stmt->start->accept(this);
+    Value val = dispatch(stmt->start);
     stmt->start->type = val.type;
-    val = stmt->end->accept(this);
+    val = dispatch(stmt->end);
     stmt->end->type = val.type;
     table->pushScope();
+    if (names) {
+        names->enterScope();
+        names->declare(stmt);
+    }
     Value value (Value::I32);
     value.initialized = true;
     declare(stmt->id, value);
-    stmt->block->accept(this);
+    dispatch(stmt->block);
+    if (names) names->leaveScope();
     table->popScope();
     return {Value::UNIT};
 }
 
 
 Value TypeCheck::visit(WhileStmt* stmt) {
-    Value c = stmt->cond->accept(this);
+    Value c = dispatch(stmt->cond);
     Exp* cond = stmt->cond;
     assertType(c, Value::BOOL, cond->line, cond->col);
     table->pushScope();
-    stmt->block->accept(this);
+    dispatch(stmt->block);
     table->popScope();
     return {Value::UNIT};
 }
@@ -403,7 +439,7 @@ Value TypeCheck::visit(PrintStmt* stmt) {
                 "not enough arguments for print at " + std::to_string(stmt->line) + ":" + std::to_string(stmt->col));
         }
 
-        Value v = (*it)->accept(this);
+        Value v = dispatch((*it));
         parsed += typeToFormat(v.type);
 
         ++it;
@@ -415,7 +451,7 @@ Value TypeCheck::visit(PrintStmt* stmt) {
             "too many arguments for print at " + std::to_string(stmt->line) + ":" + std::to_string(stmt->col));
     }
 
-    stmt->strLiteral = parsed + "\\n";
+    stmt->format = parsed + "\\n";
     return {Value::UNIT};
 }
 
@@ -425,7 +461,7 @@ Value TypeCheck::visit(BreakStmt* stmt) {
                                  std::to_string(stmt->line) + ':' +
                                  std::to_string(stmt->col));
     Value r{Value::UNIT};
-    if (stmt->exp) r = stmt->exp->accept(this);
+    if (stmt->exp) r = dispatch(stmt->exp);
     stmt->type = r.type;
     return r;
 }
@@ -436,14 +472,14 @@ Value TypeCheck::visit(ReturnStmt* stmt) {
                                  std::to_string(stmt->line) + ':' +
                                  std::to_string(stmt->col));
     Value r{Value::UNIT};
-    if (stmt->exp) r = stmt->exp->accept(this);
+    if (stmt->exp) r = dispatch(stmt->exp);
     assertType(r, currentReturnType, stmt->line, stmt->col);
     stmt->type = r.type;
     return {Value::UNIT};
 }
 
 Value TypeCheck::visit(ExpStmt* stmt) {
-    Value r = stmt->exp->accept(this);
+    Value r = dispatch(stmt->exp);
     stmt->type = stmt->returnValue ? r.type : Value::UNIT;
     return {stmt->type};
 }
@@ -452,31 +488,158 @@ Value TypeCheck::visit(ExpStmt* stmt) {
 Value TypeCheck::visit(Fun* fun) {
     --blockDepth;
     table->pushScope();
+    if (names) names->enter(fun);
     currentReturnType = fun->type != Value::UNDEFINED ? fun->type : Value::UNIT;
     for (const auto& p : fun->params) {
         Value paramVal{p.type};
         paramVal.initialized = true; // parameters are always initialized
         declare(p.id, paramVal);
     }
-    Value r = fun->block->accept(this);
+    dispatch(fun->block);
     fun->type = currentReturnType;
+    if (names) names->leave(fun);
     table->popScope();
     ++blockDepth;
     return {Value::UNIT};
 }
 
 void TypeCheck::visit(Program* program) {
+    if (!names) {
+        check(program);
+        return;
+    }
+    try {
+        unsigned threads = std::min<size_t>(checkThreads(), program->funs.size() / FUNS_PER_THREAD);
+        if (threads > 1) checkInParallel(program, threads);
+        else check(program);
+    } catch (const std::exception&) {
+        // the two walks would have reported a name error anywhere in the
+        // program before any type error, so look for one
+        SymbolTable fresh;
+        NameRes(&fresh).visit(program);
+        throw;
+    }
+}
+
+size_t TypeCheck::recheck(Program* program, const std::vector<bool>& unchecked,
+                          std::vector<Declaration>& declared) {
+    std::vector<Declaration> declarations;
+    for (const auto& [id, fun] : program->funs) {
+        // a check turns the return type of a fn without one into unit
+        declarations.push_back({id, fun->signature(), fun->type != Value::UNDEFINED ? fun->type : Value::UNIT});
+    }
+    if (declarations != declared) {
+        declared.clear();
+        visit(program);
+        declared = std::move(declarations);
+        return program->funs.size();
+    }
+    size_t walked = 0;
+    try {
+        enter(program);
+        for (size_t i = 0; i < program->funs.size(); ++i) {
+            if (!unchecked[i]) continue;
+            check(program, i);
+            ++walked;
+        }
+        leave(program);
+    } catch (const std::exception&) {
+        // the whole walk finds the error that comes first, of names or types
+        SymbolTable table, names;
+        NameRes nameRes(&names);
+        TypeCheck(&table, &nameRes).visit(program);
+        throw;
+    }
+    return walked;
+}
+
+void TypeCheck::check(Program* program) {
+    enter(program);
+    for (size_t i = 0; i < program->funs.size(); ++i) {
+        check(program, i);
+    }
+    leave(program);
+}
+
+void TypeCheck::enter(Program* program) {
     table->pushScope();
+    if (names) names->enter(program);
     for (const auto& [id, fun]: program->funs) {
-        Value val{fun->type, true};
-        for (const auto& param : fun->params)
-            val.addType(param.type);
+        Value val{fun->type};
+        val.fun = true;
+        val.signature = fun->signature();
         declare(id, val);
     }
-    for (const auto &[id, fun]: program->funs) {
-        fun->accept(this);
-        Value* entry = table->lookup(id);
-        if (entry) entry->type = fun->type != Value::UNDEFINED ? fun->type : Value::UNIT;
-    }
+}
+
+void TypeCheck::leave(Program* program) {
+    if (names) names->leave(program);
     table->popScope();
 }
+
+void TypeCheck::check(Program* program, size_t index) {
+    // a call sees the checked return type of the fns before this one; those
+    // checked by another TypeCheck get it here, from their declared type
+    for (; checkedFuns < index; ++checkedFuns) {
+        Value* entry = table->lookup(program->funs[checkedFuns].first);
+        if (entry->type == Value::UNDEFINED) entry->type = Value::UNIT;
+    }
+    auto [id, fun] = program->funs[index];
+    dispatch(fun);
+    Value* entry = table->lookup(id);
+    if (entry) entry->type = fun->type != Value::UNDEFINED ? fun->type : Value::UNIT;
+    ++checkedFuns;
+}
+
+void TypeCheck::checkInParallel(Program* program, unsigned threads) {
+    // Fns only see each other through the table, so each worker checks whole
+    // fns with its own tables and passes. Declaring the fns interns their
+    // signatures, which is done here rather than on the threads.
+    struct Worker {
+        SymbolTable table;
+        SymbolTable names;
+        NameRes nameRes {&names};
+        TypeCheck typeCheck {&table, &nameRes};
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->typeCheck.enter(program);
+    }
+
+    size_t count = program->funs.size();
+    std::vector<std::exception_ptr> errors(count);
+    std::atomic<size_t> next {0};
+    // index of the first fn known to fail; the fns after it need no check
+    std::atomic<size_t> failed {count};
+    auto work = [&](TypeCheck& typeCheck) {
+        for (size_t first; (first = next.fetch_add(FUNS_PER_TASK)) < failed.load();) {
+            size_t last = std::min(first + FUNS_PER_TASK, count);
+            for (size_t i = first; i < last; ++i) {
+                try {
+                    typeCheck.check(program, i);
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                    size_t seen = failed.load();
+                    while (i < seen && !failed.compare_exchange_weak(seen, i)) {}
+                    // the walk stopped halfway, leaving its tables unusable
+                    return;
+                }
+            }
+        }
+    };
+    std::vector<std::thread> running;
+    for (unsigned t = 1; t < threads; ++t) {
+        running.emplace_back(work, std::ref(workers[t]->typeCheck));
+    }
+    work(workers[0]->typeCheck);
+    for (auto& thread : running) {
+        thread.join();
+    }
+
+    // the first error in source order is the one the sequential walk throws
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
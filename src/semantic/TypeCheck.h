@@ -5,12 +5,16 @@
 #ifndef TYPECHECK_H
 #define TYPECHECK_H
 
-#include "Visitor.h"
-#include <map>
+#include "NameRes.h"
+#include <unordered_map>
 
-class TypeCheck final : public Visitor {
+class TypeCheck final : public PassVisitor<TypeCheck> {
 public:
-    explicit TypeCheck(SymbolTable* table = nullptr) : Visitor(table) {}
+    explicit TypeCheck(SymbolTable* table = nullptr) : PassVisitor(table) {}
+    // Checks and resolves names in the same walk, with names keeping its
+    // own table: the program comes out as from NameRes then TypeCheck, and
+    // a failing one with the error those two would report.
+    TypeCheck(SymbolTable* table, NameRes* names) : PassVisitor(table), names(names) {}
     ~TypeCheck() override;
     Value visit(Block* block) override;
     Value visit(BinaryExp* exp) override;
@@ -37,9 +41,32 @@ public:
     Value visit(Fun* fun) override;
     void visit(Program* program) override;
 
+    // what a fn shows the others: its name, parameter types and return type
+    struct Declaration {
+        Symbol id;
+        Value::Signature signature;
+        Value::Type type;
+        bool operator==(const Declaration& other) const = default;
+    };
+    // Checks a program that passed the checks before and was edited since,
+    // with the error visit() would throw. While the fns declare what they
+    // did then, the ones checked before keep what the checks wrote into them
+    // and only those marked in unchecked are walked again; otherwise every
+    // fn is. declared holds the declarations of the last check and gets
+    // those of this one. Needs the fused walk; returns the fns walked.
+    size_t recheck(Program* program, const std::vector<bool>& unchecked, std::vector<Declaration>& declared);
+
 private:
-    Value lookup(const std::string& id) const;
-    void declare(const std::string& id, const Value& val) const;
+    void check(Program* program);
+    // the steps of check: declaring the fns, checking the i-th, and the end
+    void enter(Program* program);
+    void check(Program* program, size_t index);
+    void leave(Program* program);
+    // the fused walk over whole fns on several threads, with the result and
+    // the first error of the sequential one
+    void checkInParallel(Program* program, unsigned threads);
+    Value* lookup(Symbol id, int line, int col) const;
+    void declare(Symbol id, const Value& val) const;
     static void assertMut(const Value& val, int line, int col);
     static Value assertType(Value from, Value to, int line, int col);
     static void assertStringRef(const Value& val, int line, int col);
@@ -52,7 +79,10 @@ private:
     bool lhsContext{false};
     bool lhsIsVariable{false};
     Value* lhsEntry{nullptr};
-    std::map<std::string, DecStmt*> dec;
+    std::unordered_map<Symbol, DecStmt*> dec;
+    NameRes* names {};
+    // fns of the program whose table entry has their checked type
+    size_t checkedFuns {};
 };
 
 #endif //TYPECHECK_H
@@ -5,68 +5,36 @@
 Value Block::accept(Visitor* visitor) {
     return visitor->visit(this);
 }
-Value BinaryExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value UnaryExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value Literal::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value Variable::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value FunCall::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value IfExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value LoopExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value SubscriptExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value SliceExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value ReferenceExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value ArrayExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value UniformArrayExp::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value DecStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value AssignStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value CompoundAssignStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value ForStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value WhileStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value PrintStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value BreakStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value ReturnStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
-}
-Value ExpStmt::accept(Visitor* visitor) {
-    return visitor->visit(this);
+Value Exp::accept(Visitor* visitor) {
+    switch (kind) {
+        case BINARY: return visitor->visit(static_cast<BinaryExp*>(this));
+        case UNARY: return visitor->visit(static_cast<UnaryExp*>(this));
+        case LITERAL: return visitor->visit(static_cast<Literal*>(this));
+        case VARIABLE: return visitor->visit(static_cast<Variable*>(this));
+        case FUN_CALL: return visitor->visit(static_cast<FunCall*>(this));
+        case IF: return visitor->visit(static_cast<IfExp*>(this));
+        case LOOP: return visitor->visit(static_cast<LoopExp*>(this));
+        case SUBSCRIPT: return visitor->visit(static_cast<SubscriptExp*>(this));
+        case SLICE: return visitor->visit(static_cast<SliceExp*>(this));
+        case REFERENCE: return visitor->visit(static_cast<ReferenceExp*>(this));
+        case ARRAY: return visitor->visit(static_cast<ArrayExp*>(this));
+        case UNIFORM_ARRAY: return visitor->visit(static_cast<UniformArrayExp*>(this));
+    }
+    throw std::runtime_error("unknown expression kind");
+}
+Value Stmt::accept(Visitor* visitor) {
+    switch (kind) {
+        case DEC: return visitor->visit(static_cast<DecStmt*>(this));
+        case ASSIGN: return visitor->visit(static_cast<AssignStmt*>(this));
+        case COMPOUND_ASSIGN: return visitor->visit(static_cast<CompoundAssignStmt*>(this));
+        case FOR: return visitor->visit(static_cast<ForStmt*>(this));
+        case WHILE: return visitor->visit(static_cast<WhileStmt*>(this));
+        case PRINT: return visitor->visit(static_cast<PrintStmt*>(this));
+        case BREAK: return visitor->visit(static_cast<BreakStmt*>(this));
+        case RETURN: return visitor->visit(static_cast<ReturnStmt*>(this));
+        case EXP: return visitor->visit(static_cast<ExpStmt*>(this));
+    }
+    throw std::runtime_error("unknown statement kind");
 }
 Value Fun::accept(Visitor* visitor) {
     return visitor->visit(this);
@@ -41,4 +41,54 @@ public:
     virtual void visit(Program* program) = 0;
 };
 
+// Base of the passes. dispatch picks the visit of a node from its kind and
+// calls it on the derived pass, not through Visitor, so in a final pass the
+// whole walk is direct calls the compiler can inline.
+template <class Pass>
+class PassVisitor : public Visitor {
+public:
+    using Visitor::Visitor;
+
+protected:
+    Value dispatch(Exp* exp) {
+        Pass* pass = static_cast<Pass*>(this);
+        switch (exp->getKind()) {
+            case Exp::BINARY: return pass->visit(static_cast<BinaryExp*>(exp));
+            case Exp::UNARY: return pass->visit(static_cast<UnaryExp*>(exp));
+            case Exp::LITERAL: return pass->visit(static_cast<Literal*>(exp));
+            case Exp::VARIABLE: return pass->visit(static_cast<Variable*>(exp));
+            case Exp::FUN_CALL: return pass->visit(static_cast<FunCall*>(exp));
+            case Exp::IF: return pass->visit(static_cast<IfExp*>(exp));
+            case Exp::LOOP: return pass->visit(static_cast<LoopExp*>(exp));
+            case Exp::SUBSCRIPT: return pass->visit(static_cast<SubscriptExp*>(exp));
+            case Exp::SLICE: return pass->visit(static_cast<SliceExp*>(exp));
+            case Exp::REFERENCE: return pass->visit(static_cast<ReferenceExp*>(exp));
+            case Exp::ARRAY: return pass->visit(static_cast<ArrayExp*>(exp));
+            case Exp::UNIFORM_ARRAY: return pass->visit(static_cast<UniformArrayExp*>(exp));
+        }
+        throw std::runtime_error("unknown expression kind");
+    }
+    Value dispatch(Stmt* stmt) {
+        Pass* pass = static_cast<Pass*>(this);
+        switch (stmt->getKind()) {
+            case Stmt::DEC: return pass->visit(static_cast<DecStmt*>(stmt));
+            case Stmt::ASSIGN: return pass->visit(static_cast<AssignStmt*>(stmt));
+            case Stmt::COMPOUND_ASSIGN: return pass->visit(static_cast<CompoundAssignStmt*>(stmt));
+            case Stmt::FOR: return pass->visit(static_cast<ForStmt*>(stmt));
+            case Stmt::WHILE: return pass->visit(static_cast<WhileStmt*>(stmt));
+            case Stmt::PRINT: return pass->visit(static_cast<PrintStmt*>(stmt));
+            case Stmt::BREAK: return pass->visit(static_cast<BreakStmt*>(stmt));
+            case Stmt::RETURN: return pass->visit(static_cast<ReturnStmt*>(stmt));
+            case Stmt::EXP: return pass->visit(static_cast<ExpStmt*>(stmt));
+        }
+        throw std::runtime_error("unknown statement kind");
+    }
+    Value dispatch(Block* block) {
+        return static_cast<Pass*>(this)->visit(block);
+    }
+    Value dispatch(Fun* fun) {
+        return static_cast<Pass*>(this)->visit(fun);
+    }
+};
+
 #endif
@@ -0,0 +1,62 @@
+#include "Arena.h"
+#include <cstdint>
+#include <cstdlib>
+
+Arena::~Arena() {
+    for (Finalizer* finalizer = finalizers; finalizer; finalizer = finalizer->next) {
+        finalizer->destroy(finalizer->object);
+    }
+    while (chunk) {
+        Chunk* prev = chunk->prev;
+        std::free(chunk);
+        chunk = prev;
+    }
+}
+
+size_t Arena::bytesUsed() const {
+    return used;
+}
+
+size_t Arena::bytesReserved() const {
+    return reserved;
+}
+
+static char* alignUp(char* p, size_t alignment) {
+    auto address = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    char* p = alignUp(cursor, alignment);
+    if (!cursor || p + bytes > limit) {
+        grow(bytes, alignment);
+        p = alignUp(cursor, alignment);
+    }
+    cursor = p + bytes;
+    used += bytes;
+    return p;
+}
+
+void Arena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    // memory is only given back when the whole arena is released
+    (void)p; (void)bytes; (void)alignment;
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void Arena::grow(size_t bytes, size_t alignment) {
+    // chunks double in size, so a program of n bytes needs O(log n) of them
+    size_t size = chunk ? chunk->size * 2 : firstChunkSize;
+    while (size < sizeof(Chunk) + bytes + alignment) size *= 2;
+
+    auto* next = static_cast<Chunk*>(std::malloc(size));
+    if (!next) throw std::bad_alloc();
+    next->prev = chunk;
+    next->size = size;
+    chunk = next;
+    cursor = reinterpret_cast<char*>(next + 1);
+    limit = reinterpret_cast<char*>(next) + size;
+    reserved += size;
+}
@@ -0,0 +1,71 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Bump allocator for the AST. Nodes are placed one after another in parse
+// order and released together when the arena is destroyed. It is also a
+// memory_resource, so the nodes' child containers can live in it too.
+class Arena final : public std::pmr::memory_resource {
+public:
+    // first chunk of an arena that holds a single function; most are small
+    static constexpr size_t FUNCTION_CHUNK_SIZE = 4 * 1024;
+
+    // small trees (a single function, for instance) can start with a small chunk
+    explicit Arena(size_t firstChunkSize = FIRST_CHUNK_SIZE) : firstChunkSize(firstChunkSize) {}
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // constructs a T in the arena; its destructor runs when the arena dies,
+    // unless it is trivial
+    template <class T, class... Args>
+    T* make(Args&&... args) {
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            auto* finalizer = new (allocate(sizeof(Finalizer), alignof(Finalizer))) Finalizer;
+            finalizer->destroy = [](void* p) { static_cast<T*>(p)->~T(); };
+            finalizer->object = object;
+            finalizer->next = finalizers;
+            finalizers = finalizer;
+        }
+        return object;
+    }
+
+    size_t bytesUsed() const;
+    size_t bytesReserved() const;
+
+private:
+    struct Chunk {
+        Chunk* prev;
+        size_t size;
+    };
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    static constexpr size_t FIRST_CHUNK_SIZE = 64 * 1024;
+
+    size_t firstChunkSize;
+    Chunk* chunk {};
+    char* cursor {};
+    char* limit {};
+    size_t used {};
+    size_t reserved {};
+    // newest first, so objects are destroyed in reverse order of creation
+    Finalizer* finalizers {};
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    void grow(size_t bytes, size_t alignment);
+};
+
+#endif
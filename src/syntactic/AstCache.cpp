@@ -0,0 +1,123 @@
+#include "AstCache.h"
+#include "FlatAst.h"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr uint64_t KEY_SEED = 0x5275737479;
+static constexpr uint64_t CHECKSUM_SEED = 0x436865636b;
+
+// what a cache file starts with; the source it was compiled from follows,
+// then the serialized FlatAst
+struct EntryHeader {
+    uint64_t checksum;
+    uint64_t sourceSize;
+};
+
+// 64-bit hash of some bytes, eight at a time; not cryptographic, but any
+// change to the source or the compiler changes it
+static uint64_t hashBytes(std::string_view bytes, uint64_t seed) {
+    constexpr uint64_t K = 0x9E3779B97F4A7C15;
+    uint64_t h = seed ^ (bytes.size() * K);
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes.data() + i, 8);
+        h = (h ^ word) * K;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes.data() + i, bytes.size() - i);
+    h = (h ^ tail) * K;
+    return h ^ (h >> 32);
+}
+
+// maps a whole file and hands its bytes to use; false if it cannot be mapped
+template <class Use>
+static bool withMapped(const char* path, Use use) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st {};
+    bool mapped = false;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            use(std::string_view(static_cast<const char*>(addr), st.st_size));
+            munmap(addr, st.st_size);
+            mapped = true;
+        }
+    }
+    close(fd);
+    return mapped;
+}
+
+AstCache::AstCache(std::string directory) : directory(std::move(directory)) {
+    withMapped("/proc/self/exe", [&](std::string_view binary) {
+        compiler = hashBytes(binary, KEY_SEED) | 1;
+    });
+}
+
+std::string AstCache::path(std::string_view source) const {
+    char name[32];
+    snprintf(name, sizeof name, "%016llx.ast",
+             static_cast<unsigned long long>(hashBytes(source, compiler)));
+    return directory + "/" + name;
+}
+
+Program* AstCache::load(std::string_view source) {
+    if (!compiler) return nullptr;
+    Program* program = nullptr;
+    withMapped(path(source).c_str(), [&](std::string_view bytes) {
+        if (bytes.size() < sizeof(EntryHeader)) return;
+        EntryHeader header;
+        memcpy(&header, bytes.data(), sizeof header);
+        bytes.remove_prefix(sizeof header);
+        // the name is only a hash, so another source can land on it
+        if (header.sourceSize != source.size() || bytes.substr(0, source.size()) != source) return;
+        std::string_view payload = bytes.substr(source.size());
+        if (header.checksum != hashBytes(payload, CHECKSUM_SEED)) return;
+        // whatever is wrong with an entry, compiling from the source is the answer
+        try {
+            if (auto ast = FlatAst::deserialize(payload)) {
+                program = ast->program();
+            }
+        }
+        catch (const std::exception&) {
+            program = nullptr;
+        }
+    });
+    return program;
+}
+
+void AstCache::store(std::string_view source, Program* program) {
+    if (!compiler) return;
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) return;
+
+    std::string payload = FlatAst(program).serialize();
+    EntryHeader header {hashBytes(payload, CHECKSUM_SEED), source.size()};
+
+    // written aside and renamed, so a concurrent compile never reads half a file
+    std::string target = path(source);
+    std::string temporary = target + "." + std::to_string(getpid());
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof header);
+        file.write(source.data(), source.size());
+        file.write(payload.data(), payload.size());
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) std::filesystem::remove(temporary, error);
+}
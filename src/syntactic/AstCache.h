@@ -0,0 +1,36 @@
+#ifndef ASTCACHE_H
+#define ASTCACHE_H
+
+#include "Fun.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// On-disk cache of checked programs, for sources compiled over and over (the
+// web editor, make.py). A program that passed the semantic checks is stored
+// as a serialized FlatAst in a file named after a hash of the source and of
+// the compiler binary, so compiling the same text with the same compiler
+// loads it and goes straight to code generation. The file keeps the source
+// too, and is only used when that is the source being compiled, as other
+// text can hash to the same name. Programs with errors are never stored,
+// and a file that does not read back whole is a miss.
+class AstCache {
+public:
+    explicit AstCache(std::string directory);
+
+    // the checked program of this source, or nullptr if it is not cached
+    Program* load(std::string_view source);
+    // stores a program that passed the semantic checks; the cache only saves
+    // time, so failing to write it is not an error
+    void store(std::string_view source, Program* program);
+
+private:
+    std::string directory;
+    // hash of the running compiler; 0 when it cannot be read, which turns
+    // the cache off rather than risk loading trees of another version
+    uint64_t compiler {};
+
+    std::string path(std::string_view source) const;
+};
+
+#endif
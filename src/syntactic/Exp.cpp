@@ -1,7 +1,8 @@
 #include "Exp.h"
 #include <iostream>
+#include <map>
 
-Value::Type Value::stringToType(std::string type) {
+Value::Type Value::stringToType(std::string_view type) {
     if (type == "bool") return BOOL;
     else if (type == "char") return CHAR;
     else if (type == "i8") return I8;
@@ -10,7 +11,7 @@ Value::Type Value::stringToType(std::string type) {
     else if (type == "i64") return I64;
     else if (type == "str") return STR;
     else if (type == "()") return UNIT;
-    throw std::runtime_error("invalid type: " + type);
+    throw std::runtime_error("invalid type: " + std::string(type));
 }
 bool Value::isNumber() {
     return type == I8 || type == I16 || type == I32 || type == I64;
@@ -21,21 +22,29 @@ bool Value::isArray() {
 bool Value::isFunction() {
     return fun;
 }
-void Value::addType(Type type) {
-    types.push_back(type);
+
+// all distinct parameter lists; index 0 is the empty one
+static std::vector<std::vector<Value::Type>>& signatures() {
+    static std::vector<std::vector<Value::Type>> table {{}};
+    return table;
+}
+
+const std::vector<Value::Type>& Value::Signature::types() const {
+    return signatures()[id];
 }
 
-std::string Value::getId() const {
-    if (type == ID && !stringValues.empty())
-        return stringValues.front();
-    throw std::runtime_error("getId error");
+Value::Signature Value::Signature::intern(const std::vector<Type>& types) {
+    static std::map<std::vector<Type>, uint32_t> ids {{{}, 0}};
+    auto [found, inserted] = ids.emplace(types, signatures().size());
+    if (inserted) signatures().push_back(types);
+    return {found->second};
 }
 
 Value::operator int() {
-    return numericValues.front();
+    return scalar;
 }
 Value::operator std::string() {
-    return stringValues.front();
+    return text.str();
 }
 
 std::ostream& operator<<(std::ostream& out, const Value::Type& type) {
@@ -56,55 +65,25 @@ std::ostream& operator<<(std::ostream& out, const Value::Type& type) {
     return out;
 }
 std::ostream& operator<<(std::ostream& out, const Value& var) {
-    if (var.size > 0) out << "[ ";
-    int i {};
     switch(var.type) {
-        case Value::BOOL:
-            for (auto el : var.numericValues) {
-                out << std::boolalpha << (el > 0);
-                if (++i < var.size) out << ", ";
-            }
-            break;
-        case Value::CHAR:
-            for (auto el : var.stringValues) {
-                out << '\'' << el[0] << '\'';
-                if (++i < var.size) out << ", ";
-            }
-            break;
+        case Value::BOOL: out << std::boolalpha << (var.scalar > 0); break;
+        case Value::CHAR: out << '\'' << char(var.scalar) << '\''; break;
         case Value::I8:
         case Value::I16:
         case Value::I32:
-        case Value::I64:
-            for (auto el : var.numericValues) {
-                out << el;
-                if (++i < var.size) out << ", ";
-            }
-            break;
-        case Value::STR:
-            for (auto el : var.stringValues) {
-                out << '"' << el << '"';
-                if (++i < var.size) out << ", ";
-            }
-            break;
+        case Value::I64: out << var.scalar; break;
+        case Value::STR: out << '"' << var.text << '"'; break;
         case Value::UNIT: out << "()"; break;
         default: throw std::runtime_error("expected well-defined type for printing");
     }
-    if (var.size > 0) out << "] ";
     return out;
 }
 
-Stmt::~Stmt() = default;
 std::ostream& operator<<(std::ostream& out, Stmt* stmt) {
     stmt->print(out);
     return out;
 }
 
-Block::~Block() {
-    for (auto stmt : stmts) {
-        delete stmt;
-    }
-    stmts.clear();
-}
 std::ostream& operator<<(std::ostream& out, Block* block) {
     out << "{" << "\n";
     for (auto stmt : block->stmts) {
@@ -114,16 +93,28 @@ std::ostream& operator<<(std::ostream& out, Block* block) {
     return out;
 }
 
-Exp::~Exp() = default;
+void Exp::print(std::ostream& out) {
+    switch (kind) {
+        case BINARY: static_cast<BinaryExp*>(this)->print(out); break;
+        case UNARY: static_cast<UnaryExp*>(this)->print(out); break;
+        case LITERAL: static_cast<Literal*>(this)->print(out); break;
+        case VARIABLE: static_cast<Variable*>(this)->print(out); break;
+        case FUN_CALL: static_cast<FunCall*>(this)->print(out); break;
+        case IF: static_cast<IfExp*>(this)->print(out); break;
+        case LOOP: static_cast<LoopExp*>(this)->print(out); break;
+        case SUBSCRIPT: static_cast<SubscriptExp*>(this)->print(out); break;
+        case SLICE: static_cast<SliceExp*>(this)->print(out); break;
+        case REFERENCE: static_cast<ReferenceExp*>(this)->print(out); break;
+        case ARRAY: static_cast<ArrayExp*>(this)->print(out); break;
+        case UNIFORM_ARRAY: static_cast<UniformArrayExp*>(this)->print(out); break;
+    }
+}
+
 std::ostream& operator<<(std::ostream& out, Exp* exp) {
     exp->print(out);
     return out;
 }
 
-BinaryExp::~BinaryExp() {
-    delete lhs;
-    delete rhs;
-}
 void BinaryExp::print(std::ostream& out) {
     out << lhs;
     switch (op) {
@@ -143,9 +134,6 @@ void BinaryExp::print(std::ostream& out) {
     out << rhs;
 }
 
-UnaryExp::~UnaryExp() {
-    delete exp;
-}
 void UnaryExp::print(std::ostream& out) {
     switch (op) {
         case LNOT: out << "! "; break;
@@ -153,12 +141,10 @@ void UnaryExp::print(std::ostream& out) {
     out << exp;
 }
 
-Literal::~Literal() = default;
 void Literal::print(std::ostream& out) {
     out << value;
 }
 
-Variable::~Variable() = default;
 void Variable::print(std::ostream& out) {
     out << name;
 }
@@ -172,17 +158,7 @@ void FunCall::print(std::ostream& out) {
     }
     out << ")";
 }
-FunCall::~FunCall() {
-    for (auto exp : args) {
-        delete exp;
-    }
-    args.clear();
-}
 
-IfExp::IfBranch::~IfBranch() {
-    delete cond;
-    delete block;
-}
 Exp* IfExp::IfBranch::getCondition() {
     return cond;
 }
@@ -194,22 +170,10 @@ void IfExp::IfBranch::print(std::ostream &out) {
     out << block;
 }
 
-IfExp::~IfExp() {
-    delete ifBranch;
-    elseIfBranches.clear();
-    delete elseBranch;
-}
-void IfExp::addElseIfBranch(Exp* cond, Block* block) {
-    IfBranch* branch = new IfBranch(cond, block);
-    elseIfBranches.push_back(branch);
-}
-void IfExp::setElseBranch(Exp* cond, Block* block) {
-    elseBranch = new IfBranch(cond, block);
-}
 IfExp::IfBranch* IfExp::getIfBranch() {
     return ifBranch;
 }
-std::list<IfExp::IfBranch*> IfExp::getElseIfBranches() {
+const std::pmr::vector<IfExp::IfBranch*>& IfExp::getElseIfBranches() {
     return elseIfBranches;
 }
 IfExp::IfBranch* IfExp::getElseBranch() {
@@ -228,25 +192,15 @@ void IfExp::print(std::ostream& out) {
     }
 }
 
-LoopExp::~LoopExp() {
-    delete block;
-}
 void LoopExp::print(std::ostream& out) {
     out << "loop";
     out << block;
 }
 
-SubscriptExp::~SubscriptExp() {
-    delete exp;
-}
 void SubscriptExp::print(std::ostream& out) {
     out << id << '[' << exp << ']';
 }
 
-SliceExp::~SliceExp() {
-    delete start;
-    delete end;
-}
 void SliceExp::print(std::ostream& out) {
     out << id << '[';
     if (start) out << start;
@@ -256,20 +210,11 @@ void SliceExp::print(std::ostream& out) {
     out << ']';
 }
 
-ReferenceExp::~ReferenceExp() {
-    delete exp;
-}
 void ReferenceExp::print(std::ostream& out) {
     out << std::string(count, '&');
     out << exp;
 }
 
-ArrayExp::~ArrayExp() {
-    for (auto el : elements) {
-        delete el;
-    }
-    elements.clear();
-}
 void ArrayExp::print(std::ostream& out) {
     out << '[';
     size_t i {};
@@ -280,10 +225,6 @@ void ArrayExp::print(std::ostream& out) {
     out << ']';
 }
 
-UniformArrayExp::~UniformArrayExp() {
-    delete value;
-    delete size;
-}
 void UniformArrayExp::print(std::ostream& out) {
     out << '[' << value << "; " << size << ']';
 }
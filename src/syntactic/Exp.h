@@ -1,75 +1,71 @@
 #ifndef EXP_H
 #define EXP_H
 
-#define FRIENDS friend class CodeGen; friend class TypeCheck; friend class NameRes;
+#define FRIENDS friend class CodeGen; friend class TypeCheck; friend class NameRes; friend class LineShift; friend class FlatAst; friend class IrBuilder;
 
 #include <iostream>
 #include <string>
-#include <list>
+#include <string_view>
+#include <cstdint>
+#include <memory_resource>
 #include <utility>
+#include <vector>
+#include "../lexic/Interner.h"
 
 class Visitor;
 class CodeGen;
 
+// Trivially copyable description of a value or a type: visitors return it
+// by value and the SymbolTable stores one per name, so it owns no memory.
 struct Value {
     enum Type { UNDEFINED, BOOL, CHAR, I8, I16, I32, I64, STR, ID, UNIT};
 
+    // handle of an interned list of parameter types; 0 is the empty list
+    struct Signature {
+        uint32_t id {};
+
+        bool operator==(const Signature& other) const = default;
+        const std::vector<Type>& types() const;
+        static Signature intern(const std::vector<Type>& types);
+    };
+
+    // numbers, booleans and the code of chars
+    int64_t scalar {};
     Type type {};
-    // in case of array has multiple values, otherwise only one
-    std::list<int> numericValues {};
-    // in case of array has multiple values, otherwise only one
-    std::list<std::string> stringValues {};
-    // array of types for functions
-    std::list<Type> types {};
-
-    bool literal {};
-    bool fun {};
-    bool ref {};
-    bool mut {};
-    bool initialized {};
+    // text of strings and names of identifiers
+    Symbol text {};
+    // parameter types for functions
+    Signature signature {};
     // by default size = 0, otherwise, it's an array
     int size {};
-    // for subscript expression
-    int index {};
-    // for slice expression
-    int left {}, right {};
+
+    bool literal : 1 {};
+    bool fun : 1 {};
+    bool ref : 1 {};
+    bool mut : 1 {};
+    bool initialized : 1 {};
+    // scalar holds a value known at compile time
+    bool hasScalar : 1 {};
 
     Value() : type(UNDEFINED), initialized(false) {}
 
     Value(Type type) : type(type) {}
 
-    Value(Type type, std::string stringValue,
-          bool ref=false, bool mut=false, bool literal=false, bool fun=false)
-        : type(type), stringValues({std::move(stringValue)}),
-        ref(ref), mut(mut), initialized(true) {}
-
-    Value(Type type, int numericValue,
-          bool ref=false, bool mut=false, bool literal=false, bool fun=false)
-        : type(type), numericValues({numericValue}),
-        ref(ref), mut(mut), initialized(true) {}
+    Value(Type type, Symbol text, bool ref=false, bool mut=false)
+        : type(type), text(text), ref(ref), mut(mut), initialized(true) {}
 
-    Value(Type type, std::list<std::string> stringValues,
-        bool ref=false, bool mut=false, bool literal=false, bool fun=false)
-        : type(type), stringValues(std::move(stringValues)),
-        ref(ref), mut(mut), initialized(true) {}
-
-    Value(Type type, std::list<int> numericValues,
-        bool ref=false, bool mut=false, bool literal=false, bool fun=false)
-        : type(type), numericValues(std::move(numericValues)),
-        ref(ref), mut(mut), initialized(true) {}
-
-    ~Value() = default;
+    Value(Type type, int64_t scalar, bool ref=false, bool mut=false)
+        : scalar(scalar), type(type), ref(ref), mut(mut),
+        initialized(true), hasScalar(true) {}
 
     bool isNumber();
     bool isArray();
     bool isFunction();
-    void addType(Type type);
-    std::string getId() const;
 
     operator int();
     operator std::string();
 
-    static Type stringToType(std::string type);
+    static Type stringToType(std::string_view type);
     friend std::ostream& operator<<(std::ostream& out, const Value::Type& type);
     friend std::ostream& operator<<(std::ostream& out, const Value& var);
 };
@@ -78,18 +74,25 @@ class Exp;
 
 class Stmt {
     FRIENDS
+public:
+    // the class of the statement; accept and print switch on it, so that
+    // nodes need no vtable and a pass can dispatch without virtual calls
+    enum Kind : uint8_t {DEC, ASSIGN, COMPOUND_ASSIGN, FOR, WHILE, PRINT, BREAK, RETURN, EXP};
 protected:
     int line;
     int col;
+    Kind kind;
 public:
     Stmt(const Stmt &) = default;
     Stmt(Stmt &&) = delete;
     Stmt &operator=(const Stmt &) = default;
     Stmt &operator=(Stmt &&) = delete;
-    Stmt(int line, int col) : line(line), col(col) {}
-    virtual ~Stmt() = 0;
-    virtual Value accept(Visitor *visitor) = 0;
-    virtual void print(std::ostream &out) = 0;
+    Stmt(Kind kind, int line, int col) : line(line), col(col), kind(kind) {}
+    // nodes live in the Program's arena and are never deleted through a base pointer
+    ~Stmt() = default;
+    Kind getKind() const { return kind; }
+    Value accept(Visitor *visitor);
+    void print(std::ostream &out);
     friend std::ostream &operator<<(std::ostream &out, Stmt *stmt);
 };
 
@@ -99,11 +102,10 @@ class Block {
     int line;
     int col;
     Value::Type type {};
-    std::list<Stmt *> stmts;
+    std::pmr::vector<Stmt *> stmts;
 public:
-    Block(int line, int col, std::list<Stmt *> stmts)
+    Block(int line, int col, std::pmr::vector<Stmt *> stmts)
         : line(line), col(col), stmts(std::move(stmts)) {}
-    ~Block();
 
     Block(const Block &) = default;
     Block(Block &&) = delete;
@@ -116,15 +118,23 @@ public:
 
 class Exp {
     FRIENDS
+public:
+    // the class of the expression, as for Stmt
+    enum Kind : uint8_t {
+        BINARY, UNARY, LITERAL, VARIABLE, FUN_CALL, IF, LOOP,
+        SUBSCRIPT, SLICE, REFERENCE, ARRAY, UNIFORM_ARRAY,
+    };
 protected:
     int line;
     int col;
     Value::Type type{};
+    Kind kind;
 public:
-    Exp(int line, int col) : line(line), col(col) {}
-    virtual ~Exp() = 0;
-    virtual Value accept(Visitor *visitor) = 0;
-    virtual void print(std::ostream &out) = 0;
+    Exp(Kind kind, int line, int col) : line(line), col(col), kind(kind) {}
+    ~Exp() = default;
+    Kind getKind() const { return kind; }
+    Value accept(Visitor *visitor);
+    void print(std::ostream &out);
     friend std::ostream &operator<<(std::ostream &out, Exp *exp);
 };
 
@@ -137,11 +147,9 @@ public:
     };
 
     BinaryExp(int line, int col, Operation op, Exp *lhs, Exp *rhs) 
-        : Exp(line, col), op(op), lhs(lhs), rhs(rhs) {}
-    ~BinaryExp();
+        : Exp(BINARY, line, col), op(op), lhs(lhs), rhs(rhs) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 private:
     FRIENDS
 
@@ -157,11 +165,9 @@ public:
     };
 
     UnaryExp(int line, int col, Operation op, Exp *exp) 
-        : Exp(line, col), op(op), exp(exp) {}
-    ~UnaryExp();
+        : Exp(UNARY, line, col), op(op), exp(exp) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 
 private:
     FRIENDS
@@ -177,40 +183,36 @@ class Literal : public Exp {
 
 public:
     Literal(int line, int col, Value value) 
-        : Exp(line, col), value(value) {}
-    ~Literal();
+        : Exp(LITERAL, line, col), value(value) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 class Variable : public Exp {
     FRIENDS
 
-    std::string name;
+    Symbol name;
+    // local the name resolves to, numbered by NameRes; -1 for a fn name
+    int slot {-1};
 
 public:
-    Variable(int line, int col, std::string name) 
-        : Exp(line, col), name(std::move(name)) {}
-    ~Variable();
+    Variable(int line, int col, Symbol name) 
+        : Exp(VARIABLE, line, col), name(name) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 class FunCall : public Exp {
     FRIENDS
 
-  std::string id;
-  std::list<Exp *> args;
+  Symbol id;
+  std::pmr::vector<Exp *> args;
 
 public:
-    FunCall(int line, int col, std::string id, std::list<Exp *> args)
-          : Exp(line, col), id(std::move(id)), args(std::move(args)) {}
-    ~FunCall();
+    FunCall(int line, int col, Symbol id, std::pmr::vector<Exp *> args)
+          : Exp(FUN_CALL, line, col), id(id), args(std::move(args)) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 class IfExp : public Exp {
@@ -222,42 +224,35 @@ public:
         Exp* cond;
         Block* block;
         Value::Type type {};
-        IfBranch(Exp *cond, Block *block) : cond(cond), block(block) {}
 
     public:
-        ~IfBranch();
+        IfBranch(Exp *cond, Block *block) : cond(cond), block(block) {}
         Exp* getCondition();
         Block* getBlock();
         void print(std::ostream &out);
     };
 
-    IfExp(int line, int col, Exp* cond, Block* block)
-        : Exp(line, col)
-    {
-        ifBranch = new IfBranch(cond, block);
-    }
-    ~IfExp();
+    IfExp(int line, int col, IfBranch* ifBranch,
+          std::pmr::vector<IfBranch*> elseIfBranches, IfBranch* elseBranch)
+        : Exp(IF, line, col), ifBranch(ifBranch),
+        elseIfBranches(std::move(elseIfBranches)), elseBranch(elseBranch) {}
 
     IfExp(const IfExp &) = default;
     IfExp(IfExp &&) = delete;
     IfExp &operator=(const IfExp &) = default;
     IfExp &operator=(IfExp &&) = delete;
 
-    void addElseIfBranch(Exp* cond, Block* block);
-    void setElseBranch(Exp* cond, Block* block);
-
     IfBranch* getIfBranch();
-    std::list<IfBranch*> getElseIfBranches();
+    const std::pmr::vector<IfBranch*>& getElseIfBranches();
     IfBranch* getElseBranch();
 
     void print(std::ostream &out);
-    Value accept(Visitor *visitor);
 
 private:
     FRIENDS
 
     IfBranch* ifBranch;
-    std::list<IfBranch*> elseIfBranches;
+    std::pmr::vector<IfBranch*> elseIfBranches;
     IfBranch* elseBranch {};
 
 };
@@ -269,43 +264,39 @@ class LoopExp : public Exp {
     Value::Type type {};
 public:
     LoopExp(int line, int col, Block *block) 
-        : Exp(line, col), block(block) {}
-    ~LoopExp();
+        : Exp(LOOP, line, col), block(block) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 class SubscriptExp : public Exp {
     FRIENDS
 
-    std::string id;
+    Symbol id;
     Exp* exp;
+    // local the name resolves to, numbered by NameRes; -1 for a fn name
+    int slot {-1};
 public:
-    SubscriptExp(int line, int col, std::string id, Exp* exp) 
-        : Exp(line, col), id(id), exp(exp) {}
-    ~SubscriptExp();
+    SubscriptExp(int line, int col, Symbol id, Exp* exp) 
+        : Exp(SUBSCRIPT, line, col), id(id), exp(exp) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 class SliceExp : public Exp {
     FRIENDS
 
-    std::string id;
+    Symbol id;
     Exp* start;
     Exp* end;
     bool inclusive {};
 public:
-    SliceExp(int line, int col, std::string id, Exp* start, Exp* end) 
-        : Exp(line, col), id(id), start(start), end(end) {}
-    SliceExp(int line, int col, std::string id, Exp* start, Exp* end, bool inclusive) 
-        : Exp(line, col), id(id), start(start), end(end), inclusive(inclusive) {}
-    ~SliceExp();
+    SliceExp(int line, int col, Symbol id, Exp* start, Exp* end) 
+        : Exp(SLICE, line, col), id(id), start(start), end(end) {}
+    SliceExp(int line, int col, Symbol id, Exp* start, Exp* end, bool inclusive) 
+        : Exp(SLICE, line, col), id(id), start(start), end(end), inclusive(inclusive) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 class ReferenceExp : public Exp {
@@ -315,26 +306,22 @@ class ReferenceExp : public Exp {
     int count; // number of reference operators
 public:
     ReferenceExp(int line, int col, Exp* exp)  
-        : Exp(line, col), exp(exp), count(1) {}
+        : Exp(REFERENCE, line, col), exp(exp), count(1) {}
     ReferenceExp(int line, int col, Exp* exp, int count)  
-        : Exp(line, col), exp(exp), count(count) {}
-    ~ReferenceExp();
+        : Exp(REFERENCE, line, col), exp(exp), count(count) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 class ArrayExp : public Exp {
     FRIENDS
 
-    std::list<Exp*> elements;
+    std::pmr::vector<Exp*> elements;
 public:
-    explicit ArrayExp(int line, int col, std::list<Exp *> elements)
-            : Exp(line, col), elements(std::move(elements)) {}
-    ~ArrayExp();
+    explicit ArrayExp(int line, int col, std::pmr::vector<Exp *> elements)
+            : Exp(ARRAY, line, col), elements(std::move(elements)) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 class UniformArrayExp : public Exp {
@@ -344,11 +331,9 @@ class UniformArrayExp : public Exp {
     Exp *size;
 public:
     UniformArrayExp(int line, int col, Exp *value, Exp *size) 
-        : Exp(line, col), value(value), size(size) {}
-    ~UniformArrayExp();
+        : Exp(UNIFORM_ARRAY, line, col), value(value), size(size) {}
 
     void print(std::ostream& out);
-    Value accept(Visitor* visitor);
 };
 
 #endif
@@ -0,0 +1,774 @@
+#include "FlatAst.h"
+#include "../semantic/Visitor.h"
+#include <algorithm>
+#include <cstring>
+
+// BUILDER
+
+class FlatAst::Builder final : public PassVisitor<FlatAst::Builder> {
+public:
+    explicit Builder(FlatAst& ast) : PassVisitor(&unused), ast(ast) {}
+
+    NodeId walk(Exp* exp) {
+        if (!exp) return NONE;
+        dispatch(exp);
+        return result;
+    }
+    NodeId walk(Block* block) {
+        dispatch(block);
+        return result;
+    }
+    NodeId walk(IfExp::IfBranch* branch) {
+        NodeId cond = walk(branch->cond);
+        NodeId block = walk(branch->block);
+        return ast.add(BRANCH, branch->block->line, branch->block->col, branch->type, cond, block);
+    }
+    // walks the children of a list and adds it, returning its offset
+    uint32_t walkList(const std::pmr::vector<Exp*>& exps) {
+        size_t base = pending.size();
+        for (Exp* exp : exps) {
+            NodeId node = walk(exp);
+            pending.push_back(node);
+        }
+        return takeList(base);
+    }
+    // adds the ids pushed to pending since base as a list
+    uint32_t takeList(size_t base) {
+        uint32_t offset = ast.addList({pending.data() + base, pending.size() - base});
+        pending.resize(base);
+        return offset;
+    }
+
+    // expressions are added through their base, whose type TypeCheck sets
+    NodeId add(Kind kind, Exp* exp, uint32_t a = NONE, uint32_t b = NONE, uint32_t c = NONE,
+               uint8_t flag = 0, uint32_t slot = NONE) {
+        return result = ast.add(kind, exp->line, exp->col, exp->type, a, b, c, flag, slot);
+    }
+    NodeId add(Kind kind, Stmt* stmt, Value::Type type, uint32_t a = NONE, uint32_t b = NONE,
+               uint32_t c = NONE, uint8_t flag = 0, uint32_t slot = NONE) {
+        return result = ast.add(kind, stmt->line, stmt->col, type, a, b, c, flag, slot);
+    }
+
+    Value visit(Block* block) override {
+        size_t base = pending.size();
+        for (Stmt* stmt : block->stmts) {
+            dispatch(stmt);
+            pending.push_back(result);
+        }
+        uint32_t stmts = takeList(base);
+        result = ast.add(BLOCK, block->line, block->col, block->type, stmts, block->stmts.size());
+        return {};
+    }
+
+    Value visit(BinaryExp* exp) override {
+        NodeId lhs = walk(exp->lhs);
+        NodeId rhs = walk(exp->rhs);
+        add(BINARY, exp, lhs, rhs, NONE, exp->op);
+        return {};
+    }
+
+    Value visit(UnaryExp* exp) override {
+        add(UNARY, exp, walk(exp->exp), NONE, NONE, exp->op);
+        return {};
+    }
+
+    Value visit(Literal* exp) override {
+        ast.values.push_back(exp->value);
+        add(LITERAL, exp, ast.values.size() - 1);
+        return {};
+    }
+
+    Value visit(Variable* exp) override {
+        add(VARIABLE, exp, exp->name.id, NONE, NONE, 0, exp->slot);
+        return {};
+    }
+
+    Value visit(FunCall* exp) override {
+        uint32_t args = walkList(exp->args);
+        add(CALL, exp, exp->id.id, args, exp->args.size());
+        return {};
+    }
+
+    Value visit(IfExp* exp) override {
+        NodeId ifBranch = walk(exp->ifBranch);
+        size_t base = pending.size();
+        for (IfExp::IfBranch* branch : exp->elseIfBranches) {
+            NodeId node = walk(branch);
+            pending.push_back(node);
+        }
+        if (exp->elseBranch) {
+            NodeId node = walk(exp->elseBranch);
+            pending.push_back(node);
+        }
+        uint32_t count = pending.size() - base;
+        add(IF, exp, ifBranch, takeList(base), count, exp->elseBranch != nullptr);
+        return {};
+    }
+
+    Value visit(LoopExp* exp) override {
+        // a loop keeps the type of its breaks apart from the one of Exp
+        add(LOOP, exp, walk(exp->block), NONE, NONE, exp->type);
+        return {};
+    }
+
+    Value visit(SubscriptExp* exp) override {
+        add(SUBSCRIPT, exp, exp->id.id, walk(exp->exp), NONE, 0, exp->slot);
+        return {};
+    }
+
+    Value visit(SliceExp* exp) override {
+        NodeId start = walk(exp->start);
+        NodeId end = walk(exp->end);
+        add(SLICE, exp, exp->id.id, start, end, exp->inclusive);
+        return {};
+    }
+
+    Value visit(ReferenceExp* exp) override {
+        add(REFERENCE, exp, walk(exp->exp), exp->count);
+        return {};
+    }
+
+    Value visit(ArrayExp* exp) override {
+        uint32_t elements = walkList(exp->elements);
+        add(ARRAY, exp, elements, exp->elements.size());
+        return {};
+    }
+
+    Value visit(UniformArrayExp* exp) override {
+        NodeId value = walk(exp->value);
+        NodeId size = walk(exp->size);
+        add(UNIFORM_ARRAY, exp, value, size);
+        return {};
+    }
+
+    Value visit(DecStmt* stmt) override {
+        NodeId rhs = walk(stmt->rhs);
+        ast.values.push_back(stmt->var);
+        add(DEC, stmt, stmt->var.type, stmt->id.id, ast.values.size() - 1, rhs, 0, stmt->slot);
+        return {};
+    }
+
+    Value visit(AssignStmt* stmt) override {
+        NodeId lhs = walk(stmt->lhs);
+        NodeId rhs = walk(stmt->rhs);
+        add(ASSIGN, stmt, Value::UNDEFINED, lhs, rhs, NONE, stmt->ref);
+        return {};
+    }
+
+    Value visit(CompoundAssignStmt* stmt) override {
+        NodeId lhs = walk(stmt->lhs);
+        NodeId rhs = walk(stmt->rhs);
+        add(COMPOUND_ASSIGN, stmt, Value::UNDEFINED, lhs, rhs, NONE, stmt->op);
+        return {};
+    }
+
+    Value visit(ForStmt* stmt) override {
+        NodeId parts[] {walk(stmt->start), walk(stmt->end), walk(stmt->block)};
+        add(FOR, stmt, Value::UNDEFINED, stmt->id.id, ast.addList(parts), NONE, stmt->inclusive,
+            stmt->slot);
+        return {};
+    }
+
+    Value visit(WhileStmt* stmt) override {
+        NodeId cond = walk(stmt->cond);
+        NodeId block = walk(stmt->block);
+        add(WHILE, stmt, Value::UNDEFINED, cond, block);
+        return {};
+    }
+
+    Value visit(PrintStmt* stmt) override {
+        uint32_t args = walkList(stmt->args);
+        ast.strings.push_back(stmt->strLiteral);
+        ast.strings.push_back(stmt->format);
+        add(PRINT, stmt, Value::UNDEFINED, ast.strings.size() - 2, args, stmt->args.size());
+        return {};
+    }
+
+    Value visit(BreakStmt* stmt) override {
+        add(BREAK, stmt, stmt->type, walk(stmt->exp));
+        return {};
+    }
+
+    Value visit(ReturnStmt* stmt) override {
+        add(RETURN, stmt, stmt->type, walk(stmt->exp));
+        return {};
+    }
+
+    Value visit(ExpStmt* stmt) override {
+        add(EXP_STMT, stmt, stmt->type, walk(stmt->exp), NONE, NONE, stmt->returnValue);
+        return {};
+    }
+
+    Value visit(Fun* fun) override {
+        size_t base = pending.size();
+        for (const Param& param : fun->params) {
+            pending.push_back(ast.add(PARAM, param.line, param.col, param.type, param.id.id));
+        }
+        uint32_t params = takeList(base);
+        NodeId block = walk(fun->block);
+        result = ast.add(FUN, fun->line, fun->col, fun->type, block, params, fun->params.size(), 0,
+                         fun->slots);
+        return {};
+    }
+
+    void visit(Program* program) override {
+        for (const auto& [id, fun] : program->funs) {
+            dispatch(fun);
+            ast.funs.emplace_back(id, result);
+        }
+    }
+
+private:
+    // the walk never declares anything; the table only satisfies Visitor
+    SymbolTable unused;
+    FlatAst& ast;
+    NodeId result {NONE};
+    // children of the lists being walked, innermost last
+    std::vector<NodeId> pending;
+};
+
+// FLAT AST
+
+FlatAst::FlatAst(Program* program) {
+    Builder builder(*this);
+    builder.visit(program);
+}
+
+FlatAst::NodeId FlatAst::add(Kind kind, int line, int col, Value::Type type,
+                             uint32_t a, uint32_t b, uint32_t c, uint8_t flag, uint32_t slot) {
+    kinds.push_back(kind);
+    types.push_back(type);
+    flags.push_back(flag);
+    first.push_back(a);
+    second.push_back(b);
+    third.push_back(c);
+    slots.push_back(slot);
+    locations.push_back({line, col});
+    return kinds.size() - 1;
+}
+
+uint32_t FlatAst::addList(std::span<const NodeId> nodes) {
+    lists.insert(lists.end(), nodes.begin(), nodes.end());
+    return lists.size() - nodes.size();
+}
+
+size_t FlatAst::size() const {
+    return kinds.size();
+}
+
+size_t FlatAst::bytes() const {
+    size_t total = size() * (sizeof(Kind) + 2 * sizeof(uint8_t) + 4 * sizeof(uint32_t) + sizeof(Location));
+    total += lists.size() * sizeof(NodeId) + values.size() * sizeof(Value);
+    for (const std::string& string : strings) {
+        total += sizeof(std::string) + string.size();
+    }
+    return total + funs.size() * sizeof(funs[0]);
+}
+
+Value::Type FlatAst::type(NodeId node) const {
+    return static_cast<Value::Type>(types[node]);
+}
+
+Program* FlatAst::program() const {
+    auto arena = std::make_unique<Arena>();
+    // children come first, so every operand is already built when it is read
+    std::vector<void*> nodes(size());
+    auto exp = [&](uint32_t node) {
+        return node == NONE ? nullptr : static_cast<Exp*>(nodes[node]);
+    };
+    auto block = [&](uint32_t node) {
+        return static_cast<Block*>(nodes[node]);
+    };
+    auto list = [&](uint32_t offset, uint32_t length) {
+        return std::span<const NodeId>(lists).subspan(offset, length);
+    };
+    auto exps = [&](uint32_t offset, uint32_t length) {
+        std::pmr::vector<Exp*> result(arena.get());
+        result.reserve(length);
+        for (NodeId node : list(offset, length)) {
+            result.push_back(exp(node));
+        }
+        return result;
+    };
+
+    for (NodeId node = 0; node < size(); ++node) {
+        auto [line, col] = locations[node];
+        Value::Type type = this->type(node);
+        uint32_t a = first[node], b = second[node], c = third[node];
+        int slot = slots[node];
+        Exp* made {};
+        Stmt* stmt {};
+        switch (kinds[node]) {
+            case BLOCK: {
+                std::pmr::vector<Stmt*> stmts(arena.get());
+                stmts.reserve(b);
+                for (NodeId child : list(a, b)) {
+                    stmts.push_back(static_cast<Stmt*>(nodes[child]));
+                }
+                Block* built = arena->make<Block>(line, col, std::move(stmts));
+                built->type = type;
+                nodes[node] = built;
+                continue;
+            }
+            case BINARY:
+                made = arena->make<BinaryExp>(line, col, BinaryExp::Operation(flags[node]), exp(a), exp(b));
+                break;
+            case UNARY:
+                made = arena->make<UnaryExp>(line, col, UnaryExp::Operation(flags[node]), exp(a));
+                break;
+            case LITERAL:
+                made = arena->make<Literal>(line, col, values[a]);
+                break;
+            case VARIABLE: {
+                auto* variable = arena->make<Variable>(line, col, Symbol {a});
+                variable->slot = slot;
+                made = variable;
+                break;
+            }
+            case CALL:
+                made = arena->make<FunCall>(line, col, Symbol {a}, exps(b, c));
+                break;
+            case IF: {
+                std::pmr::vector<IfExp::IfBranch*> elseIfBranches(arena.get());
+                for (NodeId branch : list(b, c)) {
+                    elseIfBranches.push_back(static_cast<IfExp::IfBranch*>(nodes[branch]));
+                }
+                IfExp::IfBranch* elseBranch {};
+                if (flags[node]) {
+                    elseBranch = elseIfBranches.back();
+                    elseIfBranches.pop_back();
+                }
+                made = arena->make<IfExp>(line, col, static_cast<IfExp::IfBranch*>(nodes[a]),
+                                          std::move(elseIfBranches), elseBranch);
+                break;
+            }
+            case BRANCH: {
+                auto* branch = arena->make<IfExp::IfBranch>(exp(a), block(b));
+                branch->type = type;
+                nodes[node] = branch;
+                continue;
+            }
+            case LOOP: {
+                auto* loop = arena->make<LoopExp>(line, col, block(a));
+                loop->type = Value::Type(flags[node]);
+                made = loop;
+                break;
+            }
+            case SUBSCRIPT: {
+                auto* subscript = arena->make<SubscriptExp>(line, col, Symbol {a}, exp(b));
+                subscript->slot = slot;
+                made = subscript;
+                break;
+            }
+            case SLICE:
+                made = arena->make<SliceExp>(line, col, Symbol {a}, exp(b), exp(c), flags[node]);
+                break;
+            case REFERENCE:
+                made = arena->make<ReferenceExp>(line, col, exp(a), b);
+                break;
+            case ARRAY:
+                made = arena->make<ArrayExp>(line, col, exps(a, b));
+                break;
+            case UNIFORM_ARRAY:
+                made = arena->make<UniformArrayExp>(line, col, exp(a), exp(b));
+                break;
+            case DEC: {
+                auto* built = arena->make<DecStmt>(line, col, Symbol {a}, values[b], exp(c));
+                built->slot = slot;
+                stmt = built;
+                break;
+            }
+            case ASSIGN:
+                stmt = arena->make<AssignStmt>(line, col, exp(a), exp(b), flags[node]);
+                break;
+            case COMPOUND_ASSIGN:
+                stmt = arena->make<CompoundAssignStmt>(line, col, BinaryExp::Operation(flags[node]),
+                                                       exp(a), exp(b));
+                break;
+            case FOR: {
+                auto parts = list(b, 3);
+                auto* built = arena->make<ForStmt>(line, col, Symbol {a}, exp(parts[0]), exp(parts[1]),
+                                                   block(parts[2]), flags[node]);
+                built->slot = slot;
+                stmt = built;
+                break;
+            }
+            case WHILE:
+                stmt = arena->make<WhileStmt>(line, col, exp(a), block(b));
+                break;
+            case PRINT: {
+                auto* built = arena->make<PrintStmt>(line, col, strings[a], exps(b, c));
+                built->format = strings[a + 1];
+                stmt = built;
+                break;
+            }
+            case BREAK: {
+                auto* built = arena->make<BreakStmt>(line, col, exp(a));
+                built->type = type;
+                stmt = built;
+                break;
+            }
+            case RETURN: {
+                auto* built = arena->make<ReturnStmt>(line, col, exp(a));
+                built->type = type;
+                stmt = built;
+                break;
+            }
+            case EXP_STMT: {
+                auto* built = arena->make<ExpStmt>(line, col, exp(a), flags[node]);
+                built->type = type;
+                stmt = built;
+                break;
+            }
+            case PARAM:
+                // read by the FUN that follows
+                continue;
+            case FUN: {
+                std::pmr::vector<Param> params(arena.get());
+                params.reserve(c);
+                for (NodeId param : list(b, c)) {
+                    auto [line, col] = locations[param];
+                    params.emplace_back(line, col, this->type(param), Symbol {first[param]});
+                }
+                Fun* built = arena->make<Fun>(line, col, type, std::move(params), block(a));
+                built->slots = slot;
+                nodes[node] = built;
+                continue;
+            }
+        }
+        if (made) {
+            made->type = type;
+            nodes[node] = made;
+        }
+        else {
+            nodes[node] = stmt;
+        }
+    }
+
+    std::pmr::vector<std::pair<Symbol, Fun*>> funs(arena.get());
+    funs.reserve(this->funs.size());
+    for (const auto& [id, node] : this->funs) {
+        funs.emplace_back(id, static_cast<Fun*>(nodes[node]));
+    }
+    return new Program(std::move(arena), std::move(funs));
+}
+
+// what a node is, as the child of another
+enum class Role { EXP, STMT, BLOCK, BRANCH, PARAM, FUN };
+
+static Role roleOf(FlatAst::Kind kind) {
+    switch (kind) {
+        case FlatAst::BLOCK: return Role::BLOCK;
+        case FlatAst::BRANCH: return Role::BRANCH;
+        case FlatAst::PARAM: return Role::PARAM;
+        case FlatAst::FUN: return Role::FUN;
+        case FlatAst::DEC: case FlatAst::ASSIGN: case FlatAst::COMPOUND_ASSIGN: case FlatAst::FOR:
+        case FlatAst::WHILE: case FlatAst::PRINT: case FlatAst::BREAK: case FlatAst::RETURN:
+        case FlatAst::EXP_STMT:
+            return Role::STMT;
+        default:
+            return Role::EXP;
+    }
+}
+
+static bool isType(uint32_t type) {
+    return type <= Value::UNIT;
+}
+
+bool FlatAst::wellFormed() const {
+    auto is = [&](NodeId node, NodeId child, Role role) {
+        return child < node && roleOf(kinds[child]) == role;
+    };
+    auto optional = [&](NodeId node, NodeId child) {
+        return child == NONE || is(node, child, Role::EXP);
+    };
+    auto all = [&](NodeId node, uint32_t offset, uint32_t length, Role role) {
+        if (offset > lists.size() || length > lists.size() - offset) return false;
+        return std::all_of(lists.begin() + offset, lists.begin() + offset + length,
+                           [&](NodeId child) { return is(node, child, role); });
+    };
+    // one past the highest slot named since the last fn; the nodes of a fn
+    // are the ones right before it
+    uint32_t locals = 0;
+    for (NodeId node = 0; node < size(); ++node) {
+        uint32_t a = first[node], b = second[node], c = third[node];
+        if (kinds[node] > FUN || !isType(types[node])) return false;
+        if (kinds[node] != FUN && slots[node] != NONE) locals = std::max(locals, slots[node] + 1);
+        bool ok;
+        switch (kinds[node]) {
+            case BLOCK: ok = all(node, a, b, Role::STMT); break;
+            case BINARY: ok = is(node, a, Role::EXP) && is(node, b, Role::EXP) && flags[node] <= BinaryExp::DIV; break;
+            case UNARY: ok = is(node, a, Role::EXP) && flags[node] <= UnaryExp::LNOT; break;
+            case LITERAL: ok = a < values.size(); break;
+            case CALL: ok = all(node, b, c, Role::EXP); break;
+            case IF: ok = is(node, a, Role::BRANCH) && all(node, b, c, Role::BRANCH) && (!flags[node] || c > 0); break;
+            case BRANCH: ok = optional(node, a) && is(node, b, Role::BLOCK); break;
+            case LOOP: ok = is(node, a, Role::BLOCK) && isType(flags[node]); break;
+            case SUBSCRIPT: ok = is(node, b, Role::EXP); break;
+            case SLICE: ok = optional(node, b) && optional(node, c); break;
+            case REFERENCE: ok = is(node, a, Role::EXP); break;
+            case ARRAY: ok = all(node, a, b, Role::EXP); break;
+            case UNIFORM_ARRAY: ok = is(node, a, Role::EXP) && is(node, b, Role::EXP); break;
+            case DEC: ok = b < values.size() && optional(node, c); break;
+            case ASSIGN: ok = is(node, a, Role::EXP) && is(node, b, Role::EXP); break;
+            case COMPOUND_ASSIGN:
+                ok = is(node, a, Role::EXP) && is(node, b, Role::EXP) && flags[node] <= BinaryExp::DIV;
+                break;
+            case FOR:
+                ok = all(node, b, 2, Role::EXP) && all(node, b + 2, 1, Role::BLOCK);
+                break;
+            case WHILE: ok = is(node, a, Role::EXP) && is(node, b, Role::BLOCK); break;
+            case PRINT: ok = a < strings.size() && a + 1 < strings.size() && all(node, b, c, Role::EXP); break;
+            case BREAK: case RETURN: case EXP_STMT: ok = optional(node, a); break;
+            case FUN:
+                ok = is(node, a, Role::BLOCK) && all(node, b, c, Role::PARAM) && c <= slots[node] && locals <= slots[node];
+                locals = 0;
+                break;
+            default: ok = true; break;
+        }
+        if (!ok) return false;
+    }
+    return std::all_of(funs.begin(), funs.end(), [&](const auto& fun) {
+        return fun.second < size() && kinds[fun.second] == FUN;
+    });
+}
+
+// SERIALIZATION
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodes;
+    uint32_t lists;
+    uint32_t values;
+    uint32_t strings;
+    uint32_t funs;
+    uint32_t symbols;
+    uint32_t signatureTypes;
+    uint64_t stringBytes;
+    uint64_t symbolBytes;
+};
+
+static constexpr char MAGIC[8] = {'R', 'U', 'S', 'T', 'Y', 'A', 'S', 'T'};
+
+// a Value whose symbol is an index into the names of the file and whose
+// signature is a range of the parameter types written with it
+struct ValueRecord {
+    int64_t scalar;
+    uint32_t type;
+    uint32_t text;
+    uint32_t signature;
+    uint32_t signatureLength;
+    int32_t size;
+    uint32_t bits;
+};
+
+struct FunctionRecord {
+    uint32_t id;
+    uint32_t node;
+};
+
+enum ValueBits { LITERAL_BIT = 1, FUN_BIT = 2, REF_BIT = 4, MUT_BIT = 8, INITIALIZED_BIT = 16, SCALAR_BIT = 32 };
+
+// kinds whose first operand is a symbol
+static bool namesSymbol(FlatAst::Kind kind) {
+    switch (kind) {
+        case FlatAst::VARIABLE: case FlatAst::CALL: case FlatAst::SUBSCRIPT: case FlatAst::SLICE:
+        case FlatAst::DEC: case FlatAst::FOR: case FlatAst::PARAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+template <class T>
+static void put(std::string& out, const T* data, size_t count) {
+    out.append(reinterpret_cast<const char*>(data), count * sizeof(T));
+    out.resize((out.size() + 7) & ~size_t(7));
+}
+
+// copies count elements from the front of bytes; false if they run out
+template <class T>
+static bool take(std::span<const char>& bytes, std::vector<T>& into, size_t count) {
+    size_t size = count * sizeof(T);
+    size_t padded = (size + 7) & ~size_t(7);
+    if (bytes.size() < padded) return false;
+    into.resize(count);
+    if (size) memcpy(into.data(), bytes.data(), size);
+    bytes = bytes.subspan(padded);
+    return true;
+}
+
+// the lengths of some strings, then their bytes
+static void putStrings(std::string& out, const std::vector<std::string_view>& strings) {
+    std::vector<uint32_t> lengths;
+    std::string bytes;
+    for (std::string_view string : strings) {
+        lengths.push_back(string.size());
+        bytes += string;
+    }
+    put(out, lengths.data(), lengths.size());
+    put(out, bytes.data(), bytes.size());
+}
+
+static bool takeStrings(std::span<const char>& bytes, std::vector<std::string>& into,
+                        size_t count, size_t total) {
+    std::vector<uint32_t> lengths;
+    std::vector<char> text;
+    if (!take(bytes, lengths, count) || !take(bytes, text, total)) return false;
+    into.reserve(count);
+    size_t offset = 0;
+    for (uint32_t length : lengths) {
+        if (length > total - offset) return false;
+        into.emplace_back(text.data() + offset, length);
+        offset += length;
+    }
+    return offset == total;
+}
+
+std::string FlatAst::serialize() const {
+    // every symbol becomes an index into the names written with the tree;
+    // symbol ids are dense, so the map from one to the other is an array
+    std::vector<uint32_t> local(Interner::size(), NONE);
+    std::vector<std::string_view> names;
+    auto symbol = [&](uint32_t id) {
+        if (local[id] == NONE) {
+            local[id] = names.size();
+            names.push_back(Symbol {id}.str());
+        }
+        return local[id];
+    };
+
+    std::vector<uint32_t> firsts = first;
+    for (NodeId node = 0; node < size(); ++node) {
+        if (namesSymbol(kinds[node])) firsts[node] = symbol(first[node]);
+    }
+    std::vector<ValueRecord> records;
+    std::vector<uint8_t> signatureTypes;
+    records.reserve(values.size());
+    for (const Value& value : values) {
+        const std::vector<Value::Type>& types = value.signature.types();
+        uint32_t bits = (value.literal ? LITERAL_BIT : 0) | (value.fun ? FUN_BIT : 0)
+                        | (value.ref ? REF_BIT : 0) | (value.mut ? MUT_BIT : 0)
+                        | (value.initialized ? INITIALIZED_BIT : 0) | (value.hasScalar ? SCALAR_BIT : 0);
+        records.push_back({value.scalar, uint32_t(value.type), symbol(value.text.id),
+                           uint32_t(signatureTypes.size()), uint32_t(types.size()), value.size, bits});
+        signatureTypes.insert(signatureTypes.end(), types.begin(), types.end());
+    }
+    std::vector<FunctionRecord> functions;
+    for (const auto& [id, node] : funs) {
+        functions.push_back({symbol(id.id), node});
+    }
+
+    FileHeader header {};
+    memcpy(header.magic, MAGIC, sizeof MAGIC);
+    header.version = FORMAT_VERSION;
+    header.nodes = size();
+    header.lists = lists.size();
+    header.values = values.size();
+    header.strings = strings.size();
+    header.funs = funs.size();
+    header.symbols = names.size();
+    header.signatureTypes = signatureTypes.size();
+    for (const std::string& string : strings) header.stringBytes += string.size();
+    for (std::string_view name : names) header.symbolBytes += name.size();
+
+    std::string out;
+    out.reserve(sizeof header + bytes());
+    put(out, &header, 1);
+    put(out, kinds.data(), size());
+    put(out, types.data(), size());
+    put(out, flags.data(), size());
+    put(out, firsts.data(), size());
+    put(out, second.data(), size());
+    put(out, third.data(), size());
+    put(out, slots.data(), size());
+    put(out, locations.data(), size());
+    put(out, lists.data(), lists.size());
+    put(out, records.data(), records.size());
+    put(out, signatureTypes.data(), signatureTypes.size());
+    put(out, functions.data(), functions.size());
+    putStrings(out, {strings.begin(), strings.end()});
+    putStrings(out, names);
+    return out;
+}
+
+std::unique_ptr<FlatAst> FlatAst::deserialize(std::span<const char> bytes) {
+    FileHeader header;
+    if (bytes.size() < sizeof header) return nullptr;
+    memcpy(&header, bytes.data(), sizeof header);
+    if (memcmp(header.magic, MAGIC, sizeof MAGIC) != 0 || header.version != FORMAT_VERSION) {
+        return nullptr;
+    }
+    bytes = bytes.subspan(sizeof header);
+
+    std::unique_ptr<FlatAst> ast(new FlatAst());
+    std::vector<ValueRecord> records;
+    std::vector<uint8_t> signatureTypes;
+    std::vector<FunctionRecord> functions;
+    std::vector<std::string> names;
+    if (!take(bytes, ast->kinds, header.nodes)
+        || !take(bytes, ast->types, header.nodes)
+        || !take(bytes, ast->flags, header.nodes)
+        || !take(bytes, ast->first, header.nodes)
+        || !take(bytes, ast->second, header.nodes)
+        || !take(bytes, ast->third, header.nodes)
+        || !take(bytes, ast->slots, header.nodes)
+        || !take(bytes, ast->locations, header.nodes)
+        || !take(bytes, ast->lists, header.lists)
+        || !take(bytes, records, header.values)
+        || !take(bytes, signatureTypes, header.signatureTypes)
+        || !take(bytes, functions, header.funs)
+        || !takeStrings(bytes, ast->strings, header.strings, header.stringBytes)
+        || !takeStrings(bytes, names, header.symbols, header.symbolBytes)
+        || !bytes.empty()) {
+        return nullptr;
+    }
+
+    // back from the indices of the file to the symbols of this process
+    std::vector<Symbol> symbols;
+    symbols.reserve(names.size());
+    for (const std::string& name : names) {
+        symbols.push_back(Interner::intern(name));
+    }
+    for (NodeId node = 0; node < ast->size(); ++node) {
+        if (!namesSymbol(ast->kinds[node])) continue;
+        if (ast->first[node] >= symbols.size()) return nullptr;
+        ast->first[node] = symbols[ast->first[node]].id;
+    }
+    ast->values.reserve(records.size());
+    for (const ValueRecord& record : records) {
+        if (record.text >= symbols.size() || !isType(record.type)
+            || record.signature > signatureTypes.size()
+            || record.signatureLength > signatureTypes.size() - record.signature) {
+            return nullptr;
+        }
+        Value value;
+        value.scalar = record.scalar;
+        value.type = Value::Type(record.type);
+        value.text = symbols[record.text];
+        if (record.signatureLength) {
+            std::vector<Value::Type> types;
+            for (uint32_t i = 0; i < record.signatureLength; ++i) {
+                uint8_t type = signatureTypes[record.signature + i];
+                if (!isType(type)) return nullptr;
+                types.push_back(Value::Type(type));
+            }
+            value.signature = Value::Signature::intern(types);
+        }
+        value.size = record.size;
+        value.literal = record.bits & LITERAL_BIT;
+        value.fun = record.bits & FUN_BIT;
+        value.ref = record.bits & REF_BIT;
+        value.mut = record.bits & MUT_BIT;
+        value.initialized = record.bits & INITIALIZED_BIT;
+        value.hasScalar = record.bits & SCALAR_BIT;
+        ast->values.push_back(value);
+    }
+    for (const auto& [id, node] : functions) {
+        if (id >= symbols.size()) return nullptr;
+        ast->funs.emplace_back(symbols[id], node);
+    }
+    if (!ast->wellFormed()) return nullptr;
+    return ast;
+}
@@ -0,0 +1,118 @@
+#ifndef FLATAST_H
+#define FLATAST_H
+
+#include "Fun.h"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+// The form AstCache stores a checked Program in. Nodes are numbered in
+// post-order, every child before its parent, and each field lives in its
+// own array indexed by the 32-bit node id, with locations in a side table;
+// the arrays are written and read back as they are. No pass reads them:
+// program() rebuilds the pointer tree the passes visit, in a single scan.
+// Flattening a checked program keeps what NameRes and TypeCheck wrote into
+// the nodes, so a tree loaded from the cache goes to the back end without
+// the checks.
+class FlatAst {
+public:
+    using NodeId = uint32_t;
+    // an absent child, like the rhs of `let x;`
+    static constexpr NodeId NONE = UINT32_MAX;
+
+    enum Kind : uint8_t {
+        BLOCK, BINARY, UNARY, LITERAL, VARIABLE, CALL, IF, BRANCH, LOOP,
+        SUBSCRIPT, SLICE, REFERENCE, ARRAY, UNIFORM_ARRAY,
+        DEC, ASSIGN, COMPOUND_ASSIGN, FOR, WHILE, PRINT, BREAK, RETURN, EXP_STMT,
+        PARAM, FUN,
+    };
+
+    struct Location {
+        int line;
+        int col;
+    };
+
+    explicit FlatAst(Program* program);
+
+    // a pointer tree equal to the flattened one, in its own arena
+    Program* program() const;
+
+    // Binary form, for the parse cache: a header with the format version and
+    // the array lengths, then every array as it is in memory at an 8-byte
+    // boundary, so a reader can map a file and copy each with one memcpy.
+    // Symbols and signatures are written by name, as their ids only hold
+    // within one process. The bytes are for the machine that wrote them.
+    static constexpr uint32_t FORMAT_VERSION = 2;
+    std::string serialize() const;
+    // nullptr if the bytes are not a whole, well-formed flat AST of this version
+    static std::unique_ptr<FlatAst> deserialize(std::span<const char> bytes);
+
+private:
+    FlatAst() = default;
+
+    size_t size() const;
+    // memory taken by the arrays
+    size_t bytes() const;
+    Value::Type type(NodeId node) const;
+
+    // whether every operand names what its kind says it does: a child before
+    // the node, of the kind of node it should be, or an entry inside lists,
+    // values or strings; and every slot is a local of its fn
+    bool wellFormed() const;
+
+    // What the operands hold depends on the kind:
+    //   BLOCK          list of statements
+    //   BINARY, UNARY  operands; flags is the operation
+    //   LITERAL        index in values
+    //   VARIABLE       symbol
+    //   CALL           symbol, list of arguments
+    //   IF             if branch, list of else if branches then the else
+    //                  branch, which is there when flags is set
+    //   BRANCH         condition or NONE, block
+    //   LOOP           block; flags is the type of the loop
+    //   SUBSCRIPT      symbol, index
+    //   SLICE          symbol, start, end; flags is inclusive
+    //   REFERENCE      operand, count
+    //   ARRAY          list of elements
+    //   UNIFORM_ARRAY  value, size
+    //   DEC            symbol, index in values, rhs or NONE
+    //   ASSIGN         lhs, rhs; flags is ref
+    //   COMPOUND_ASSIGN lhs, rhs; flags is the operation
+    //   FOR            symbol, list of start, end and block; flags is inclusive
+    //   WHILE          condition, block
+    //   PRINT          index in strings of the source string, followed by
+    //                  the format TypeCheck worked out; list of arguments
+    //   BREAK, RETURN  operand or NONE
+    //   EXP_STMT       operand or NONE; flags is returnValue
+    //   PARAM          symbol
+    //   FUN            block, list of params
+    // A list is an offset into lists and a length, in two operands.
+    // slots holds the local a VARIABLE or SUBSCRIPT names and the one a DEC
+    // or FOR declares, as NameRes numbered them, and the number of locals
+    // of a FUN.
+    std::vector<Kind> kinds;
+    std::vector<uint8_t> types;
+    std::vector<uint8_t> flags;
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> second;
+    std::vector<uint32_t> third;
+    std::vector<uint32_t> slots;
+    std::vector<Location> locations;
+
+    std::vector<NodeId> lists;
+    std::vector<Value> values;
+    std::vector<std::string> strings;
+    std::vector<std::pair<Symbol, NodeId>> funs;
+
+    NodeId add(Kind kind, int line, int col, Value::Type type,
+               uint32_t a = NONE, uint32_t b = NONE, uint32_t c = NONE, uint8_t flag = 0,
+               uint32_t slot = NONE);
+    uint32_t addList(std::span<const NodeId> nodes);
+
+    // the visitor that numbers the nodes of a Program
+    class Builder;
+};
+
+#endif
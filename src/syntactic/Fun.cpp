@@ -1,8 +1,16 @@
 #include "Fun.h"
 
-Fun::~Fun() {
-    delete block;
+Value::Signature Fun::signature() const {
+    if (!interned) {
+        std::vector<Value::Type> types;
+        for (const auto& param : params) {
+            types.push_back(param.type);
+        }
+        interned = Value::Signature::intern(types);
+    }
+    return *interned;
 }
+
 std::ostream& operator<<(std::ostream& out, const Fun* fun) {
     out << "(";
     if (fun->params.empty()) {
@@ -19,12 +27,6 @@ std::ostream& operator<<(std::ostream& out, const Fun* fun) {
     return out;
 }
 
-Program::~Program() {
-    for (const auto& [id, fun]: funs) {
-        delete fun;
-    }
-    funs.clear();
-}
 std::ostream& operator<<(std::ostream& out, Program* program) {
     for (const auto& [id, fun] : program->funs) {
         out << "fn " << id << fun << "\n";
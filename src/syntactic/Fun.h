@@ -1,17 +1,20 @@
 #ifndef FUN_H
 #define FUN_H
 
-#define FRIENDS friend class CodeGen; friend class TypeCheck; friend class NameRes;
+#define FRIENDS friend class CodeGen; friend class TypeCheck; friend class NameRes; friend class LineShift; friend class FlatAst; friend class IrBuilder;
 
 #include "Stmt.h"
+#include "Arena.h"
+#include <memory>
+#include <optional>
 
 struct Param {
     int line;
     int col;
     Value::Type type;
-    std::string id;
+    Symbol id;
     Param() = default;
-    Param(int line, int col, Value::Type type, std::string id) 
+    Param(int line, int col, Value::Type type, Symbol id) 
         : line(line), col(col), type(type), id(id) {}
 };
 
@@ -20,24 +23,35 @@ class Fun {
     int line;
     int col;
     Value::Type type;
-    std::list<Param> params;
+    std::pmr::vector<Param> params;
     Block* block;
+    // number of locals, the params being the first ones; set by NameRes
+    int slots {};
+    // interned on first use, which is never on the parser's threads
+    mutable std::optional<Value::Signature> interned;
 
 public:
-    Fun(int line, int col, Value::Type type, std::list<Param> params, Block *block)
+    Fun(int line, int col, Value::Type type, std::pmr::vector<Param> params, Block *block)
             : line(line), col(col), type(type), params(std::move(params)), block(block) {}
-    ~Fun();
     Value accept(Visitor* visitor);
+    Value::Signature signature() const;
     friend std::ostream& operator<<(std::ostream& out, const Fun* fun);
 };
 
 class Program {
     FRIENDS
-    std::list<std::pair<std::string,Fun*>> funs;
+    // owns every node of the tree; declared first so it is released last
+    std::unique_ptr<Arena> arena;
+    // functions parsed on their own each live in one of these
+    std::vector<std::unique_ptr<Arena>> funArenas;
+    std::pmr::vector<std::pair<Symbol,Fun*>> funs;
 
 public:
-    explicit Program(std::list<std::pair<std::string,Fun*>>  funs) : funs(std::move(funs)) {}
-    ~Program();
+    Program(std::unique_ptr<Arena> arena, std::pmr::vector<std::pair<Symbol,Fun*>> funs)
+        : arena(std::move(arena)), funs(std::move(funs)) {}
+    Program(std::unique_ptr<Arena> arena, std::vector<std::unique_ptr<Arena>> funArenas,
+            std::pmr::vector<std::pair<Symbol,Fun*>> funs)
+        : arena(std::move(arena)), funArenas(std::move(funArenas)), funs(std::move(funs)) {}
     void accept(Visitor* visitor);
     friend std::ostream& operator<<(std::ostream& out, Program* program);
 };
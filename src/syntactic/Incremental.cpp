@@ -0,0 +1,279 @@
+#include "Incremental.h"
+#include "../semantic/LineShift.h"
+#include <algorithm>
+
+Incremental::Incremental(std::string_view text) {
+    rebuild(0, 0, 1, std::string(text));
+}
+
+Incremental::~Incremental() = default;
+
+void Incremental::seek(size_t offset) {
+    while (hint > 0 && offset < hintOffset) {
+        --hint;
+        hintOffset -= segments[hint]->text.size();
+        hintLine -= segments[hint]->newlines;
+    }
+    while (hint + 1 < segments.size() && hintOffset + segments[hint]->text.size() <= offset) {
+        hintOffset += segments[hint]->text.size();
+        hintLine += segments[hint]->newlines;
+        ++hint;
+    }
+}
+
+std::string Incremental::text() const {
+    std::string text;
+    for (const auto& segment : segments) {
+        text += segment->text;
+    }
+    return text;
+}
+
+size_t Incremental::size() const {
+    return bytes;
+}
+
+std::vector<bool> Incremental::unchecked() const {
+    std::vector<bool> unchecked;
+    for (const auto& segment : segments) {
+        for (const Item& item : segment->items) {
+            unchecked.push_back(!item.checked);
+        }
+    }
+    return unchecked;
+}
+
+void Incremental::markChecked() {
+    for (auto& segment : segments) {
+        for (Item& item : segment->items) {
+            item.checked = true;
+        }
+    }
+}
+
+size_t Incremental::parsedItems() const {
+    return itemsParsed;
+}
+
+size_t Incremental::shiftedItems() const {
+    return itemsShifted;
+}
+
+void Incremental::edit(size_t begin, size_t end, std::string_view replacement) {
+    if (begin > end || end > bytes) {
+        throw std::runtime_error("edit range [" + std::to_string(begin) + ", "
+                                 + std::to_string(end) + ") is out of the text");
+    }
+    current.reset();
+
+    // segments [first, last) hold the edited bytes
+    seek(begin);
+    size_t first = hint;
+    size_t offset = hintOffset;
+    int line = hintLine;
+    size_t last = first;
+    size_t lastEnd = offset + segments[first]->text.size();
+    while (end > lastEnd && last + 1 < segments.size()) {
+        lastEnd += segments[++last]->text.size();
+    }
+    ++last;
+
+    std::string text;
+    for (size_t i = first; i < last; ++i) {
+        text += segments[i]->text;
+    }
+    text.replace(begin - offset, end - begin, replacement);
+    // segments end at a line break, so an edit that joins two lines takes the next segment too
+    while (!text.empty() && text.back() != '\n' && last < segments.size()) {
+        text += segments[last++]->text;
+    }
+    rebuild(first, last, line, std::move(text));
+    // the segments before the edit did not move
+    if (first == segments.size()) {
+        hint = hintOffset = 0;
+        hintLine = 1;
+    }
+}
+
+void Incremental::rebuild(size_t first, size_t last, int line, std::string text) {
+
+    std::unique_ptr<Scanner> scanner;
+    // first token of each item, and the item
+    std::vector<std::pair<size_t, Item>> parsed;
+    std::string error;
+    bool lexical {};
+    while (true) {
+        parsed.clear();
+        error.clear();
+        try {
+            lexical = true;
+            scanner = std::make_unique<Scanner>(std::string_view(text), line);
+            lexical = false;
+            Parser parser(scanner.get());
+            while (!scanner->eof()) {
+                size_t at = scanner->getIndex();
+                auto arena = std::make_unique<Arena>(Arena::FUNCTION_CHUNK_SIZE);
+                auto [id, fun] = parser.parseItem(arena.get());
+                parsed.push_back({at, Item {std::move(arena), id, fun}});
+            }
+        }
+        catch (const std::runtime_error& e) {
+            error = e.what();
+        }
+        // a string or an item cut off by the end of the text goes on in the
+        // next segment; lexical errors do not say where they happened, so
+        // they always take the next segment in
+        bool cutOff = !error.empty() && (lexical || scanner->peek(2) == Token::END);
+        if (!cutOff || last == segments.size()) break;
+        text += segments[last++]->text;
+    }
+
+    std::vector<std::unique_ptr<Segment>> built;
+    auto add = [&](std::string segmentText) -> Segment& {
+        auto segment = std::make_unique<Segment>();
+        segment->text = std::move(segmentText);
+        segment->newlines = std::count(segment->text.begin(), segment->text.end(), '\n');
+        segment->line = line;
+        line += segment->newlines;
+        built.push_back(std::move(segment));
+        return *built.back();
+    };
+
+    if (!error.empty()) {
+        Segment& segment = add(std::move(text));
+        segment.error = std::move(error);
+        segment.lexical = lexical;
+    }
+    else {
+        std::span<const Token> tokens = scanner->getTokens();
+        auto inText = [&](const Token& token) {
+            return token.content.data() >= text.data() && token.content.data() <= text.data() + text.size();
+        };
+        auto offsetOf = [&](const Token& token) {
+            return static_cast<size_t>(token.content.data() - text.data());
+        };
+
+        // a new segment starts after the first line break between two items
+        std::vector<size_t> starts {0};
+        for (size_t i = 1; i < parsed.size(); ++i) {
+            const Token& prev = tokens[parsed[i].first - 1];
+            size_t newline = text.find('\n', offsetOf(prev) + prev.content.size());
+            if (newline < offsetOf(tokens[parsed[i].first])) {
+                starts.push_back(newline + 1);
+            }
+        }
+
+        itemsParsed += parsed.size();
+        size_t token = 1;
+        size_t item = 0;
+        for (size_t i = 0; i < starts.size(); ++i) {
+            size_t begin = starts[i];
+            size_t end = i + 1 < starts.size() ? starts[i + 1] : text.size();
+            Segment& segment = add(text.substr(begin, end - begin));
+            for (; tokens[token].type != Token::END; ++token) {
+                Token copy = tokens[token];
+                if (inText(copy)) {
+                    size_t offset = offsetOf(copy);
+                    if (offset >= end) break;
+                    copy.content = std::string_view(segment.text).substr(offset - begin, copy.content.size());
+                }
+                segment.tokens.push_back(copy);
+            }
+            for (; item < parsed.size() && offsetOf(tokens[parsed[item].first]) < end; ++item) {
+                segment.items.push_back(std::move(parsed[item].second));
+            }
+        }
+    }
+
+    // an emptied segment is dropped unless it is all that is left
+    if (built.size() == 1 && built[0]->text.empty() && segments.size() > last - first) {
+        built.clear();
+    }
+    for (size_t i = first; i < last; ++i) {
+        bytes -= segments[i]->text.size();
+        items -= segments[i]->items.size();
+        broken -= !segments[i]->error.empty();
+    }
+    for (const auto& segment : built) {
+        bytes += segment->text.size();
+        items += segment->items.size();
+        broken += !segment->error.empty();
+    }
+    // usually one segment replaces one, and nothing after it has to move
+    size_t common = std::min(built.size(), last - first);
+    std::move(built.begin(), built.begin() + common, segments.begin() + first);
+    segments.erase(segments.begin() + first + common, segments.begin() + last);
+    segments.insert(segments.begin() + first + common,
+                    std::make_move_iterator(built.begin() + common), std::make_move_iterator(built.end()));
+}
+
+void Incremental::rebase() {
+    LineShift lineShift;
+    int line = 1;
+    for (auto& segment : segments) {
+        int delta = line - segment->line;
+        if (delta != 0 && segment->error.empty()) {
+            for (Token& token : segment->tokens) {
+                token.line += delta;
+            }
+            for (Item& item : segment->items) {
+                lineShift.shift(item.fun, delta);
+            }
+            itemsShifted += segment->items.size();
+            segment->line = line;
+        }
+        line += segment->newlines;
+    }
+}
+
+void Incremental::check() {
+    // a full compile lexes the whole text before parsing it, so the first
+    // lexical error wins over any syntax error
+    for (bool lexical : {true, false}) {
+        int line = 1;
+        for (size_t i = 0; broken && i < segments.size(); line += segments[i++]->newlines) {
+            Segment& segment = *segments[i];
+            if (segment.error.empty() || segment.lexical != lexical) continue;
+            // the message carries line numbers, which are stale if lines were added above
+            if (segment.line != line) {
+                rebuild(i, i + 1, line, segment.text);
+                hint = hintOffset = 0;
+                hintLine = 1;
+                return check();
+            }
+            throw std::runtime_error(segment.error);
+        }
+    }
+    // the parser expects at least one function
+    if (items == 0) {
+        std::string source = text();
+        Scanner scanner(source, 1);
+        Parser parser(&scanner);
+        delete parser.parse();
+    }
+}
+
+Program* Incremental::program() {
+    check();
+    rebase();
+    if (!current) {
+        auto arena = std::make_unique<Arena>(Arena::FUNCTION_CHUNK_SIZE);
+        std::pmr::vector<std::pair<Symbol, Fun*>> funs(arena.get());
+        for (const auto& segment : segments) {
+            for (const Item& item : segment->items) {
+                funs.emplace_back(item.id, item.fun);
+            }
+        }
+        current = std::make_unique<Program>(std::move(arena), std::move(funs));
+    }
+    return current.get();
+}
+
+std::vector<Token> Incremental::tokens() {
+    rebase();
+    std::vector<Token> tokens;
+    for (const auto& segment : segments) {
+        tokens.insert(tokens.end(), segment->tokens.begin(), segment->tokens.end());
+    }
+    return tokens;
+}
@@ -0,0 +1,84 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "Parser.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Front end for a buffer that is edited in place, as in the web editor.
+// The text is kept as runs of whole lines, each with the tokens and the fn
+// items that start in it. An edit re-lexes and re-parses only the runs it
+// touches, plus the following ones when a token or an item crosses their
+// end; every other Fun subtree is reused as it is.
+class Incremental {
+public:
+    explicit Incremental(std::string_view text);
+    ~Incremental();
+
+    Incremental(const Incremental&) = delete;
+    Incremental& operator=(const Incremental&) = delete;
+
+    // replaces the bytes [begin, end) of the text with replacement
+    void edit(size_t begin, size_t end, std::string_view replacement);
+
+    // throws the error that parsing the whole text from scratch would throw
+    void check();
+    // the program of the current text, valid until the next edit; throws like check()
+    Program* program();
+    // every token of the text, without BEG and END
+    std::vector<Token> tokens();
+    std::string text() const;
+    size_t size() const;
+
+    // for each fn of program(), whether it was parsed after the last call to
+    // markChecked(); the others passed the semantic checks as they are
+    std::vector<bool> unchecked() const;
+    // records that every fn of program() passed the semantic checks
+    void markChecked();
+    // fn items parsed, and fn items moved to other lines, so far
+    size_t parsedItems() const;
+    size_t shiftedItems() const;
+
+private:
+    struct Item {
+        // each item has its own arena, released when the item is parsed again
+        std::unique_ptr<Arena> arena;
+        Symbol id;
+        Fun* fun;
+        bool checked {};
+    };
+
+    struct Segment {
+        // whole lines; only the last segment may end without a newline
+        std::string text;
+        int newlines {};
+        // line of text[0] when tokens and items were built
+        int line {};
+        // views into text
+        std::vector<Token> tokens;
+        std::vector<Item> items;
+        // set when the segment does not lex or parse
+        std::string error;
+        bool lexical {};
+    };
+
+    std::vector<std::unique_ptr<Segment>> segments;
+    std::unique_ptr<Program> current;
+    size_t bytes {};
+    size_t items {};
+    size_t broken {};
+    size_t itemsParsed {};
+    size_t itemsShifted {};
+    // a segment with its known offset and first line; keystrokes land close
+    // to each other, so the next edit is found by walking from here
+    size_t hint {};
+    size_t hintOffset {};
+    int hintLine {1};
+
+    void seek(size_t offset);
+    void rebuild(size_t first, size_t last, int line, std::string text);
+    void rebase();
+};
+
+#endif
@@ -1,19 +1,38 @@
 #include "Parser.h"
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <thread>
+
+// functions handed to a worker at a time, and the fewest worth a thread
+static constexpr size_t FUNS_PER_TASK = 16;
+static constexpr size_t FUNS_PER_THREAD = 64;
+
+// The deepest tree the parser builds. The parser keeps operators on its own
+// stack, but the printer, the checks and both back ends recurse once per
+// level, and past this they would overflow the 8 MB stack a thread gets.
+static constexpr int MAX_DEPTH = 4000;
+
+// number of parsing threads; RUSTY_THREADS overrides the number of cores
+static unsigned parseThreads() {
+    if (const char* forced = std::getenv("RUSTY_THREADS")) {
+        return std::max(1, atoi(forced));
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
 
-Parser::Parser(char* filename) {
-    scanner = new Scanner(filename);
+Parser::Parser(Scanner* scanner) : scanner(scanner) {
     match(Token::BEG);
 }
-Parser::~Parser() {
-    delete scanner;
-}
+Parser::~Parser() = default;
 
 std::pair<int,int> Parser::getPos() {
     return {currentToken().line, currentToken().col};
 }
 
 std::string Parser::debugInfo(const Token& token) {
-    return "Token: " + std::string(token) + " | Content: " + token.content
+    return "Token: " + std::string(token) + " | Content: " + std::string(token.content)
              + "\nat line: " + std::to_string(token.line)
              + " | column: " + std::to_string(token.col);
 }
@@ -54,24 +73,126 @@ Token::Type Parser::peek() {
     return scanner->peek();
 }
 bool Parser::check(Token::Type type) {
-    return scanner->check(Token{type});
+    return scanner->check(type);
 }
 bool Parser::match(Token::Type type) {
-    return scanner->match(Token{type});
+    return scanner->match(type);
 }
-Token Parser::currentToken() {
+const Token& Parser::currentToken() {
     return scanner->getToken();
 }
 
 Program* Parser::parse() {
-    std::list<std::pair<std::string,Fun*>> funs;
+    // large files are split into their fn items, which are parsed in parallel
+    unsigned threads = parseThreads();
+    std::vector<std::pair<size_t, size_t>> items;
+    if (threads > 1 && findItems(items)) {
+        threads = std::min<size_t>(threads, items.size() / FUNS_PER_THREAD);
+        if (threads > 1) {
+            if (Program* program = parseInParallel(items, threads)) return program;
+        }
+    }
+
+    // every node is placed in the arena, which the Program takes over
+    auto owner = std::make_unique<Arena>();
+    arena = owner.get();
+
+    std::pmr::vector<std::pair<Symbol,Fun*>> funs(arena);
     auto [id, fun] = parseFunction();
     funs.emplace_back(id, fun);
     while (!scanner->eof()) {
         auto [id, fun] = parseFunction();
         funs.emplace_back(id, fun);
     }
-    return new Program(funs);
+    arena = nullptr;
+    return new Program(std::move(owner), std::move(funs));
+}
+
+bool Parser::findItems(std::vector<std::pair<size_t, size_t>>& items) {
+    // every item is `fn ... { ... }`, and braces only open and close blocks,
+    // so an item ends where the braces of its body balance out; anything
+    // else is left to the sequential parser, which reports the error
+    std::span<const Token> tokens = scanner->getTokens();
+    size_t i = scanner->getIndex();
+    while (tokens[i].type != Token::END) {
+        if (tokens[i].type != Token::FN) return false;
+        size_t begin = i;
+        while (tokens[i].type != Token::OPEN_CURLY) {
+            if (tokens[i].type == Token::END) return false;
+            ++i;
+        }
+        int depth = 0;
+        do {
+            if (tokens[i].type == Token::OPEN_CURLY) ++depth;
+            else if (tokens[i].type == Token::CLOSE_CURLY) --depth;
+            else if (tokens[i].type == Token::END) return false;
+            ++i;
+        } while (depth > 0);
+        items.emplace_back(begin, i);
+    }
+    return !items.empty();
+}
+
+Program* Parser::parseInParallel(const std::vector<std::pair<size_t, size_t>>& items, unsigned threads) {
+    struct Parsed {
+        std::unique_ptr<Arena> arena;
+        Symbol id;
+        Fun* fun {};
+        std::exception_ptr error;
+        bool aligned {};
+    };
+    std::vector<Parsed> parsed(items.size());
+
+    // each function gets its own cursor over the shared tokens and its own arena
+    std::atomic<size_t> next {0};
+    auto work = [&] {
+        for (size_t first; (first = next.fetch_add(FUNS_PER_TASK)) < items.size();) {
+            size_t last = std::min(first + FUNS_PER_TASK, items.size());
+            for (size_t i = first; i < last; ++i) {
+                Scanner cursor(*scanner, items[i].first);
+                Parser parser(&cursor);
+                Parsed& result = parsed[i];
+                result.arena = std::make_unique<Arena>(Arena::FUNCTION_CHUNK_SIZE);
+                try {
+                    std::tie(result.id, result.fun) = parser.parseItem(result.arena.get());
+                    result.aligned = cursor.getIndex() == items[i].second;
+                }
+                catch (...) {
+                    result.error = std::current_exception();
+                }
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // the first error in source order is the one the sequential parser throws
+    auto owner = std::make_unique<Arena>();
+    std::vector<std::unique_ptr<Arena>> arenas;
+    std::pmr::vector<std::pair<Symbol,Fun*>> funs(owner.get());
+    arenas.reserve(parsed.size());
+    funs.reserve(parsed.size());
+    for (Parsed& result : parsed) {
+        if (result.error) std::rethrow_exception(result.error);
+        // an item that did not end where its braces do is left to the sequential parser
+        if (!result.aligned) return nullptr;
+        funs.emplace_back(result.id, result.fun);
+        arenas.push_back(std::move(result.arena));
+    }
+    return new Program(std::move(owner), std::move(arenas), std::move(funs));
+}
+
+std::pair<Symbol, Fun*> Parser::parseItem(Arena* arena) {
+    this->arena = arena;
+    auto item = parseFunction();
+    this->arena = nullptr;
+    return item;
 }
 
 Block* Parser::parseBlock() {
@@ -80,8 +201,11 @@ Block* Parser::parseBlock() {
         throw std::runtime_error("expected '{' to start block\ngot: "
                                  + debugInfo(currentToken()));
     }
+    // the block and a statement in it
+    nest(2, line, col);
+    depth += 2;
 
-    std::list<Stmt*> stmts;
+    std::pmr::vector<Stmt*> stmts(arena);
     Stmt* stmt;
     while (!check(Token::CLOSE_CURLY)) {
         stmt = parseStatement();
@@ -93,7 +217,8 @@ Block* Parser::parseBlock() {
                                  + debugInfo(currentToken()));
     }
 
-    return new Block(line, col, stmts);
+    depth -= 2;
+    return arena->make<Block>(line, col, std::move(stmts));
 }
 
 Param Parser::parseParameter() {
@@ -106,7 +231,7 @@ Param Parser::parseParameter() {
         throw std::runtime_error("expected id in parameter list\ngot: "
                                  + debugInfo(currentToken()));
     }
-    param.id = currentToken().content;
+    param.id = currentToken().sym;
     match(Token::ID);
 
     if (!match(Token::COLON)) {
@@ -124,7 +249,7 @@ Param Parser::parseParameter() {
     return param;
 }
 
-std::pair<std::string, Fun*> Parser::parseFunction() {
+std::pair<Symbol, Fun*> Parser::parseFunction() {
     auto [line, col] = getPos();
     if (!match(Token::FN)) {
         throw std::runtime_error("expected function declaration\ngot: "
@@ -134,14 +259,14 @@ std::pair<std::string, Fun*> Parser::parseFunction() {
         throw std::runtime_error("expected function name after 'fn'\ngot: "
                                  + debugInfo(currentToken()));
     }
-    std::string id = currentToken().content;
+    Symbol id = currentToken().sym;
     match(Token::ID);
 
     if (!match(Token::OPEN_PARENTHESIS)) {
         throw std::runtime_error("expected parenthesis in function declaration\ngot: "
                                  + debugInfo(currentToken()));
     }
-    std::list<Param> params;
+    std::pmr::vector<Param> params(arena);
     if (!check(Token::CLOSE_PARENTHESIS)) {
         Param param = parseParameter();
         params.push_back(param);
@@ -176,7 +301,7 @@ std::pair<std::string, Fun*> Parser::parseFunction() {
 
     Block* block = parseBlock();
 
-    return {id, new Fun(line, col, type, params, block)};
+    return {id, arena->make<Fun>(line, col, type, std::move(params), block)};
 }
 
 Exp* Parser::parseRhs() {
@@ -189,9 +314,9 @@ Exp* Parser::parseRhs() {
                 throw std::runtime_error("expected closing bracket in uniform array\ngot: "
                                          + debugInfo(currentToken()));
             }
-            return new UniformArrayExp(line, col, exp, size);
+            return arena->make<UniformArrayExp>(line, col, exp, size);
         }
-        std::list<Exp*> elements = {exp};
+        std::pmr::vector<Exp*> elements({exp}, arena);
         while (match(Token::COMMA)) {
             elements.push_back(parseExpression());
         }
@@ -199,7 +324,7 @@ Exp* Parser::parseRhs() {
             throw std::runtime_error("expected closing bracket in array\ngot: "
                                      + debugInfo(currentToken()));
         }
-        return new ArrayExp(line, col, elements);
+        return arena->make<ArrayExp>(line, col, std::move(elements));
     }
     else {
         return parseExpression();
@@ -213,7 +338,7 @@ Stmt* Parser::parseStatement() {
         if (match(Token::MUT)) {
             var.mut = true;
         }
-        std::string id = currentToken().content;
+        Symbol id = currentToken().sym;
         if (!match(Token::ID)) {
             throw std::runtime_error("expected id in variable declaration\ngot: "
                                      + debugInfo(currentToken()));
@@ -239,7 +364,7 @@ Stmt* Parser::parseStatement() {
                     throw std::runtime_error("expected a number for array size in declaration\ngot: "
                                              + debugInfo(currentToken()));
                 }
-                var.size = stoi(currentToken().content);
+                var.size = stoi(std::string(currentToken().content));
                 match(Token::NUMBER);
 
                 if (!match(Token::CLOSE_BRACKET)) {
@@ -260,7 +385,7 @@ Stmt* Parser::parseStatement() {
             }
         }
         if (match(Token::SEMICOLON)) {
-            return new DecStmt(line, col, id, var);
+            return arena->make<DecStmt>(line, col, id, var);
         }
         if (!match(Token::ASSIGN)) {
             throw std::runtime_error("expected '=' in declaration\ngot: "
@@ -275,11 +400,11 @@ Stmt* Parser::parseStatement() {
         }
         ensureSemicolon("expected ';' after declaration statement");
 
-        return new DecStmt(line, col, id, var, rhs);
+        return arena->make<DecStmt>(line, col, id, var, rhs);
 
     }
     else if (match(Token::FOR)) {
-        std::string id = currentToken().content;
+        Symbol id = currentToken().sym;
         if (!match(Token::ID)) {
             throw std::runtime_error("expected id after 'for'\ngot: "
                                      + debugInfo(currentToken()));
@@ -301,29 +426,29 @@ Stmt* Parser::parseStatement() {
         Exp* end = parseExpression();
         Block* block = parseBlock();
 
-        return new ForStmt(line, col, id, start, end, block, inclusive);
+        return arena->make<ForStmt>(line, col, id, start, end, block, inclusive);
     }
     else if (match(Token::WHILE)) {
         Exp* cond = parseExpression();
         Block* block = parseBlock();
 
-        return new WhileStmt(line, col, cond, block);
+        return arena->make<WhileStmt>(line, col, cond, block);
     }
     else if (check(Token::IF) || check(Token::LOOP)) {
-        return new ExpStmt(line, col, parseFactorExp(), true);
+        return arena->make<ExpStmt>(line, col, parseFactorExp(), true);
     }
     else if (match(Token::PRINT)) {
         if (!match(Token::OPEN_PARENTHESIS)) {
             throw std::runtime_error("expected '(' after 'println!'\ngot: "
                                      + debugInfo(currentToken()));
         }
-        std::string literal = currentToken().content;
+        std::string literal (currentToken().content);
         if (!match(Token::STRING)) {
             throw std::runtime_error("expected string literal inside print\ngot: "
                                      + debugInfo(currentToken()));
         }
 
-        std::list<Exp*> args;
+        std::pmr::vector<Exp*> args(arena);
         while (match(Token::COMMA)) {
             Exp* arg = parseExpression();
             args.push_back(arg);
@@ -336,12 +461,12 @@ Stmt* Parser::parseStatement() {
 
         ensureSemicolon("expected ';' after print statement");
 
-        return new PrintStmt(line, col, literal, args);
+        return arena->make<PrintStmt>(line, col, literal, std::move(args));
     }
     else if (match(Token::BREAK)) {
         // if break is last statement in block, it can be missing ';'
         if (match(Token::SEMICOLON) || check(Token::CLOSE_CURLY)) {
-            return new BreakStmt(line, col);
+            return arena->make<BreakStmt>(line, col);
         }
         Exp* exp = parseExpression();
         // if break is last statement in block, it can be missing ';'
@@ -349,12 +474,12 @@ Stmt* Parser::parseStatement() {
             throw std::runtime_error("expected ';' after break expression\ngot: "
                                      + debugInfo(currentToken()));
         }
-        return new BreakStmt(line, col, exp);
+        return arena->make<BreakStmt>(line, col, exp);
     }
     else if (match(Token::RETURN)) {
         // if return is last statement in block, it can be missing ';'
         if (match(Token::SEMICOLON) || check(Token::CLOSE_CURLY)) {
-            return new ReturnStmt(line, col);
+            return arena->make<ReturnStmt>(line, col);
         }
         Exp* exp = parseExpression();
         // if return is last statement in block, it can be missing ';'
@@ -363,16 +488,16 @@ Stmt* Parser::parseStatement() {
                                      + debugInfo(currentToken()));
         }
 
-        return new ReturnStmt(line, col, exp);
+        return arena->make<ReturnStmt>(line, col, exp);
     }
     else if (match(Token::REFERENCE)) {
-        std::string id = currentToken().content;
+        Symbol id = currentToken().sym;
         if (!match(Token::ID)) {
             throw std::runtime_error("expected id after '&' in statement\ngot: "
                                      + debugInfo(currentToken()));
         }
 
-        Exp* lhs = new Variable(line, col, id);
+        Exp* lhs = arena->make<Variable>(line, col, id);
 
         if (!match(Token::ASSIGN)) {
             throw std::runtime_error("expected '=' after & id in assignment statement\ngot: "
@@ -382,21 +507,21 @@ Stmt* Parser::parseStatement() {
 
         ensureSemicolon("expected ';' after assignment statement");
 
-        return new AssignStmt(line, col, lhs, rhs, true);
+        return arena->make<AssignStmt>(line, col, lhs, rhs, true);
     }
     else if (check(Token::ID)) {
         // take a snapshot of scanner for possible later restoration
         auto snapshot = scanner->getSnapshot();
 
-        std::string id = currentToken().content;
+        Symbol id = currentToken().sym;
         match(Token::ID);
         if (match(Token::ASSIGN)) {
-            Exp* lhs = new Variable(line, col, id);
+            Exp* lhs = arena->make<Variable>(line, col, id);
             Exp* rhs = parseRhs();
 
             ensureSemicolon("expected ';' after assignment statement");
 
-            return new AssignStmt(line, col, lhs, rhs);
+            return arena->make<AssignStmt>(line, col, lhs, rhs);
         }
         else if (
                 check(Token::PLUS_ASSIGN)
@@ -407,12 +532,12 @@ Stmt* Parser::parseStatement() {
             BinaryExp::Operation op = tokenTypeToBinaryOperation(currentToken().type);
             scanner->next();
 
-            Exp* lhs = new Variable(line, col, id);
+            Exp* lhs = arena->make<Variable>(line, col, id);
             Exp* rhs = parseExpression();
 
             ensureSemicolon("expected ';' after compound assignment statement");
 
-            return new CompoundAssignStmt(line, col, op, lhs, rhs);
+            return arena->make<CompoundAssignStmt>(line, col, op, lhs, rhs);
         }
         else {
             if (match(Token::OPEN_BRACKET)) {
@@ -422,7 +547,7 @@ Stmt* Parser::parseStatement() {
                                              + std::string(" in statement\ngot: ")
                                              + debugInfo(currentToken()));
                 }
-                Exp* lhs = new SubscriptExp(line, col, id, exp);
+                Exp* lhs = arena->make<SubscriptExp>(line, col, id, exp);
                 if (!match(Token::ASSIGN)) {
                     if (check(Token::PLUS_ASSIGN)
                         || check(Token::MINUS_ASSIGN)
@@ -435,7 +560,7 @@ Stmt* Parser::parseStatement() {
                         Exp* rhs = parseExpression();
                         ensureSemicolon("expected ';' after compound assignment statement");
 
-                        return new CompoundAssignStmt(line, col, op, lhs, rhs);
+                        return arena->make<CompoundAssignStmt>(line, col, op, lhs, rhs);
                     }
                     else {
                         // if it is not an assign statement, it must be an expression statement
@@ -446,7 +571,7 @@ Stmt* Parser::parseStatement() {
                     Exp* rhs = parseExpression();
                     ensureSemicolon("expected ';' after compound assignment statement");
 
-                    return new AssignStmt(line, col, lhs, rhs);
+                    return arena->make<AssignStmt>(line, col, lhs, rhs);
                 }
             }
             else {
@@ -457,149 +582,176 @@ Stmt* Parser::parseStatement() {
     // it's equivalent to else (if no return was triggered, do this)
     Exp* exp = parseExpression();
     if (match(Token::SEMICOLON)) {
-        return new ExpStmt(line, col, exp);
+        return arena->make<ExpStmt>(line, col, exp);
     }
     if (check(Token::CLOSE_CURLY)) {
-        return new ExpStmt(line, col, exp, true);
+        return arena->make<ExpStmt>(line, col, exp, true);
     }
     throw std::runtime_error("expected valid statement\ngot: "
                              + debugInfo(currentToken()));
 }
 
-Exp* Parser::parseExpression() {
-    auto [line, col] = getPos();
-    Exp* exp = parseNotExp();
-    if (check(Token::LOR)
-        || check(Token::LAND)
-    ) {
-        BinaryExp::Operation op = tokenTypeToBinaryOperation(currentToken().type);
-        scanner->next();
+// binding power of each binary operator token; 0 for every other token
+enum Precedence { NONE, LOGICAL, RELATIONAL, ADDITIVE, MULTIPLICATIVE };
 
-        Exp* rhs = parseExpression();
-        exp = new BinaryExp(line, col, op, exp, rhs);
+static constexpr auto precedence = [] {
+    std::array<Precedence, Token::PRINT + 1> table {};
+    table[Token::LAND] = table[Token::LOR] = LOGICAL;
+    table[Token::EQ] = table[Token::NEQ] = RELATIONAL;
+    table[Token::LT] = table[Token::GT] = table[Token::LE] = table[Token::GE] = RELATIONAL;
+    table[Token::PLUS] = table[Token::MINUS] = ADDITIVE;
+    table[Token::TIMES] = table[Token::DIV] = MULTIPLICATIVE;
+    return table;
+}();
+
+void Parser::nest(int levels, int line, int col) {
+    if (depth + levels > MAX_DEPTH) {
+        throw std::runtime_error("nested more than " + std::to_string(MAX_DEPTH)
+                                 + " levels deep at " + std::to_string(line) + ":" + std::to_string(col));
     }
-    return exp;
 }
 
-Exp* Parser::parseNotExp() {
-    auto [line, col] = getPos();
-    if (match(Token::LNOT)) {
-        Exp* exp = parseExpression();
-        return new UnaryExp(line, col, UnaryExp::LNOT, exp);
+void Parser::reduce() {
+    Operator op = operators.back();
+    operators.pop_back();
+    Operand operand = operands.back();
+    if (op.type == Token::LNOT) {
+        nest(operand.depth + 1, op.line, op.col);
+        operands.back() = {arena->make<UnaryExp>(op.line, op.col, UnaryExp::LNOT, operand.exp),
+                           op.line, op.col, operand.depth + 1};
+    }
+    else if (op.type == Token::REFERENCE) {
+        nest(operand.depth + 1, op.line, op.col);
+        operands.back() = {arena->make<ReferenceExp>(op.line, op.col, operand.exp),
+                           op.line, op.col, operand.depth + 1};
     }
     else {
-        return parseRelationalExp();
+        operands.pop_back();
+        // a binary expression sits where its left operand starts
+        Operand& lhs = operands.back();
+        nest(std::max(lhs.depth, operand.depth) + 1, lhs.line, lhs.col);
+        lhs.exp = arena->make<BinaryExp>(lhs.line, lhs.col, tokenTypeToBinaryOperation(op.type),
+                                         lhs.exp, operand.exp);
+        lhs.depth = std::max(lhs.depth, operand.depth) + 1;
     }
 }
 
-Exp* Parser::parseRelationalExp() {
-    auto [line, col] = getPos();
-    Exp* exp = parseArithmeticExp();
-    if (check(Token::EQ)
-        || check(Token::GT)
-        || check(Token::LT)
-        || check(Token::GE)
-        || check(Token::LE)
-        || check(Token::EQ)
-        || check(Token::NEQ)
-    ) {
-        BinaryExp::Operation op = tokenTypeToBinaryOperation(currentToken().type);
-        scanner->next();
+// Operators of the same precedence group to the right, relational operators
+// do not chain, '!' applies to everything up to the end of the enclosing
+// expression and '&' to a single factor. Parentheses and prefix operators
+// are kept on the operator stack, so their nesting costs no native stack.
+// A tree deeper than MAX_DEPTH, counting the blocks and expressions this one
+// is nested in, is rejected.
+Exp* Parser::parseExpression() {
+    // entries below these belong to the expressions this one is nested in
+    const size_t operatorBase = operators.size();
+    const size_t operandBase = operands.size();
+    int open = 0;
+    // the node a nested expression hangs from, like a call or a condition
+    auto [startLine, startCol] = getPos();
+    nest(1, startLine, startCol);
+    ++depth;
+    while (true) {
+        auto [line, col] = getPos();
+        Token::Type context = operators.size() > operatorBase ? operators.back().type : Token::BEG;
+        bool expressionStart = context == Token::BEG || context == Token::OPEN_PARENTHESIS
+                               || context == Token::LNOT || precedence[context] == LOGICAL;
+        if (expressionStart && match(Token::LNOT)) {
+            operators.push_back({Token::LNOT, line, col});
+            continue;
+        }
+        if (context != Token::REFERENCE && match(Token::REFERENCE)) {
+            operators.push_back({Token::REFERENCE, line, col});
+            continue;
+        }
+        if (check(Token::OPEN_PARENTHESIS) && peek() != Token::CLOSE_PARENTHESIS) {
+            scanner->next();
+            operators.push_back({Token::OPEN_PARENTHESIS, line, col});
+            ++open;
+            continue;
+        }
+        operands.push_back({parseFactorExp(), line, col, 1});
 
-        Exp* rhs = parseArithmeticExp();
-        exp = new BinaryExp(line, col, op, exp, rhs);
-    }
-    return exp;
-}
+        while (true) {
+            if (operators.size() > operatorBase && operators.back().type == Token::REFERENCE) {
+                reduce();
+            }
+            if (!open || !check(Token::CLOSE_PARENTHESIS)) break;
+            scanner->next();
+            while (operators.back().type != Token::OPEN_PARENTHESIS) {
+                reduce();
+            }
+            // the parenthesized expression starts at its parenthesis
+            operands.back().line = operators.back().line;
+            operands.back().col = operators.back().col;
+            operators.pop_back();
+            --open;
+        }
 
-Exp* Parser::parseArithmeticExp() {
-    auto [line, col] = getPos();
-    Exp* exp = parseTermExp();
-    if (check(Token::PLUS)
-        || check(Token::MINUS)
-    ) {
-        BinaryExp::Operation op = tokenTypeToBinaryOperation(currentToken().type);
+        Precedence binding = precedence[currentToken().type];
+        if (binding == NONE) break;
+        while (operators.size() > operatorBase && precedence[operators.back().type] > binding) {
+            reduce();
+        }
+        if (binding == RELATIONAL && operators.size() > operatorBase
+            && precedence[operators.back().type] == RELATIONAL) {
+            break;
+        }
+        operators.push_back({currentToken().type, currentToken().line, currentToken().col});
         scanner->next();
-
-        Exp* rhs = parseArithmeticExp();
-        exp = new BinaryExp(line, col, op, exp, rhs);
     }
-    return exp;
-}
-
-Exp* Parser::parseTermExp() {
-    auto [line, col] = getPos();
-    Exp* exp = parseReferenceFactorExp();
-    if (check(Token::TIMES)
-        || check(Token::DIV)
-    ) {
-        BinaryExp::Operation op = tokenTypeToBinaryOperation(currentToken().type);
-        scanner->next();
-
-        Exp* rhs = parseTermExp();
-        exp = new BinaryExp(line, col, op, exp, rhs);
+    if (open) {
+        throw std::runtime_error("expected closing parenthesis after expression\ngot: "
+                                 + debugInfo(currentToken()));
     }
+    while (operators.size() > operatorBase) {
+        reduce();
+    }
+    Exp* exp = operands.back().exp;
+    operands.resize(operandBase);
+    --depth;
     return exp;
 }
 
-Exp* Parser::parseReferenceFactorExp() {
-    auto [line, col] = getPos();
-    if (match(Token::REFERENCE)) {
-        // int count {1};
-        // while (match(Token::REFERENCE)) {
-        //     ++count;
-        // }
-        Exp* exp = parseFactorExp();
-        return new ReferenceExp(line, col, exp);
-    }
-    return parseFactorExp();
-}
-
 Exp* Parser::parseFactorExp() {
     auto [line, col] = getPos();
+    // any other parenthesis is handled by parseExpression
     if (match(Token::OPEN_PARENTHESIS)) {
-        if (match(Token::CLOSE_PARENTHESIS)) {
-            return new Literal(line, col, Value(Value::UNIT, "()"));
-        }
-        Exp* exp = parseExpression();
-        if (!match(Token::CLOSE_PARENTHESIS)) {
-            throw std::runtime_error("expected closing parenthesis after expression\ngot: "
-                                     + debugInfo(currentToken()));
-        }
-        return exp;
+        match(Token::CLOSE_PARENTHESIS);
+        return arena->make<Literal>(line, col, Value(Value::UNIT, int64_t(0)));
     }
     else if (check(Token::BOOLEAN)) {
-        Value value (Value::BOOL, currentToken().content == "true");
+        Value value (Value::BOOL, int64_t(currentToken().content == "true"));
         match(Token::BOOLEAN);
         value.literal = true;
-        return new Literal(line, col, value);
+        return arena->make<Literal>(line, col, value);
     }
     else if (check(Token::CHAR)) {
-        Value value (Value::CHAR, std::string(1,currentToken().content[0]));
+        Value value (Value::CHAR, int64_t(currentToken().content[0]));
         match(Token::CHAR);
         value.literal = true;
-        return new Literal(line, col, value);
+        return arena->make<Literal>(line, col, value);
     }
     else if (check(Token::NUMBER)) {
-        Value value = Value(Value::I32, stoi(currentToken().content));
+        Value value = Value(Value::I32, int64_t(stoi(std::string(currentToken().content))));
         match(Token::NUMBER);
         value.literal = true;
-        return new Literal(line, col, value);
+        return arena->make<Literal>(line, col, value);
     }
     else if (check(Token::STRING)) {
-        Value value (Value::STR, currentToken().content);
+        Value value (Value::STR, currentToken().sym);
         match(Token::STRING);
         value.literal = true;
         value.ref = true;
-        return new Literal(line, col, value);
+        return arena->make<Literal>(line, col, value);
     }
     else if (check(Token::ID)) {
-        std::string id = currentToken().content;
+        Symbol id = currentToken().sym;
         match(Token::ID);
         if (match(Token::OPEN_PARENTHESIS)) {
-            std::list<Exp*> args;
+            std::pmr::vector<Exp*> args(arena);
             if (match(Token::CLOSE_PARENTHESIS)) {
-                return new FunCall(line, col, id, args);
+                return arena->make<FunCall>(line, col, id, std::move(args));
             }
             args.push_back(parseExpression());
             while (match(Token::COMMA)) {
@@ -611,7 +763,7 @@ Exp* Parser::parseFactorExp() {
                                          + debugInfo(currentToken()));
             }
 
-            return new FunCall(line, col, id, args);
+            return arena->make<FunCall>(line, col, id, std::move(args));
         }
         else if (match(Token::OPEN_BRACKET)) {
             Exp *start {}, *end {};
@@ -633,45 +785,45 @@ Exp* Parser::parseFactorExp() {
                     throw std::runtime_error("expected ']' to close slice expression"
                                              + debugInfo(currentToken()));
                 }
-                return new SliceExp(line, col, id, start, end, inclusive);
+                return arena->make<SliceExp>(line, col, id, start, end, inclusive);
             }
             else {
                 if (!match(Token::CLOSE_BRACKET)) {
                     throw std::runtime_error("expected ']' to close subscript expression"
                                              + debugInfo(currentToken()));
                 }
-                return new SubscriptExp(line, col, id, start);
+                return arena->make<SubscriptExp>(line, col, id, start);
             }
         }
         else {
-            return new Variable(line, col, id);
+            return arena->make<Variable>(line, col, id);
         }
 
     }
     else if (match(Token::IF)) {
         Exp* cond = parseExpression();
         Block* block = parseBlock();
+        auto* ifBranch = arena->make<IfExp::IfBranch>(cond, block);
 
-        IfExp* exp = new IfExp(line, col, cond, block);
-
+        std::pmr::vector<IfExp::IfBranch*> elseIfBranches(arena);
         while (check(Token::ELSE) && peek() == Token::IF) {
             match(Token::ELSE);
             match(Token::IF);
             cond = parseExpression();
             block = parseBlock();
-            exp->addElseIfBranch(cond, block);
+            elseIfBranches.push_back(arena->make<IfExp::IfBranch>(cond, block));
         }
 
+        IfExp::IfBranch* elseBranch {};
         if (match(Token::ELSE)) {
-            cond = nullptr;
             block = parseBlock();
-            exp->setElseBranch(cond, block);
+            elseBranch = arena->make<IfExp::IfBranch>(nullptr, block);
         }
 
-        return exp;
+        return arena->make<IfExp>(line, col, ifBranch, std::move(elseIfBranches), elseBranch);
     }
     else if (match(Token::LOOP)) {
-        return new LoopExp(line, col, parseBlock());
+        return arena->make<LoopExp>(line, col, parseBlock());
     }
     else {
         throw std::runtime_error("expected valid factor expression\ngot: "
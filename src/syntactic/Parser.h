@@ -7,35 +7,61 @@
 class Parser {
 private:
     Scanner* scanner;
+    // arena of the Program being parsed
+    Arena* arena {};
+
+    // pending operands and operators of parseExpression; an operand remembers
+    // where it starts and the levels of the tree it roots, a prefix operator
+    // or parenthesis where it is
+    struct Operand {
+        Exp* exp;
+        int line;
+        int col;
+        int depth;
+    };
+    struct Operator {
+        Token::Type type;
+        int line;
+        int col;
+    };
+    // expressions nested in a factor (arguments, subscripts, conditions)
+    // stack on top of the entries of the enclosing one
+    std::vector<Operand> operands;
+    std::vector<Operator> operators;
+    // levels of the tree above the expression or block being parsed
+    int depth {};
 
     Token::Type peek();
     bool check(Token::Type type);
     bool match(Token::Type type);
-    Token currentToken();
+    const Token& currentToken();
 
     std::pair<int,int> getPos();
     static std::string debugInfo(const Token& token);
     void ensureSemicolon(const std::string& message);
     BinaryExp::Operation tokenTypeToBinaryOperation(Token::Type type);
 
+    bool findItems(std::vector<std::pair<size_t, size_t>>& items);
+    Program* parseInParallel(const std::vector<std::pair<size_t, size_t>>& items, unsigned threads);
+
     Block* parseBlock();
     Param parseParameter();
-    std::pair<std::string, Fun*> parseFunction();
+    std::pair<Symbol, Fun*> parseFunction();
     Exp* parseRhs();
     Stmt* parseStatement();
     Exp* parseExpression();
-    Exp* parseNotExp();
-    Exp* parseRelationalExp();
-    Exp* parseArithmeticExp();
-    Exp* parseTermExp();
-    Exp* parseReferenceFactorExp();
     Exp* parseFactorExp();
+    void reduce();
+    void nest(int levels, int line, int col);
 
 public:
-    explicit Parser(char* filename);
+    // reads the tokens of an already lexed file; the scanner stays owned by the caller
+    explicit Parser(Scanner* scanner);
     ~Parser();
 
     Program* parse();
+    // parses the fn item at the current token into the given arena
+    std::pair<Symbol, Fun*> parseItem(Arena* arena);
 };
 
 #endif
@@ -1,8 +1,19 @@
 #include "Stmt.h"
 
-DecStmt::~DecStmt() {
-    delete rhs;
+void Stmt::print(std::ostream& out) {
+    switch (kind) {
+        case DEC: static_cast<DecStmt*>(this)->print(out); break;
+        case ASSIGN: static_cast<AssignStmt*>(this)->print(out); break;
+        case COMPOUND_ASSIGN: static_cast<CompoundAssignStmt*>(this)->print(out); break;
+        case FOR: static_cast<ForStmt*>(this)->print(out); break;
+        case WHILE: static_cast<WhileStmt*>(this)->print(out); break;
+        case PRINT: static_cast<PrintStmt*>(this)->print(out); break;
+        case BREAK: static_cast<BreakStmt*>(this)->print(out); break;
+        case RETURN: static_cast<ReturnStmt*>(this)->print(out); break;
+        case EXP: static_cast<ExpStmt*>(this)->print(out); break;
+    }
 }
+
 void DecStmt::print(std::ostream& out) {
     out << "let ";
     if (var.mut) out << "mut ";
@@ -24,17 +35,11 @@ void DecStmt::print(std::ostream& out) {
     out << ";";
 }
 
-AssignStmt::~AssignStmt() {
-    delete rhs;
-}
 void AssignStmt::print(std::ostream& out) {
     if (ref) out << '&';
     out << lhs << " = " << rhs << ";";
 }
 
-CompoundAssignStmt::~CompoundAssignStmt() {
-    delete rhs;
-}
 void CompoundAssignStmt::print(std::ostream& out) {
     out << lhs;
     switch(op) {
@@ -47,11 +52,6 @@ void CompoundAssignStmt::print(std::ostream& out) {
     out << "= " << rhs << ";";
 }
 
-ForStmt::~ForStmt() {
-    delete start;
-    delete end;
-    delete block;
-}
 void ForStmt::print(std::ostream& out) {
     out << "for " << id << " in " << start << "..";
     if (inclusive) out << '=';
@@ -59,21 +59,11 @@ void ForStmt::print(std::ostream& out) {
     out << block;
 }
 
-WhileStmt::~WhileStmt() {
-    delete cond;
-    delete block;
-}
 void WhileStmt::print(std::ostream& out) {
     out << "while " << cond << '\n';
     out << block;
 }
 
-PrintStmt::~PrintStmt() {
-    for (auto exp : args) {
-        delete exp;
-    }
-    args.clear();
-}
 void PrintStmt::print(std::ostream& out) {
     out << "println!(\"" << strLiteral << '"';
     if (!args.empty()) {
@@ -87,27 +77,18 @@ void PrintStmt::print(std::ostream& out) {
     out << ");";
 }
 
-BreakStmt::~BreakStmt() {
-    delete exp;
-}
 void BreakStmt::print(std::ostream& out) {
     out << "break";
     if (exp) out << ' ' << exp;
     out << ";";
 }
 
-ReturnStmt::~ReturnStmt() {
-    delete exp;
-}
 void ReturnStmt::print(std::ostream& out) {
     out << "return";
     if (exp) out << ' ' << exp;
     out << ";";
 }
 
-ExpStmt::~ExpStmt() {
-    delete exp;
-}
 void ExpStmt::print(std::ostream& out) {
     out << exp;
     if (!returnValue) out << ";";
@@ -1,29 +1,29 @@
 #ifndef STMT_H
 #define STMT_H
 
-#define FRIENDS friend class CodeGen; friend class TypeCheck; friend class NameRes;
+#define FRIENDS friend class CodeGen; friend class TypeCheck; friend class NameRes; friend class LineShift; friend class FlatAst; friend class IrBuilder;
 
 #include "Exp.h"
-#include <list>
+#include <vector>
 #include <string>
 
 class DecStmt : public Stmt {
     FRIENDS
-    std::string id;
+    Symbol id;
     Value var;
     Exp* rhs {};
+    // local the binding takes, numbered by NameRes
+    int slot {-1};
 
 public:
-    DecStmt(int line, int col, std::string id, Value var)
-        : Stmt(line, col), id(std::move(id)), var(var) {}
+    DecStmt(int line, int col, Symbol id, Value var)
+        : Stmt(DEC, line, col), id(id), var(var) {}
 
-    DecStmt(int line, int col, std::string id, Value var, Exp *rhs)
-        : Stmt(line, col), id(std::move(id)), var(var), rhs(rhs) {}
+    DecStmt(int line, int col, Symbol id, Value var, Exp *rhs)
+        : Stmt(DEC, line, col), id(id), var(var), rhs(rhs) {}
 
-    ~DecStmt() override;
 
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+    void print(std::ostream& out);
 };
 
 class AssignStmt : public Stmt {
@@ -34,14 +34,12 @@ class AssignStmt : public Stmt {
 
 public:
     AssignStmt(int line, int col, Exp* lhs, Exp *rhs)
-        : Stmt(line, col), lhs(lhs), rhs(rhs) {}
+        : Stmt(ASSIGN, line, col), lhs(lhs), rhs(rhs) {}
 
     AssignStmt(int line, int col, Exp* lhs, Exp *rhs, bool ref)
-        : Stmt(line, col), lhs(lhs), rhs(rhs), ref(ref) {}
+        : Stmt(ASSIGN, line, col), lhs(lhs), rhs(rhs), ref(ref) {}
 
-    ~AssignStmt() override;
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+    void print(std::ostream& out);
 };
 
 class CompoundAssignStmt : public Stmt {
@@ -52,33 +50,31 @@ class CompoundAssignStmt : public Stmt {
 
 public:
     CompoundAssignStmt(int line, int col, BinaryExp::Operation op, Exp *lhs, Exp *rhs)
-        : Stmt(line, col), op(op), lhs(lhs), rhs(rhs) {}
+        : Stmt(COMPOUND_ASSIGN, line, col), op(op), lhs(lhs), rhs(rhs) {}
 
-    ~CompoundAssignStmt() override;
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+    void print(std::ostream& out);
 };
 
 class ForStmt : public Stmt {
     FRIENDS
-    std::string id;
+    Symbol id;
     Exp* start;
     Exp* end;
     Block* block;
     bool inclusive {};
+    // local the index takes, numbered by NameRes
+    int slot {-1};
 
 public:
     ForStmt(int line, int col,
-            std::string id, Exp *start, Exp *end, Block *block)
-    : Stmt(line, col), id(std::move(id)), start(start), end(end), block(block) {}
+            Symbol id, Exp *start, Exp *end, Block *block)
+    : Stmt(FOR, line, col), id(id), start(start), end(end), block(block) {}
 
     ForStmt(int line, int col,
-            std::string id, Exp *start, Exp *end, Block *block, bool inclusive)
-    : Stmt(line, col), id(std::move(id)), start(start), end(end),
+            Symbol id, Exp *start, Exp *end, Block *block, bool inclusive)
+    : Stmt(FOR, line, col), id(id), start(start), end(end),
         block(block), inclusive(inclusive) {}
-    ~ForStmt() override;
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+    void print(std::ostream& out);
 };
 
 class WhileStmt : public Stmt {
@@ -88,25 +84,25 @@ class WhileStmt : public Stmt {
 
 public:
     WhileStmt(int line, int col, Exp *cond, Block *block) 
-        : Stmt(line, col), cond(cond), block(block) {}
-    ~WhileStmt() override;
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+        : Stmt(WHILE, line, col), cond(cond), block(block) {}
+    void print(std::ostream& out);
 };
 
 class PrintStmt : public Stmt {
     FRIENDS
     std::string strLiteral;
-    std::list<Exp*> args;
+    // printf format worked out by TypeCheck and its label in CodeGen; the
+    // source string is kept, so the statement can be checked again
+    std::string format;
+    std::string label;
+    std::pmr::vector<Exp*> args;
 
 public:
     PrintStmt(int line, int col, std::string strLiteral)
-    : Stmt(line, col), strLiteral(std::move(strLiteral)) {}
-    PrintStmt(int line, int col, std::string strLiteral, std::list<Exp *> args)
-    : Stmt(line, col), strLiteral(std::move(strLiteral)), args(std::move(args)) {}
-    ~PrintStmt() override;
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+    : Stmt(PRINT, line, col), strLiteral(std::move(strLiteral)) {}
+    PrintStmt(int line, int col, std::string strLiteral, std::pmr::vector<Exp *> args)
+    : Stmt(PRINT, line, col), strLiteral(std::move(strLiteral)), args(std::move(args)) {}
+    void print(std::ostream& out);
 };
 
 class BreakStmt : public Stmt {
@@ -114,12 +110,10 @@ class BreakStmt : public Stmt {
     Exp* exp {};
     Value::Type type{};
 public:
-    BreakStmt(int line, int col) : Stmt(line, col) {}
+    BreakStmt(int line, int col) : Stmt(BREAK, line, col) {}
     BreakStmt(int line, int col, Exp* exp) 
-        : Stmt(line, col), exp(exp) {};
-    ~BreakStmt() override;
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+        : Stmt(BREAK, line, col), exp(exp) {};
+    void print(std::ostream& out);
 };
 
 class ReturnStmt : public Stmt {
@@ -127,12 +121,10 @@ class ReturnStmt : public Stmt {
     Exp* exp {};
     Value::Type type{};
 public:
-    ReturnStmt(int line, int col) : Stmt(line, col) {}
+    ReturnStmt(int line, int col) : Stmt(RETURN, line, col) {}
     ReturnStmt(int line, int col, Exp* exp) 
-        : Stmt(line, col), exp(exp) {};
-    ~ReturnStmt() override;
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+        : Stmt(RETURN, line, col), exp(exp) {};
+    void print(std::ostream& out);
 };
 
 class ExpStmt : public Stmt {
@@ -141,14 +133,12 @@ class ExpStmt : public Stmt {
     bool returnValue {};
     Value::Type type{};
 public:
-    ExpStmt(int line, int col) : Stmt(line, col) {}
+    ExpStmt(int line, int col) : Stmt(EXP, line, col) {}
     ExpStmt(int line, int col, Exp* exp) 
-        : Stmt(line, col), exp(exp) {};
+        : Stmt(EXP, line, col), exp(exp) {};
     ExpStmt(int line, int col, Exp* exp, bool returnValue) 
-        : Stmt(line, col), exp(exp), returnValue(returnValue) {};
-    ~ExpStmt() override;
-    void print(std::ostream& out) override;
-    Value accept(Visitor* visitor) override;
+        : Stmt(EXP, line, col), exp(exp), returnValue(returnValue) {};
+    void print(std::ostream& out);
 };
 
 #endif
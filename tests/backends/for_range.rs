@@ -0,0 +1,15 @@
+fn bound(n: i32) -> i32 {
+    println!("bound {}", n);
+    return n;
+}
+
+fn main() {
+    let mut n = 3;
+    for i in 0..bound(n) {
+        n = n + 1;
+        println!("{} {}", i, n);
+    }
+    for i in bound(1)..=bound(n) {
+        println!("{}", i);
+    }
+}
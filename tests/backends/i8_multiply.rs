@@ -0,0 +1,9 @@
+fn main() {
+    let a: i8 = 7;
+    let b: i8 = 0 - 3;
+    let c: i8 = a * b;
+    println!("{}", c);
+    let mut d: i8 = 20;
+    d *= a;
+    println!("{}", d);
+}
@@ -0,0 +1,16 @@
+fn hit(n: i32) -> bool {
+    println!("hit {}", n);
+    n > 2
+}
+
+fn main() {
+    let a = hit(1) && hit(2);
+    let b = hit(3) || hit(4);
+    let c = hit(5) && hit(1) || hit(6);
+    println!("{} {} {}", a, b, c);
+    let mut k = 0;
+    while k < 3 && hit(k) {
+        k = k + 1;
+    }
+    println!("{}", k);
+}
@@ -0,0 +1,6 @@
+fn f() -> i32 {
+    return 1;
+}
+fn main() {
+    f = 2;
+}
@@ -0,0 +1,7 @@
+fn twice(x: i32) -> i32 {
+    return x * 2;
+}
+
+fn main() {
+    println!("{}", twice);
+}
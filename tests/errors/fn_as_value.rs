@@ -0,0 +1,7 @@
+fn f() -> i32 {
+    return 1;
+}
+fn main() {
+    let x = f;
+    println!("{}", x);
+}
@@ -0,0 +1,15 @@
+fn main() {
+    let a = 35;
+    let b = 20;
+    let c = a + b;
+    if c > 100 {
+        println!("big {}", c);
+    } else {
+        println!("small {}", c);
+    }
+    let mut n = 0;
+    while n < c {
+        n += 1;
+    }
+    println!("{}", n);
+}
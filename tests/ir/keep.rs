@@ -0,0 +1,16 @@
+fn half(x: i32) -> i32 {
+    let zero = 0;
+    if x > 10 {
+        return x / 2;
+    }
+    x / zero
+}
+
+fn main() {
+    let mut i = 1;
+    let k = 3;
+    while i < 100 {
+        i = i * k;
+    }
+    println!("{} {}", i, half(k + 20));
+}
@@ -0,0 +1,29 @@
+fn f(a: i64, b: i64, c: i64, d: i64, e: bool, g: i64, h: i64, k: i64) -> i64 {
+    if e {
+        return f(a + 1, b * 2, c, d, false, g - 1, h + 3, k * 2) + 1;
+    }
+    a + b + c + d + g * h + k
+}
+fn g(a: i32, b: i32, c: i32, d: i32, e: i32, f: i32, x: i32, y: i32, z: i32) -> i32 {
+    let mut s = ((((a - b) + c) - d) + e) - f;
+    s = s * 10 + x;
+    s = s * 10 + y;
+    s * 10 + z
+}
+fn h(a: i8, b: i16, c: bool, d: i8, e: i16, f: bool, x: i8, y: bool) -> i16 {
+    if c && f && !y {
+        return b + e;
+    }
+    println!("{} {} {} {}", a, d, x, y);
+    b - e
+}
+fn main() {
+    let x: i64 = 5;
+    println!("{}", f(1, x, 3, 4, true, 6, 7, 8));
+    println!("{}", f(1, x, 3, 4, false, 6, 7, 8));
+    let t = g(9, 8, 7, 6, 5, 4, 3, 2, 1);
+    println!("{} {}", t, g(1, 2, 3, 4, 5, 6, 7, 8, g(1, 1, 1, 1, 1, 1, 1, 1, 1)));
+    println!("{} {} {} {} {}", 1, 2, 3, 4, 5);
+    println!("{}", h(1, 2, true, 4, 5, true, 7, false));
+    println!("{}", h(1, 2, true, 4, 5, true, 7, true));
+}
@@ -0,0 +1,362 @@
+import argparse
+import subprocess
+import statistics
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+# Runs the RUSTy test suites and reports what fails.
+# Usage: python tests/run.py [--compiler ./rusty] [suite ...]
+#
+#   backends  every program in input/ and tests/backends/ through both back
+#             ends, which must print the same, and the .out next to it if any
+#   programs  every program in tests/programs/ through the default back end,
+#             which must print its .out
+#   ir        every program in tests/ir/, whose --emit=ir must be its .ir
+#   cache     programs compiled through --cache, from entries that are good,
+#             damaged, or of another source
+#   errors    every program in tests/errors/, which must be rejected with the
+#             message in its .err, with and without --split-checks
+#   session   a buffer edited and compiled through --session, which must parse
+#             and check again only the fns an edit touches, and compile each
+#             text as a compile of it from scratch does; and a check after a
+#             keystroke in a large buffer, which must take a small part of the
+#             time of a compile
+
+tests_dir = Path(__file__).resolve().parent
+root_dir = tests_dir.parent
+
+
+class Failed(Exception):
+    pass
+
+
+def compile_and_run(compiler, source, tmpdir, *flags):
+    """Compiles source with flags, links and runs it; returns its stdout."""
+    asm_path = tmpdir / f"{source.stem}.s"
+    exe_path = tmpdir / source.stem
+    comp = subprocess.run([compiler, *flags, '-o', str(asm_path), str(source)], capture_output=True, text=True)
+    if comp.returncode != 0:
+        raise Failed(f"compile error:\n{comp.stderr}")
+    link = subprocess.run(['gcc', '-no-pie', str(asm_path), '-o', str(exe_path)], capture_output=True, text=True)
+    if link.returncode != 0:
+        raise Failed(f"link error:\n{link.stderr}")
+    try:
+        run = subprocess.run([str(exe_path)], capture_output=True, text=True, timeout=10)
+    except subprocess.TimeoutExpired:
+        raise Failed("timeout")
+    return run.stdout
+
+
+def expected_output(source):
+    out = source.with_suffix('.out')
+    return out.read_text() if out.exists() else None
+
+
+def backends(compiler, tmpdir):
+    failures = []
+    sources = sorted((root_dir / 'input').glob('*.rs')) + sorted((tests_dir / 'backends').glob('*.rs'))
+    for source in sources:
+        try:
+            ir = compile_and_run(compiler, source, tmpdir, '--backend=ir')
+            tree = compile_and_run(compiler, source, tmpdir, '--backend=tree')
+        except Failed as error:
+            failures.append(f"{source.name}: {error}")
+            continue
+        expected = expected_output(source)
+        if ir != tree:
+            failures.append(f"{source.name}: the back ends differ\nir:\n{ir}\ntree:\n{tree}")
+        elif expected is not None and ir != expected:
+            failures.append(f"{source.name}: expected\n{expected}\ngot:\n{ir}")
+    return failures
+
+
+def programs(compiler, tmpdir):
+    failures = []
+    for source in sorted((tests_dir / 'programs').glob('*.rs')):
+        try:
+            output = compile_and_run(compiler, source, tmpdir)
+        except Failed as error:
+            failures.append(f"{source.name}: {error}")
+            continue
+        expected = expected_output(source)
+        if output != expected:
+            failures.append(f"{source.name}: expected\n{expected}\ngot:\n{output}")
+    return failures
+
+
+def ir(compiler, tmpdir):
+    failures = []
+    for source in sorted((tests_dir / 'ir').glob('*.rs')):
+        comp = subprocess.run([compiler, '--emit=ir', str(source)], capture_output=True, text=True)
+        expected = source.with_suffix('.ir').read_text()
+        if comp.returncode != 0:
+            failures.append(f"{source.name}: compile error:\n{comp.stderr}")
+        elif comp.stdout != expected:
+            failures.append(f"{source.name}: expected\n{expected}\ngot:\n{comp.stdout}")
+    return failures
+
+
+# the checksum AstCache keeps of an entry, as src/syntactic/AstCache.cpp computes it
+CHECKSUM_SEED = 0x436865636b
+MASK = (1 << 64) - 1
+
+
+def hash_bytes(data, seed):
+    k = 0x9E3779B97F4A7C15
+    h = seed ^ (len(data) * k & MASK)
+    whole = len(data) - len(data) % 8
+    for i in range(0, whole, 8):
+        h = (h ^ int.from_bytes(data[i:i + 8], 'little')) * k & MASK
+        h ^= h >> 29
+    h = (h ^ int.from_bytes(data[whole:], 'little')) * k & MASK
+    return h ^ (h >> 32)
+
+
+def cache(compiler, tmpdir):
+    failures = []
+    cache_dir = tmpdir / 'cache'
+    # two sources of the same size, so that only their text tells their entries apart
+    sources = []
+    for n in (1, 2):
+        source = tmpdir / f"p{n}.rs"
+        source.write_text(f'fn main() {{\n    let x = {n};\n    println!("{{}}", x + 1);\n}}\n')
+        sources.append(source)
+
+    def compiled(source, *flags):
+        comp = subprocess.run([compiler, *flags, '-o', '-', str(source)], capture_output=True, text=True)
+        if comp.returncode != 0:
+            raise Failed(f"compile error:\n{comp.stderr}")
+        return comp.stdout
+
+    # an entry is its header (checksum, source size), the source, then the tree
+    def entry_of(source):
+        text = source.read_bytes()
+        for path in cache_dir.glob('*.ast'):
+            if path.read_bytes()[16:16 + len(text)] == text:
+                return path
+        raise Failed(f"no cache entry for {source.name}")
+
+    def tree_of(source):
+        return entry_of(source).read_bytes()[16 + len(source.read_bytes()):]
+
+    def write_entry(source, tree):
+        text = source.read_bytes()
+        header = hash_bytes(tree, CHECKSUM_SEED).to_bytes(8, 'little') + len(text).to_bytes(8, 'little')
+        entry_of(source).write_bytes(header + text + tree)
+
+    def expect(what, source, expected):
+        try:
+            got = compiled(source, f"--cache={cache_dir}")
+        except Failed as error:
+            got = str(error)
+        if got != expected:
+            failures.append(f"{what}: {source.name} expected\n{expected}\ngot:\n{got}")
+
+    try:
+        fresh = [compiled(source) for source in sources]
+        for source, expected in zip(sources, fresh):
+            expect("storing", source, expected)
+            expect("loading", source, expected)
+        one, two = sources
+
+        # a hit goes straight to code generation, whatever tree the entry holds
+        write_entry(one, tree_of(two))
+        expect("a hit", one, fresh[1])
+
+        # an entry of another source under this name, as a hash collision leaves
+        tree = entry_of(two).read_bytes()
+        entry_of(one).write_bytes(tree)
+        expect("another source", one, fresh[0])
+
+        # a tree cut short, with a checksum that matches
+        write_entry(one, tree_of(one)[:len(tree_of(one)) // 2])
+        expect("a truncated tree", one, fresh[0])
+
+        # every first operand out of range: the header is 56 bytes, then come
+        # the kinds, types and flags, a byte a node each
+        tree = bytearray(tree_of(one))
+        nodes = int.from_bytes(tree[12:16], 'little')
+        start = 56 + 3 * ((nodes + 7) & ~7)
+        tree[start:start + 4 * nodes] = b'\xf0\xff\xff\xff' * nodes
+        write_entry(one, bytes(tree))
+        expect("operands out of range", one, fresh[0])
+    except Failed as error:
+        failures.append(str(error))
+    return failures
+
+
+def errors(compiler, tmpdir):
+    failures = []
+    for source in sorted((tests_dir / 'errors').glob('*.rs')):
+        expected = source.with_suffix('.err').read_text().strip()
+        for flags in ([], ['--split-checks']):
+            comp = subprocess.run([compiler, *flags, '-o', str(tmpdir / 'out.s'), str(source)],
+                                  capture_output=True, text=True)
+            if comp.returncode == 0 or expected not in comp.stderr:
+                failures.append(f"{source.name} {' '.join(flags)}: expected the error\n{expected}\n"
+                                f"got (exit {comp.returncode}):\n{comp.stderr}")
+    return failures
+
+
+class Session:
+    """A compiler running --session, fed requests as the API server does."""
+
+    def __init__(self, compiler):
+        self.process = subprocess.Popen([compiler, '--session'], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        self.text = b''
+
+    def request(self, line, data=b''):
+        self.process.stdin.write(line.encode() + b'\n' + data)
+        self.process.stdin.flush()
+        status, length, *counts = self.process.stdout.readline().decode().split()
+        return status, self.process.stdout.read(int(length)).decode(), tuple(map(int, counts))
+
+    def replace(self, old, new):
+        begin = self.text.index(old.encode())
+        status, message, _ = self.request(f"edit {begin} {begin + len(old.encode())} {len(new.encode())}", new.encode())
+        if status != 'ok':
+            raise Failed(f"edit rejected: {message}")
+        self.text = self.text[:begin] + new.encode() + self.text[begin + len(old.encode()):]
+
+    def close(self):
+        self.process.stdin.close()
+        self.process.wait()
+
+
+SESSION_SOURCE = """\
+fn helper(a: i32) -> i32 {
+    a + 1
+}
+
+fn twice(a: i32) -> i32 {
+    helper(helper(a))
+}
+
+fn main() {
+    println!("{}", twice(3));
+}
+"""
+
+
+def session(compiler, tmpdir):
+    failures = []
+    buffer = Session(compiler)
+    source = tmpdir / 'buffer.rs'
+
+    # what --session replies must be what compiling the text from scratch
+    # gives, after parsing, checking and moving to other lines that many fns
+    def expect(what, parsed, checked, shifted):
+        status, payload, counts = buffer.request('compile')
+        source.write_bytes(buffer.text)
+        comp = subprocess.run([compiler, '-o', '-', str(source)], capture_output=True, text=True)
+        if status == 'ok' and (comp.returncode != 0 or payload != comp.stdout):
+            failures.append(f"{what}: the session compiles\n{buffer.text.decode()}\nunlike a compile from scratch")
+        elif status == 'error' and (comp.returncode == 0 or payload not in comp.stderr):
+            failures.append(f"{what}: the session fails with\n{payload}\nand a compile from scratch with\n{comp.stderr}")
+        elif status == 'ok' and counts != (parsed, checked, shifted):
+            failures.append(f"{what}: expected {parsed} fns parsed, {checked} checked and {shifted} moved, "
+                            f"got {counts}")
+
+    try:
+        buffer.replace('', SESSION_SOURCE)
+        expect("the first compile", 3, 3, 0)
+        expect("a compile without edits", 0, 0, 0)
+
+        buffer.replace('twice(3)', 'twice(40)')
+        expect("a literal changed", 1, 1, 0)
+
+        # the fns after a line added are moved, not parsed again
+        buffer.replace('    a + 1\n', '    let b = a;\n    b + 1\n')
+        expect("a line added", 1, 1, 2)
+
+        # a changed signature has every fn checked again, and the error is
+        # reported at the line twice was moved to
+        buffer.replace('fn helper(a: i32)', 'fn helper(a: bool)')
+        expect("a signature changed", 1, 3, 0)
+        buffer.replace('fn helper(a: bool)', 'fn helper(a: i32)')
+        expect("a signature restored", 1, 3, 0)
+
+        buffer.replace('    println!("{}", twice(40));\n}', '    println!("{}", twice(40));\n')
+        expect("a brace removed", 0, 0, 0)
+        buffer.replace('    println!("{}", twice(40));\n', '    println!("{}", twice(40));\n}')
+        expect("a brace put back", 1, 1, 0)
+
+        # a check reports what a compile would, without the assembly
+        buffer.replace('helper(helper(a))', 'helper(helper(true))')
+        status, payload, _ = buffer.request('check')
+        if status != 'error' or 'type mismatch' not in payload:
+            failures.append(f"a check of a type error: got {status}\n{payload}")
+        buffer.replace('helper(helper(true))', 'helper(helper(a))')
+        status, payload, counts = buffer.request('check')
+        if (status, payload, counts) != ('ok', '', (1, 1, 0)):
+            failures.append(f"a check after the fix: got {status} {counts}\n{payload}")
+        expect("a compile after a check", 0, 0, 0)
+    except Failed as error:
+        failures.append(str(error))
+    finally:
+        buffer.close()
+
+    # the editor checks after every keystroke, so a check must cost about one
+    # fn, however many fns there are
+    buffer = Session(compiler)
+    try:
+        buffer.replace('', ''.join(f"fn f{i}(a: i32) -> i32 {{\n    let b = a * {i};\n    b + 1\n}}\n\n"
+                                   for i in range(2000)) + 'fn main() {\n    println!("{}", f0(1));\n}\n')
+        start = time.perf_counter()
+        buffer.request('compile')
+        compile_time = time.perf_counter() - start
+        times = []
+        for i in range(0, 2000, 100):
+            buffer.replace(f"a * {i};", f"a * {i + 1};")
+            start = time.perf_counter()
+            status, payload, counts = buffer.request('check')
+            times.append(time.perf_counter() - start)
+            if (status, counts) != ('ok', (1, 1, 0)):
+                failures.append(f"a keystroke in f{i}: got {status} {counts}\n{payload}")
+                break
+        check_time = statistics.median(times)
+        if check_time > compile_time / 10:
+            failures.append(f"a check takes {check_time * 1000:.2f} ms, against {compile_time * 1000:.2f} ms "
+                            f"for a compile of all 2001 fns")
+    except Failed as error:
+        failures.append(str(error))
+    finally:
+        buffer.close()
+    return failures
+
+
+SUITES = {
+    'backends': backends,
+    'programs': programs,
+    'ir': ir,
+    'cache': cache,
+    'errors': errors,
+    'session': session,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--compiler", default=str(root_dir / 'rusty'))
+    parser.add_argument("suites", nargs="*", help=f"suites to run, of {', '.join(SUITES)}; all by default")
+    args = parser.parse_args()
+
+    compiler = str(Path(args.compiler).resolve())
+    failed = False
+    for name in args.suites or SUITES:
+        if name not in SUITES:
+            print(f"unknown suite '{name}'")
+            sys.exit(2)
+        with tempfile.TemporaryDirectory() as tmpdir:
+            failures = SUITES[name](compiler, Path(tmpdir))
+        for failure in failures:
+            print(f"FAIL {name}: {failure}")
+        print(f"== {name} == {'FAIL' if failures else 'OK'}")
+        failed = failed or bool(failures)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -35,6 +35,11 @@ export default function RustIDE(): ReactElement {
   const [leftPaneWidth, setLeftPaneWidth] = useState(50) // percentage
   const [isResizing, setIsResizing] = useState(false)
   const [copied, setCopied] = useState(false)
+  // names this editor to the server, which keeps a compiler session per editor
+  const [session] = useState(() => crypto.randomUUID())
+  const [diagnostic, setDiagnostic] = useState<string | null>(null)
+  // number of the last check sent, so that an older answer arriving late is dropped
+  const checkRef = useRef(0)
 
   const handleCompile = async () => {
     setIsCompiling(true)
@@ -45,7 +50,7 @@ export default function RustIDE(): ReactElement {
         {
           method: "POST",
           headers: { "Content-Type": "application/json" },
-          body: JSON.stringify({ code }),
+          body: JSON.stringify({ code, session }),
         }
       )
       const data = await res.json()
@@ -70,7 +75,7 @@ export default function RustIDE(): ReactElement {
         {
           method: "POST",
           headers: { "Content-Type": "application/json" },
-          body: JSON.stringify({ code }),
+          body: JSON.stringify({ code, session }),
         }
       )
       const data = await res.json()
@@ -112,6 +117,24 @@ export default function RustIDE(): ReactElement {
     setIsRunningRustc(false)
   }
 
+  // the server only parses and checks again the fns an edit touches, so
+  // the code is checked on every change
+  useEffect(() => {
+    const id = ++checkRef.current
+    fetch(`${process.env.NEXT_PUBLIC_API_URL ?? ""}/check`, {
+      method: "POST",
+      headers: { "Content-Type": "application/json" },
+      body: JSON.stringify({ code, session }),
+    })
+      .then((res) => res.json())
+      .then((data) => {
+        if (id === checkRef.current) setDiagnostic(data.ok ? "" : data.diagnostic ?? data.detail)
+      })
+      .catch(() => {
+        if (id === checkRef.current) setDiagnostic(null)
+      })
+  }, [code, session])
+
   const updateCursorPosition = (textarea: HTMLTextAreaElement) => {
     const cursorPos = textarea.selectionStart
     const textBeforeCursor = code.substring(0, cursorPos)
@@ -443,10 +466,15 @@ export default function RustIDE(): ReactElement {
 
       {/* Status Bar */}
       <div className="bg-[#007acc] px-4 py-1 text-xs text-white flex items-center justify-between flex-shrink-0">
-        <div className="flex items-center gap-4">
+        <div className="flex items-center gap-4 min-w-0">
           <span>Rust</span>
           <span>UTF-8</span>
           <span>LF</span>
+          {diagnostic !== null && (
+            <span className="truncate" title={diagnostic}>
+              {diagnostic === "" ? "No errors" : diagnostic.split("\n")[0]}
+            </span>
+          )}
         </div>
         <div className="flex items-center gap-4">
           <span>